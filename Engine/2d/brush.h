@@ -26,6 +26,7 @@ class Brush {
     Sprite                      spr;
     Tempest::Color              color;
     PaintDevice::Blend          blend=PaintDevice::NoBlend;
+    bool                        sdf  =false;
 
     struct Info {
       int      w=0,h=0;
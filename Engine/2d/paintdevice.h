@@ -3,6 +3,7 @@
 #include <Tempest/AbstractGraphicsApi>
 #include <Tempest/RenderPipeline>
 #include <Tempest/VertexBuffer>
+#include <Tempest/Rect>
 
 #include <initializer_list>
 
@@ -47,12 +48,35 @@ class PaintDevice {
       float r=0,g=0,b=0,a=0;
       };
 
+    // compact vertex: uv is unorm16 (clamped to [0..1]), color is unorm8
+    struct PointPacked {
+      float    x=0,y=0;
+      uint16_t u=0,v=0;
+      uint8_t  r=0,g=0,b=0,a=0;
+      };
+
+    // identifies retained geometry of a widget; geometry is reusable only if all fields match
+    struct CacheKey {
+      uint64_t id=0;
+      int32_t  dx=0, dy=0;
+      Rect     vp;
+      uint32_t w=0, h=0;
+      uint64_t atlas=0;    // TextureAtlas::id()
+      uint32_t atlasGen=0; // TextureAtlas::generation(): sprites in geometry are moved or evicted
+
+      bool operator == (const CacheKey& k) const {
+        return id==k.id && dx==k.dx && dy==k.dy && vp==k.vp && w==k.w && h==k.h &&
+               atlas==k.atlas && atlasGen==k.atlasGen;
+        }
+      };
+
   protected:
     using TexPtr =Detail::ResourcePtr<Tempest::Texture2d>;
     using PipePtr=Detail::ResourcePtr<Tempest::RenderPipeline>;
 
     virtual void   clear()=0;
     virtual void   addPoint(const Point& p)=0;
+    virtual void   addPoints(const Point* p, size_t count) { for(size_t i=0;i<count;++i) addPoint(p[i]); }
     virtual void   commitPoints()=0;
 
     virtual void   beginPaint(bool clear,uint32_t w,uint32_t h)=0;
@@ -64,12 +88,26 @@ class PaintDevice {
     virtual void   setState(const Sprite& s, const Color& c)=0;
     virtual void   setTopology(Topology t)=0;
     virtual void   setBlend(const Blend b)=0;
+    // texture holds signed distance field (alpha channel), see Font::setSdf
+    virtual void   setSdf(bool sdf) { (void)sdf; }
+    // returns true, if device applies scissor on draw; otherwise geometry is clipped by painter
+    virtual bool   setScissor(const Rect& sc) { (void)sc; return false; }
+
+    virtual size_t beginCache() { return 0; }
+    virtual void   endCache(size_t id, const CacheKey& k) { (void)id; (void)k; }
+    virtual bool   restoreCache(const CacheKey& k) { (void)k; return false; }
 
   friend class Painter;
+  friend class Widget;
   };
 
 template<>
 inline VertexBufferDecl vertexBufferDecl<PaintDevice::Point>() {
   return {Decl::float3,Decl::float2,Decl::float4};
   }
+
+template<>
+inline VertexBufferDecl vertexBufferDecl<PaintDevice::PointPacked>() {
+  return {Decl::float2,Decl::ushort2,Decl::color};
+  }
 }
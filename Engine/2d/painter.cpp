@@ -8,6 +8,8 @@
 
 #include "../utility/utf8_helper.h"
 
+#include <cstring>
+
 using namespace Tempest;
 
 Painter::Painter(PaintEvent &ev, Mode m)
@@ -23,13 +25,14 @@ Painter::Painter(PaintEvent &ev, Mode m)
   const Rect&  r = ev.viewPort();
   s.scRect.ox = dp.x;
   s.scRect.oy = dp.y;
-  setScissor(r.x,r.y,r.w,r.h);
 
   implSetColor(1,1,1,1);
   dev.beginPaint(m==Clear,ev.w(),ev.h());
+  setScissor(r.x,r.y,r.w,r.h);
   }
 
 Painter::~Painter() {
+  implFlush();
   dev.endPaint();
   }
 
@@ -43,6 +46,7 @@ void Painter::setScissor(int x, int y, int w, int h) {
     std::swap(s.scRect.x,s.scRect.x1);
   if(s.scRect.y>s.scRect.y1)
     std::swap(s.scRect.y,s.scRect.y1);
+  implScissor();
   }
 
 void Painter::setScissor(int x, int y, unsigned w, unsigned h) {
@@ -50,6 +54,13 @@ void Painter::setScissor(int x, int y, unsigned w, unsigned h) {
   s.scRect.y  = y;
   s.scRect.x1 = x+int(w);
   s.scRect.y1 = y+int(h);
+  implScissor();
+  }
+
+void Painter::implScissor() {
+  implFlush();
+  const ScissorRect& sc = s.scRect;
+  hwScissor = dev.setScissor(Rect(sc.x,sc.y,sc.x1-sc.x,sc.y1-sc.y));
   }
 
 void Painter::setScissor(const Rect& r) {
@@ -57,19 +68,32 @@ void Painter::setScissor(const Rect& r) {
   }
 
 void Painter::implAddPoint(float x, float y, float u, float v) {
-  pt.x=x*s.tr.invW-1.f;
-  pt.y=y*s.tr.invH-1.f;
-  pt.u=u;
-  pt.v=v;
-  dev.addPoint(pt);
+  if(T_UNLIKELY(batchSize==BatchSize))
+    implFlush();
+  auto& p = batch[batchSize++];
+  p   = pt;
+  p.x = x*s.tr.invW-1.f;
+  p.y = y*s.tr.invH-1.f;
+  p.u = u;
+  p.v = v;
   }
 
 void Painter::implAddPoint(int x, int y, float u, float v) {
-  pt.x=x*s.tr.invW-1.f;
-  pt.y=y*s.tr.invH-1.f;
-  pt.u=u;
-  pt.v=v;
-  dev.addPoint(pt);
+  if(T_UNLIKELY(batchSize==BatchSize))
+    implFlush();
+  auto& p = batch[batchSize++];
+  p   = pt;
+  p.x = x*s.tr.invW-1.f;
+  p.y = y*s.tr.invH-1.f;
+  p.u = u;
+  p.v = v;
+  }
+
+void Painter::implFlush() {
+  if(batchSize==0)
+    return;
+  dev.addPoints(batch,batchSize);
+  batchSize = 0;
   }
 
 void Painter::implSetColor(float r, float g, float b, float a) {
@@ -82,16 +106,25 @@ void Painter::implSetColor(float r, float g, float b, float a) {
 void Painter::drawTriangle(int x0, int y0, float u0, float v0,
                            int x1, int y1, float u1, float v1,
                            int x2, int y2, float u2, float v2) {
-  FPoint trigBuf[4+4+4+4];
-  implDrawTrig( float(x0), float(y0), s.dU+u0*s.invW,s.dV+v0*s.invH,
-                float(x1), float(y1), s.dU+u1*s.invW,s.dV+v1*s.invH,
-                float(x2), float(y2), s.dU+u2*s.invW,s.dV+v2*s.invH,
-                trigBuf, 0 );
+  drawTriangle(float(x0), float(y0), u0, v0,
+               float(x1), float(y1), u1, v1,
+               float(x2), float(y2), u2, v2);
   }
 
 void Painter::drawTriangle(float x0, float y0, float u0, float v0,
                            float x1, float y1, float u1, float v1,
                            float x2, float y2, float u2, float v2) {
+  if(hwScissor && s.tr.mat.type()==Transform::T_AxisAligned) {
+    const ScissorRect& sc = s.scRect;
+    if(std::max(x0,std::max(x1,x2))<=float(sc.x) || std::min(x0,std::min(x1,x2))>=float(sc.x1) ||
+       std::max(y0,std::max(y1,y2))<=float(sc.y) || std::min(y0,std::min(y1,y2))>=float(sc.y1))
+      return;
+    implAddPoint(x0, y0, s.dU+u0*s.invW,s.dV+v0*s.invH);
+    implAddPoint(x1, y1, s.dU+u1*s.invW,s.dV+v1*s.invH);
+    implAddPoint(x2, y2, s.dU+u2*s.invW,s.dV+v2*s.invH);
+    return;
+    }
+
   FPoint trigBuf[4+4+4+4];
   implDrawTrig( x0, y0, s.dU+u0*s.invW,s.dV+v0*s.invH,
                 x1, y1, s.dU+u1*s.invW,s.dV+v1*s.invH,
@@ -224,24 +257,42 @@ void Painter::setPen(const Pen &p) {
   s.pn = p;
   }
 
+void Painter::implSetState(const Brush::TexPtr& tex, const void* page, Blend blend, bool sdf) {
+  // glyphs from same atlas page don't change device state - keep them in one batch
+  if(devSt.valid && devSt.tex==tex && devSt.page==page && devSt.blend==blend && devSt.sdf==sdf)
+    return;
+  implFlush();
+  devSt.tex   = tex;
+  devSt.page  = page;
+  devSt.blend = blend;
+  devSt.sdf   = sdf;
+  devSt.valid = true;
+  }
+
 void Painter::implBrush(const Brush &b) {
+  implSetState(b.tex,b.tex ? nullptr : b.spr.pageId(),b.blend,b.sdf);
   if(b.tex) {
     dev.setState(b.tex,b.color,b.texFrm);
     } else {
+    ta.touch(b.spr);
     dev.setState(b.spr,b.color);
     }
   dev.setBlend(b.blend);
+  dev.setSdf(b.sdf);
   implSetColor(b.color.r(),b.color.g(),b.color.b(),b.color.a());
   }
 
 void Painter::implPen(const Pen &p) {
+  implSetState(Brush::TexPtr(),nullptr,Blend::NoBlend,false);
   dev.setState(Brush::TexPtr(),p.color,TextureFormat::Undefined);
   dev.setBlend(Blend::NoBlend);
+  dev.setSdf(false);
   implSetColor(p.color.r(),p.color.g(),p.color.b(),p.color.a());
   }
 
 void Painter::implDrawRect(int x1, int y1, int x2, int y2, float u1, float v1, float u2, float v2) {
   if(state!=StBrush) {
+    implFlush();
     dev.setTopology(Triangles);
     state=StBrush;
     implBrush(s.br);
@@ -263,10 +314,24 @@ void Painter::implDrawRect(int x1, int y1, int x2, int y2, float u1, float v1, f
       std::swap(v1,v2);
       }
 
+    ScissorRect& sc = s.scRect;
+    if(hwScissor) {
+      // clipped by device, only reject invisible geometry
+      if(x2<=sc.x || sc.x1<=x1 || y2<=sc.y || sc.y1<=y1)
+        return;
+      implAddPoint(x1,y1, u1,v1);
+      implAddPoint(x2,y1, u2,v1);
+      implAddPoint(x2,y2, u2,v2);
+
+      implAddPoint(x1,y1, u1,v1);
+      implAddPoint(x2,y2, u2,v2);
+      implAddPoint(x1,y2, u1,v2);
+      return;
+      }
+
     float invW = (u2-u1)/float(x2-x1);
     float invH = (v2-v1)/float(y2-y1);
 
-    ScissorRect& sc = s.scRect;
     if(x1<sc.x){
       int dx=sc.x-x1;
       x1+=dx;
@@ -409,6 +474,7 @@ void Painter::drawLine(int ix1, int iy1, int ix2, int iy2) {
     }
 
   if(state!=StPen){
+    implFlush();
     dev.setTopology(Lines);
     state=StPen;
     implPen(s.pn);
@@ -444,6 +510,7 @@ void Painter::pushState() {
 void Painter::popState() {
   s = std::move(stStk.back());
   stStk.pop_back();
+  implScissor();
   switch(state) {
     case StNo: break;
     case StBrush: implBrush(s.br); break;
@@ -454,26 +521,27 @@ void Painter::popState() {
 void Painter::drawText(int x, int y, const char *txt) {
   if(txt==nullptr)
     return;
-  auto pb=s.br;
-  Utf8Iterator i(txt);
-  while(i.hasData()) {
-    auto c=i.next();
-    if(c=='\0'){
-      setBrush(pb);
-      return;
-      }
-    auto l=s.fnt.letter(c,ta);
-
-    if(!l.view.isEmpty()) {
-      setBrush(Brush(l.view,pb.color,PaintDevice::Alpha));
-      drawRect(x+l.dpos.x,y+l.dpos.y,l.view.w(),l.view.h());
-      }
+  drawText(x,y,s.fnt.layout(txt,ta));
+  }
 
-    x += l.advance.x;
-    }
+void Painter::drawText(int x, int y, const TextLayout& txt) {
+  if(txt.isEmpty())
+    return;
+  auto pb=s.br;
+  for(auto& g:txt.data->glyph)
+    implDrawGlyph(x+g.pos.x,y+g.pos.y,g.view,g.size,pb,PaintDevice::Alpha,txt.data->sdf);
   setBrush(pb);
   }
 
+void Painter::implDrawGlyph(int x, int y, const Sprite& view, const Size& sz,
+                            const Brush& pb, Blend blend, bool sdf) {
+  Brush b(view,pb.color,blend);
+  b.sdf = sdf;
+  setBrush(b);
+  // sdf glyph is scaled: sz may differ from sprite size
+  drawRect(x,y,sz.w,sz.h, 0,0,view.w(),view.h());
+  }
+
 void Painter::drawText(int x, int y, const char16_t *txt) {
   if(txt==nullptr)
     return;
@@ -482,10 +550,8 @@ void Painter::drawText(int x, int y, const char16_t *txt) {
   for(;*txt;++txt) {
     auto& l=s.fnt.letter(*txt,ta);
 
-    if(!l.view.isEmpty()) {
-      setBrush(Brush(l.view,pb.color,pb.blend));
-      drawRect(x+l.dpos.x,y+l.dpos.y,l.view.w(),l.view.h());
-      }
+    if(!l.view.isEmpty())
+      implDrawGlyph(x+l.dpos.x,y+l.dpos.y,l.view,l.size,pb,pb.blend,s.fnt.isSdf());
 
     x += l.advance.x;
     }
@@ -530,7 +596,7 @@ static Utf8Iterator advanceByLine(Utf8Iterator i, int& x, int w, const Font& fnt
       break;
       }
     auto l=fnt.letter(c,ta);
-    if(x+l.dpos.x+l.view.w()>=w && wordCount>1)
+    if(x+l.dpos.x+l.size.w>=w && wordCount>1)
       break;
     x += l.advance.x;
     i = eow;
@@ -588,6 +654,26 @@ static int calcTextHeight(const char* txt, const int w, int& l0, const Font& fnt
 void Painter::drawText(int rx, int ry, int w, int h, const char *txt, AlignFlag flg) {
   if(txt==nullptr)
     return;
+  if(std::strpbrk(txt,"\r\n")==nullptr) {
+    // single line, that fits without wrapping: draw cached layout
+    auto lt = s.fnt.layout(txt,ta);
+    const int tw = lt.size().w;
+    if(tw<w) {
+      const int l0 = lt.isEmpty() ? 0 : lt.data->bottom;
+      int x = 0, y = 0;
+      if(flg & AlignHCenter)
+        x = (w-tw)/2;
+      else if(flg & AlignRight)
+        x = (w-tw);
+      if(flg & AlignVCenter)
+        y = l0+(h-l0)/2;
+      else if(flg & AlignBottom)
+        y = h;
+      drawText(rx+x,ry+y,lt);
+      return;
+      }
+    }
+
   auto pb=s.br;
   int  x = 0, y = 0, pSz = int(std::ceil(s.fnt.pixelSize()));
 
@@ -628,12 +714,8 @@ void Painter::drawText(int rx, int ry, int w, int h, const char *txt, AlignFlag
         continue;
       auto l=s.fnt.letter(c,ta);
 
-      if(!l.view.isEmpty()) {
-        setBrush(Brush(l.view,pb.color,PaintDevice::Alpha));
-        drawRect(rx+x+l.dpos.x,
-                 ry+y+l.dpos.y,
-                 l.view.w(),l.view.h());
-        }
+      if(!l.view.isEmpty())
+        implDrawGlyph(rx+x+l.dpos.x,ry+y+l.dpos.y,l.view,l.size,pb,PaintDevice::Alpha,s.fnt.isSdf());
 
       x += l.advance.x;
       }
@@ -71,6 +71,7 @@ class Painter {
 
     void drawText(int x,int y,const std::string& txt);
     void drawText(int x,int y,const std::u16string& txt);
+    void drawText(int x,int y,const TextLayout& txt);
 
     void drawText(int x,int y,int w,int h,const char* txt,AlignFlag flg=NoAlign);
     void drawText(int x,int y,int w,int h,const std::string& txt,AlignFlag flg=NoAlign);
@@ -110,11 +111,28 @@ class Painter {
       float dV      =0.f;
       };
 
+    // device state, that was set by last implBrush/implPen
+    struct DevState {
+      Brush::TexPtr      tex;
+      const void*        page  = nullptr;
+      Blend              blend = NoBlend;
+      bool               sdf   = false;
+      bool               valid = false;
+      };
+
+    enum : size_t {
+      BatchSize = 256
+      };
+
     PaintDevice&       dev;
     TextureAtlas&      ta;
     PaintDevice::Point pt;
+    PaintDevice::Point batch[BatchSize];
+    size_t             batchSize=0;
+    DevState           devSt;
 
     State              state=StNo;
+    bool               hwScissor=false;
     InternalState      s;
     std::vector<InternalState> stStk;
 
@@ -129,6 +147,9 @@ class Painter {
     void implAddPoint(float x, float y, float u, float v);
     void implAddPoint(int   x, int   y, float u, float v);
     void implSetColor(float r,float g,float b,float a);
+    void implSetState(const Brush::TexPtr& tex, const void* page, Blend blend, bool sdf);
+    void implFlush();
+    void implScissor();
 
     void implDrawTrig( float x0, float y0, float u0, float v0,
                        float x1, float y1, float u1, float v1,
@@ -136,6 +157,8 @@ class Painter {
                        FPoint *out, int stage);
     void implDrawRect(int x1, int y1, int x2, int y2,
                       float u1, float v1, float u2, float v2);
+    void implDrawGlyph(int x, int y, const Sprite& view, const Size& sz,
+                       const Brush& pb, Blend blend, bool sdf);
 
   friend class Font;
   };
@@ -6,6 +6,8 @@
 #include <Tempest/Event>
 #include <Tempest/Encoder>
 
+#include <algorithm>
+
 #define  NANOSVG_IMPLEMENTATION
 #include "thirdparty/nanosvg.h"
 
@@ -13,7 +15,7 @@ using namespace Tempest;
 
 void VectorImage::beginPaint(bool clr, uint32_t w, uint32_t h) {
   if(clr || blocks.size()==0)
-    clear();
+    discard();
   if(clr) {
     info.w=w;
     info.h=h;
@@ -25,9 +27,52 @@ void VectorImage::endPaint() {
   paintScope--;
   if(paintScope!=0)
     return;
-  for(size_t i=0;i<frameCount;++i)
-    frame[i].outdated=true;
+  invalidate();
+  }
+
+void VectorImage::invalidate() {
+  for(size_t i=0;i<frameCount;++i) {
+    auto& f = frame[i];
+    f.pending.insert(f.pending.end(),dirty.begin(),dirty.end());
+    if(f.pending.size()>256) {
+      // too fragmented - upload as one range
+      Range r = f.pending[0];
+      for(auto& i:f.pending) {
+        r.begin = std::min(r.begin,i.begin);
+        r.end   = std::max(r.end,  i.end);
+        }
+      f.pending.resize(1);
+      f.pending[0] = r;
+      }
+    f.outdated=true;
+    }
+  dirty.clear();
   outdatedCount=frameCount;
+  replayed     =false;
+  }
+
+void VectorImage::setVertexFormat(VertexFormat vf) {
+  if(vertexFormat==vf)
+    return;
+  vertexFormat = vf;
+  // pipelines and buffers are format-specific: rebuild on next draw
+  frame.reset();
+  frameCount = 0;
+  for(auto& b:blocks)
+    b.pipeline = PipePtr();
+  for(auto& b:prevBlocks)
+    b.pipeline = PipePtr();
+  }
+
+void VectorImage::markDirty(size_t begin, size_t end) {
+  if(dirty.size()>0 && dirty.back().end==begin) {
+    dirty.back().end = end;
+    return;
+    }
+  Range r;
+  r.begin = begin;
+  r.end   = end;
+  dirty.push_back(r);
   }
 
 size_t VectorImage::pushState() {
@@ -90,17 +135,55 @@ void VectorImage::setBlend(const Painter::Blend b) {
   setState<Painter::Blend,&State::blend>(b);
   }
 
+void VectorImage::setSdf(bool sdf) {
+  setState<bool,&State::sdf>(sdf);
+  }
+
+bool VectorImage::setScissor(const Rect& sc) {
+  Clip c;
+  c.enable = true;
+  c.rect   = sc;
+  setState<Clip,&State::clip>(c);
+  return true;
+  }
+
 void VectorImage::clear() {
+  // keep geometry of the previous paint, to replay widgets, that are not changed
+  std::swap(buf,   prevBuf);
+  std::swap(blocks,prevBlocks);
+  std::swap(cache, prevCache);
+
+  prevCacheId.clear();
+  for(size_t i=0;i<prevCache.size();++i)
+    if(prevCache[i].valid)
+      prevCacheId[prevCache[i].key.id] = i;
+
+  cache.clear();
+  discard();
+  }
+
+void VectorImage::discard() {
   buf.clear();
   blocks.resize(1);
   blocks.back()=Block();
   stateStk.clear();
   slock.clear();
+  for(auto& i:cache)
+    i.valid = false;
   }
 
 void VectorImage::addPoint(const PaintDevice::Point &p) {
+  const size_t id = buf.size();
   buf.push_back(p);
   blocks.back().size++;
+  markDirty(id,id+1);
+  }
+
+void VectorImage::addPoints(const PaintDevice::Point* p, size_t count) {
+  const size_t id = buf.size();
+  buf.insert(buf.end(),p,p+count);
+  blocks.back().size += count;
+  markDirty(id,id+count);
   }
 
 void VectorImage::commitPoints() {
@@ -113,18 +196,109 @@ void VectorImage::commitPoints() {
     }
   }
 
-void VectorImage::makeActual(Device &dev,Swapchain& sw) {
+size_t VectorImage::beginCache() {
+  if(blocks.size()==0)
+    discard();
+  Cache c;
+  c.blkBegin = blocks.size()-1;
+  c.ptBegin  = buf.size();
+  cache.push_back(c);
+  return cache.size()-1;
+  }
+
+void VectorImage::endCache(size_t id, const CacheKey& k) {
+  Cache& c = cache[id];
+  if(!c.valid)
+    return;
+  // commitPoints may drop trailing blocks: find first block, that may hold points of this region
+  c.blkBegin = std::min(c.blkBegin,blocks.size()-1);
+  while(c.blkBegin>0 && blocks[c.blkBegin].begin>c.ptBegin)
+    c.blkBegin--;
+  c.key      = k;
+  c.blkEnd   = blocks.size();
+  c.ptEnd    = buf.size();
+  c.last     = blocks.back();
+  c.last.size = 0;
+  }
+
+bool VectorImage::restoreCache(const CacheKey& k) {
+  auto it = prevCacheId.find(k.id);
+  if(it==prevCacheId.end())
+    return false;
+  const Cache& c = prevCache[it->second];
+  if(!(c.key==k))
+    return false;
+
+  const size_t id  = beginCache();
+  const size_t pos = buf.size();
+  buf.insert(buf.end(),prevBuf.begin()+int(c.ptBegin),prevBuf.begin()+int(c.ptEnd));
+  if(pos!=c.ptBegin)
+    markDirty(pos,buf.size());
+
+  for(size_t i=c.blkBegin;i<c.blkEnd;++i) {
+    auto&  b     = prevBlocks[i];
+    size_t begin = std::max(b.begin,       c.ptBegin);
+    size_t end   = std::min(b.begin+b.size,c.ptEnd);
+    if(begin>=end)
+      continue;
+    appendBlock(b,begin-c.ptBegin+pos,end-begin);
+    }
+
+  if(!(c.last==blocks.back()))
+    appendBlock(c.last,buf.size(),0);
+
+  endCache(id,k);
+  replayed = true;
+  return true;
+  }
+
+void VectorImage::appendBlock(const Block& b, size_t begin, size_t size) {
+  Block& bk = blocks.back();
+  if(bk==b && bk.begin+bk.size==begin) {
+    bk.size += size;
+    return;
+    }
+  if(bk.size==0) {
+    bk = b;
+    } else {
+    blocks.push_back(b);
+    }
+  blocks.back().begin = begin;
+  blocks.back().size  = size;
+  if(!b.tex.sprite.isEmpty())
+    slock.insert(b.tex.sprite);
+  }
+
+void VectorImage::makeActual(Device &dev,uint8_t frameId) {
+  if(replayed)
+    invalidate();
   if(!frame || frameCount!=dev.maxFramesInFlight()) {
     uint8_t count=dev.maxFramesInFlight();
     frame.reset(new PerFrame[count]);
     frameCount=count;
     }
 
-  PerFrame& f=frame[sw.frameId()];
+  PerFrame& f=frame[frameId];
   if(f.outdated) {
-    if(f.vbo.size()==buf.size())
-      f.vbo.update(buf); else
-      f.vbo=dev.vboDyn(buf);
+    // grow with headroom: growing image should not re-create buffers every frame
+    const size_t capacity = buf.size()+buf.size()/2;
+    if(vertexFormat==VF_Packed) {
+      if(f.vboP.size()<buf.size()) {
+        pack(0,buf.size());
+        f.vboP=dev.vboDyn<PointPacked>(nullptr,capacity);
+        f.vboP.update(packBuf.data(),0,packBuf.size());
+        } else {
+        commitPending(f);
+        }
+      } else {
+      if(f.vbo.size()<buf.size()) {
+        f.vbo=dev.vboDyn<Point>(nullptr,capacity);
+        f.vbo.update(buf.data(),0,buf.size());
+        } else {
+        commitPending(f);
+        }
+      }
+    f.pending.clear();
 
     f.blocksType.resize(blocks.size());
     f.blocks    .resize(blocks.size());
@@ -160,56 +334,117 @@ void VectorImage::makeActual(Device &dev,Swapchain& sw) {
             ux.set(0,b.tex.brush);
             }
           } else {
-          ux.set(0,b.tex.sprite.pageRawData(dev)); //TODO: oom
+          auto& t = b.tex.sprite.pageRawData(dev);
+          if(t.format()==TextureFormat::R8) {
+            // glyph mask page
+            Sampler2d s = Sampler2d::anisotrophy();
+            s.mapping.r = ComponentSwizzle::One;
+            s.mapping.g = ComponentSwizzle::One;
+            s.mapping.b = ComponentSwizzle::One;
+            s.mapping.a = ComponentSwizzle::R;
+            ux.set(0,t,s);
+            } else {
+            ux.set(0,t);
+            }
           }
         }
       }
 
     f.outdated=false;
     outdatedCount--;
-    if(outdatedCount==0)
-      buf.clear();
     }
   }
 
-const RenderPipeline& VectorImage::pipelineOf(Device& dev, const VectorImage::Block& b) {
-  const RenderPipeline* p;
-  if(b.hasImg) {
-    if(b.tp==Triangles){
-      if(b.blend==NoBlend)
-        p=&dev.builtin().texture2d().brush; else
-      if(b.blend==Alpha)
-        p=&dev.builtin().texture2d().brushB; else
-        p=&dev.builtin().texture2d().brushA;
-      } else {
-      if(b.blend==NoBlend)
-        p=&dev.builtin().texture2d().pen; else
-      if(b.blend==Alpha)
-        p=&dev.builtin().texture2d().penB; else
-        p=&dev.builtin().texture2d().penA;
-      }
-    } else {
-    if(b.tp==Triangles) {
-      if(b.blend==NoBlend)
-        p=&dev.builtin().empty().brush; else
-      if(b.blend==Alpha)
-        p=&dev.builtin().empty().brushB; else
-        p=&dev.builtin().empty().brushA;
+void VectorImage::commitPending(PerFrame& f) {
+  auto& p = f.pending;
+  std::sort(p.begin(),p.end(),[](const Range& a,const Range& b){ return a.begin<b.begin; });
+
+  size_t i=0;
+  while(i<p.size()) {
+    Range r = p[i];
+    for(++i; i<p.size() && p[i].begin<=r.end; ++i)
+      r.end = std::max(r.end,p[i].end);
+    r.end = std::min(r.end,buf.size());
+    if(r.begin>=r.end)
+      continue;
+    if(vertexFormat==VF_Packed) {
+      pack(r.begin,r.end);
+      f.vboP.update(packBuf.data(),r.begin,r.end-r.begin);
       } else {
-      if(b.blend==NoBlend)
-        p=&dev.builtin().empty().pen; else
-      if(b.blend==Alpha)
-        p=&dev.builtin().empty().penB; else
-        p=&dev.builtin().empty().penA;
+      f.vbo.update(buf.data()+r.begin,r.begin,r.end-r.begin);
       }
     }
-  return *p;
+  }
+
+void VectorImage::pack(size_t begin, size_t end) {
+  auto unorm16 = [](float v) -> uint16_t {
+    return uint16_t(std::min(std::max(v,0.f),1.f)*65535.f+0.5f);
+    };
+  auto unorm8  = [](float v) -> uint8_t {
+    return uint8_t(std::min(std::max(v,0.f),1.f)*255.f+0.5f);
+    };
+
+  packBuf.resize(end-begin);
+  for(size_t i=begin;i<end;++i) {
+    const Point& p = buf[i];
+    PointPacked& r = packBuf[i-begin];
+    r.x = p.x;
+    r.y = p.y;
+    r.u = unorm16(p.u);
+    r.v = unorm16(p.v);
+    r.r = unorm8(p.r);
+    r.g = unorm8(p.g);
+    r.b = unorm8(p.b);
+    r.a = unorm8(p.a);
+    }
+  }
+
+const RenderPipeline& VectorImage::pipelineOf(Device& dev, const VectorImage::Block& b) {
+  const Builtin&       bi = dev.builtin();
+  const Builtin::Item* it;
+  if(b.hasImg && b.sdf)
+    it = vertexFormat==VF_Packed ? &bi.sdfPacked() : &bi.sdf(); else
+  if(vertexFormat==VF_Packed)
+    it = b.hasImg ? &bi.texture2dPacked() : &bi.emptyPacked(); else
+    it = b.hasImg ? &bi.texture2d()       : &bi.empty();
+
+  if(b.tp==Triangles) {
+    if(b.blend==NoBlend)
+      return it->brush;
+    if(b.blend==Alpha)
+      return it->brushB;
+    return it->brushA;
+    }
+  if(b.blend==NoBlend)
+    return it->pen;
+  if(b.blend==Alpha)
+    return it->penB;
+  return it->penA;
   }
 
 void VectorImage::draw(Device& dev, Swapchain& sw, Encoder<CommandBuffer> &cmd) {
-  makeActual(dev,sw);
+  draw(dev,sw.frameId(),sw.w(),sw.h(),cmd);
+  }
+
+// clip rects are recorded in pixels of painted image; geometry is in normalized coordinates
+static Rect scaleClip(const Rect& r, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH) {
+  if(srcW==0 || srcH==0 || (srcW==dstW && srcH==dstH))
+    return r;
+  // round outwards: pixels, that are partially covered, are not clipped
+  const int64_t x0 = (int64_t(r.x)*dstW)/srcW;
+  const int64_t y0 = (int64_t(r.y)*dstH)/srcH;
+  const int64_t x1 = (int64_t(r.x+r.w)*dstW+srcW-1)/srcW;
+  const int64_t y1 = (int64_t(r.y+r.h)*dstH+srcH-1)/srcH;
+  return Rect(int(x0),int(y0),int(x1-x0),int(y1-y0));
+  }
+
+void VectorImage::draw(Device& dev, uint8_t frameId, uint32_t w, uint32_t h, Encoder<CommandBuffer> &cmd) {
+  makeActual(dev,frameId);
 
-  PerFrame& f=frame[sw.frameId()];
+  PerFrame& f=frame[frameId];
+
+  const Rect full = Rect(0,0,int(w),int(h));
+  Rect       sc   = full;
 
   for(size_t i=0;i<blocks.size();++i){
     auto& b=blocks[i];
@@ -222,11 +457,22 @@ void VectorImage::draw(Device& dev, Swapchain& sw, Encoder<CommandBuffer> &cmd)
       b.pipeline=PipePtr(pipelineOf(dev,b));
       }
 
+    const Rect bsc = b.clip.enable ? scaleClip(b.clip.rect,info.w,info.h,w,h) : full;
+    if(!(bsc==sc)) {
+      cmd.setScissor(bsc);
+      sc = bsc;
+      }
+
     if(b.hasImg)
       cmd.setUniforms(b.pipeline,u); else
       cmd.setUniforms(b.pipeline);
-    cmd.draw(f.vbo,b.begin,b.size);
+    if(vertexFormat==VF_Packed)
+      cmd.draw(f.vboP,b.begin,b.size); else
+      cmd.draw(f.vbo, b.begin,b.size);
     }
+
+  if(!(sc==full))
+    cmd.setScissor(full);
   }
 
 bool VectorImage::load(const char *file) {
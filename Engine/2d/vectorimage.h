@@ -7,6 +7,7 @@
 #include <Tempest/Sprite>
 
 #include <vector>
+#include <unordered_map>
 
 namespace Tempest {
 
@@ -16,17 +17,30 @@ class Encoder;
 
 class VectorImage : public Tempest::PaintDevice {
   public:
+    enum VertexFormat : uint8_t {
+      VF_Float,  // PaintDevice::Point
+      VF_Packed, // PaintDevice::PointPacked
+      };
+
     VectorImage()=default;
+    explicit VectorImage(VertexFormat vf):vertexFormat(vf){}
 
-    uint32_t w() const { return info.w; }
-    uint32_t h() const { return info.h; }
+    uint32_t     w() const { return info.w; }
+    uint32_t     h() const { return info.h; }
 
+    void         setVertexFormat(VertexFormat vf);
+    VertexFormat format() const { return vertexFormat; }
+
+    // image is stretched to the target; scissor rects of painter are scaled by target size / w(),h()
     void     draw(Device& dev, Swapchain& sw, Encoder<CommandBuffer> &cmd);
+    // offscreen target of w x h; frameId in range [0..Device::maxFramesInFlight)
+    void     draw(Device& dev, uint8_t frameId, uint32_t w, uint32_t h, Encoder<CommandBuffer> &cmd);
     bool     load(const char* path);
     void     clear() override;
 
   private:
     void   addPoint(const Point& p) override;
+    void   addPoints(const Point* p, size_t count) override;
     void   commitPoints() override;
 
     void   beginPaint(bool clear,uint32_t w,uint32_t h) override;
@@ -39,6 +53,12 @@ class VectorImage : public Tempest::PaintDevice {
     void   setState(const Sprite& s, const Color& c) override;
     void   setTopology(Topology t) override;
     void   setBlend(const Blend b) override;
+    void   setSdf(bool sdf) override;
+    bool   setScissor(const Rect& sc) override;
+
+    size_t beginCache() override;
+    void   endCache(size_t id, const CacheKey& k) override;
+    bool   restoreCache(const CacheKey& k) override;
 
     struct SpriteLock {
       std::vector<Sprite> spr;
@@ -66,13 +86,24 @@ class VectorImage : public Tempest::PaintDevice {
         }
       };
 
+    struct Clip {
+      bool           enable=false;
+      Rect           rect;
+
+      bool     operator==(const Clip& c) const {
+        return enable==c.enable && rect==c.rect;
+        }
+      };
+
     struct State {
       Topology       tp    =Triangles;
       Blend          blend =NoBlend;
       Texture        tex;
+      Clip           clip;
+      bool           sdf   =false;
 
       bool operator == (const State& s) const {
-        return tp==s.tp && blend==s.blend && tex==s.tex;
+        return tp==s.tp && blend==s.blend && tex==s.tex && clip==s.clip && sdf==s.sdf;
         }
       };
 
@@ -96,10 +127,25 @@ class VectorImage : public Tempest::PaintDevice {
       bool           hasImg=false;
       };
 
+    struct Range {
+      size_t begin=0;
+      size_t end  =0;
+      };
+
+    struct Cache {
+      CacheKey       key;
+      size_t         blkBegin=0, blkEnd=0;
+      size_t         ptBegin =0, ptEnd =0;
+      Block          last;
+      bool           valid=true;
+      };
+
     struct PerFrame {
-      Tempest::VertexBufferDyn<Point> vbo;
+      Tempest::VertexBufferDyn<Point>       vbo;
+      Tempest::VertexBufferDyn<PointPacked> vboP;
       std::vector<Uniforms>           blocks;
       std::vector<UboType>            blocksType;
+      std::vector<Range>              pending;
       bool                            outdated=true;
       };
 
@@ -108,19 +154,37 @@ class VectorImage : public Tempest::PaintDevice {
     size_t                      outdatedCount=0;
 
     Topology                    topology=Triangles;
+    VertexFormat                vertexFormat=VF_Float;
 
     std::vector<State>          stateStk;
     std::vector<Block>          blocks;
     std::vector<Point>          buf;
+    std::vector<PointPacked>    packBuf;
     SpriteLock                  slock;
+    std::vector<Cache>          cache;
+    std::vector<Range>          dirty;
+
+    // geometry of previous paint, source for restoreCache
+    std::vector<Block>          prevBlocks;
+    std::vector<Point>          prevBuf;
+    std::vector<Cache>          prevCache;
+    std::unordered_map<uint64_t,size_t> prevCacheId;
 
     struct Info {
       uint32_t w=0,h=0;
       };
     Info   info;
     size_t paintScope = 0;
-
-    void makeActual(Device& dev, Swapchain& sw);
+    // geometry was replayed outside of painter: invalidate before next draw
+    bool   replayed   = false;
+
+    void discard();
+    void markDirty(size_t begin, size_t end);
+    void invalidate();
+    void appendBlock(const Block& b, size_t begin, size_t size);
+    void makeActual(Device& dev, uint8_t frameId);
+    void commitPending(PerFrame& f);
+    void pack(size_t begin, size_t end);
 
     const RenderPipeline& pipelineOf(Device& dev, const Block& b);
 
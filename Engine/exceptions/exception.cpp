@@ -52,6 +52,10 @@ std::string GraphicsErrCategory::message(int ev) const {
       return "Invalid buffer update";
     case GraphicsErrc::TooLardgeUbo:
       return "Uniform buffer element is too large";
+    case GraphicsErrc::UnsupportedFeature:
+      return "Feature is not supported by device";
+    case GraphicsErrc::InvalidIndirectRange:
+      return "Indirect draw range is out of buffer bounds";
     }
   return "(unrecognized error)";
   }
@@ -16,6 +16,22 @@ class ConcurentRecordingException : std::exception {
   const char* what() const noexcept override { return "the command buffer is already in recording state"; }
   };
 
+class IncompatibleBundleException : std::exception {
+  const char* what() const noexcept override { return "the command bundle is empty or incompatible with current framebuffer"; }
+  };
+
+class MixedPassContentException : std::exception {
+  const char* what() const noexcept override { return "render pass can not mix inline commands and command bundles"; }
+  };
+
+class NoRenderPassException : std::exception {
+  const char* what() const noexcept override { return "draw command is recorded without framebuffer"; }
+  };
+
+class NoComputePipelineException : std::exception {
+  const char* what() const noexcept override { return "dispatch is recorded without compute pipeline"; }
+  };
+
 enum class SystemErrc {
   InvalidWindowClass   = 0,
   UnableToCreateWindow = 1,
@@ -46,6 +62,8 @@ enum class GraphicsErrc {
   InvalidTexture           = 6,
   InvalidBufferUpdate      = 7,
   TooLardgeUbo             = 8,
+  UnsupportedFeature       = 9,
+  InvalidIndirectRange     = 10,
   };
 
 struct GraphicsErrCategory : std::error_category {
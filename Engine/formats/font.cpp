@@ -8,8 +8,13 @@
 #include "thirdparty/stb_truetype.h"
 
 #include <unordered_map>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <list>
 #include <bitset>
 #include <algorithm>
+#include <cmath>
 
 #ifdef __WINDOWS__
 #include <Shlobj.h>
@@ -19,15 +24,20 @@ using namespace Tempest;
 
 namespace Tempest {
 namespace Detail {
+  // insert-only trie: published pointers are never changed or freed until table is destroyed
   template<size_t lvl>
   struct Bucket {
-    std::unique_ptr<Bucket<lvl-1>> next[256];
+    std::atomic<Bucket<lvl-1>*> next[256]={};
+
+    ~Bucket() {
+      for(auto& i:next)
+        delete i.load(std::memory_order_relaxed);
+      }
     };
 
   template<>
   struct Bucket<1> {
-    FontElement::Letter     letter[256];
-    std::bitset<256>        ex;
+    std::atomic<const FontElement::Letter*> letter[256]={};
     };
 
   static std::string getFontFolderPath() {
@@ -51,65 +61,183 @@ namespace Detail {
 
 }
 
+// readers (find) are lock-free, writers (insert, evict) must be serialized by caller
+// published letters are never modified: evict unpublishes them and releases views one frame later
 struct FontElement::LetterTable {
   struct Chunk {
     uint32_t          size=0;
     Detail::Bucket<3> next[256];
+    Chunk*            prev=nullptr;
+    };
+
+  struct Slot {
+    Letter   letter;
+    uint32_t size=0;
+    uint32_t ch  =0;
     };
 
-  std::vector<Chunk> chunk;
+  struct Retired {
+    Slot*               slot =nullptr;
+    const TextureAtlas* atlas=nullptr;
+    uint32_t            frame=0;
+    };
 
-  Letter& at(float sz,char32_t ch){
-    return *implFind(sz,ch,true);
+  std::atomic<Chunk*>  chunk{nullptr};
+  std::deque<Slot>     letters;
+  std::vector<Slot*>   freeSlots;
+  std::vector<Retired> retired;
+
+  ~LetterTable() {
+    Chunk* c = chunk.load(std::memory_order_relaxed);
+    while(c!=nullptr) {
+      Chunk* p = c->prev;
+      delete c;
+      c = p;
+      }
     }
 
-  Letter* find(float sz,char32_t ch){
-    return implFind(sz,ch,false);
+  const Letter* find(float sz,char32_t ch) const {
+    const uint32_t size = uint32_t(sz*100);
+    for(const Chunk* c=chunk.load(std::memory_order_acquire); c!=nullptr; c=c->prev)
+      if(c->size==size)
+        return implFind(*c,uint32_t(ch));
+    return nullptr;
     }
 
-  Letter* implFind(float sz,char32_t ch,bool create){
-    uint32_t size = uint32_t(sz*100);
+  const Letter& insert(float sz,char32_t ch,const Letter& l) {
+    const uint32_t size = uint32_t(sz*100);
+    Chunk* c = chunk.load(std::memory_order_relaxed);
+    while(c!=nullptr && c->size!=size)
+      c = c->prev;
+    if(c==nullptr) {
+      c = new Chunk();
+      c->size = size;
+      c->prev = chunk.load(std::memory_order_relaxed);
+      chunk.store(c,std::memory_order_release);
+      }
 
-    for(auto& i:chunk)
-      if(i.size==size)
-        return implFind(i,uint32_t(ch),create);
+    Slot* sl = nullptr;
+    if(!freeSlots.empty()) {
+      sl = freeSlots.back();
+      freeSlots.pop_back();
+      } else {
+      letters.emplace_back();
+      sl = &letters.back();
+      }
+    sl->letter = l;
+    sl->size   = size;
+    sl->ch     = uint32_t(ch);
+
+    const Letter* lt  = &sl->letter;
+    auto          k   = reinterpret_cast<const uint8_t*>(&sl->ch);
+    implInsert(c->next[k[0]],k+1,lt);
+    return *lt;
+    }
 
-    chunk.emplace_back();
-    chunk.back().size=size;
-    return implFind(chunk.back(),uint32_t(ch),create);
+  // unpublishes letters with stale views; geometry and view are generated again on next lookup
+  // letter references, taken before frame of atlas is advanced, stay valid until next evict
+  template<class Pred>
+  size_t evict(const TextureAtlas& atlas, bool detached, Pred stale) {
+    const uint32_t frame = atlas.frame();
+    for(auto i=retired.begin();i!=retired.end();) {
+      if(i->atlas==&atlas && (detached || i->frame<frame)) {
+        i->slot->letter = Letter();
+        freeSlots.push_back(i->slot);
+        i = retired.erase(i);
+        } else {
+        ++i;
+        }
+      }
+
+    size_t n = 0;
+    for(auto& sl:letters) {
+      if(!sl.letter.hasView || !stale(sl.letter.view))
+        continue;
+      Chunk* c = chunk.load(std::memory_order_relaxed);
+      while(c->size!=sl.size)
+        c = c->prev;
+      auto k = reinterpret_cast<const uint8_t*>(&sl.ch);
+      if(implFind(c->next[k[0]],k+1)!=&sl.letter)
+        continue; // retired already, or replaced
+      implErase(c->next[k[0]],k+1);
+      if(detached) {
+        sl.letter = Letter();
+        freeSlots.push_back(&sl);
+        } else {
+        retired.push_back(Retired{&sl,&atlas,frame});
+        }
+      ++n;
+      }
+    return n;
     }
 
-  Letter* implFind(Chunk& c,uint32_t ch,bool create){
-    uint8_t* key = reinterpret_cast<uint8_t*>(&ch);
-    auto&    b   = c.next[*key];
-    return implFind(b,key+1,create);
+  static const Letter* implFind(const Chunk& c,uint32_t ch){
+    auto key = reinterpret_cast<const uint8_t*>(&ch);
+    return implFind(c.next[*key],key+1);
     }
 
   template<size_t lvl>
-  Letter* implFind(Detail::Bucket<lvl>& b,const uint8_t* k,bool create){
-    auto& ptr = b.next[*k];
-    if(ptr==nullptr && create)
-      ptr.reset(new Detail::Bucket<lvl-1>());
+  static const Letter* implFind(const Detail::Bucket<lvl>& b,const uint8_t* k){
+    auto ptr = b.next[*k].load(std::memory_order_acquire);
     if(ptr==nullptr)
       return nullptr;
-    return implFind(*b.next[*k],k+1,create);
+    return implFind(*ptr,k+1);
     }
 
-  Letter* implFind(Detail::Bucket<1>& b,const uint8_t* pk,bool create){
-    auto k = *pk;
-    if(!b.ex[k]){
-      if(create){
-        b.ex[k]=true;
-        return &b.letter[k];
-        }
-      return nullptr;
+  static const Letter* implFind(const Detail::Bucket<1>& b,const uint8_t* k){
+    return b.letter[*k].load(std::memory_order_acquire);
+    }
+
+  template<size_t lvl>
+  static void implInsert(Detail::Bucket<lvl>& b,const uint8_t* k,const Letter* lt){
+    auto ptr = b.next[*k].load(std::memory_order_relaxed);
+    if(ptr==nullptr) {
+      ptr = new Detail::Bucket<lvl-1>();
+      b.next[*k].store(ptr,std::memory_order_release);
       }
-    return &b.letter[k];
+    implInsert(*ptr,k+1,lt);
+    }
+
+  static void implInsert(Detail::Bucket<1>& b,const uint8_t* k,const Letter* lt){
+    b.letter[*k].store(lt,std::memory_order_release);
+    }
+
+  template<size_t lvl>
+  static void implErase(Detail::Bucket<lvl>& b,const uint8_t* k){
+    auto ptr = b.next[*k].load(std::memory_order_relaxed);
+    if(ptr!=nullptr)
+      implErase(*ptr,k+1);
+    }
+
+  static void implErase(Detail::Bucket<1>& b,const uint8_t* k){
+    b.letter[*k].store(nullptr,std::memory_order_release);
     }
   };
 
-struct FontElement::Impl {
-  enum { MIN_BUF_SZ=512 };
+struct FontElement::Impl : TextureAtlas::Cache {
+  enum { MIN_BUF_SZ=512, LAYOUT_CACHE_SZ=512, SDF_REF_SIZE=64, SDF_PADDING=6 };
+
+  // atlas address may be reused by another atlas; generation changes, when glyphs are moved or evicted
+  struct LayoutKey {
+    std::string   text;
+    uint32_t      size =0;
+    uint64_t      atlas=0;
+    uint32_t      gen  =0;
+    bool          sdf  =false;
+
+    bool operator == (const LayoutKey& k) const {
+      return size==k.size && atlas==k.atlas && gen==k.gen && sdf==k.sdf && text==k.text;
+      }
+    };
+
+  struct LayoutKeyHash {
+    size_t operator()(const LayoutKey& k) const {
+      return std::hash<std::string>()(k.text) ^ (size_t(k.size)*31+size_t(k.sdf)) ^
+             std::hash<uint64_t>()(k.atlas*31+k.gen);
+      }
+    };
+
+  using LayoutLru = std::list<std::pair<LayoutKey,TextLayout>>;
 
   template<class CharT>
   Impl(const CharT *filename) {
@@ -131,11 +259,59 @@ struct FontElement::Impl {
     stbtt_GetFontVMetrics(&info,&metrics0.ascent,&metrics0.descent,&lineGap);
     }
 
-  ~Impl() {
+  ~Impl() override {
+    for(auto i:atlases)
+      i->detach(*this);
     delete[] data;
     std::free(rasterBuf);
     }
 
+  // must be called with syncMem locked
+  void track(TextureAtlas& tex) {
+    if(std::find(atlases.begin(),atlases.end(),&tex)!=atlases.end())
+      return;
+    atlases.push_back(&tex);
+    tex.attach(*this);
+    }
+
+  void detached(TextureAtlas& atlas) override {
+    {
+    auto stale = [&](const Sprite& s){ return isStale(atlas,s,uint32_t(-1)); };
+    std::lock_guard<std::mutex> guard(syncMap);
+    map.evict(atlas,true,stale);
+    sdfMap.evict(atlas,true,stale);
+    }
+    dropLayouts(atlas);
+    std::lock_guard<std::mutex> guard(syncMem);
+    atlases.erase(std::remove(atlases.begin(),atlases.end(),&atlas),atlases.end());
+    }
+
+  size_t evict(const TextureAtlas& atlas, uint32_t frame) override {
+    auto   stale = [&](const Sprite& s){ return isStale(atlas,s,frame); };
+    size_t n     = 0;
+    {
+    std::lock_guard<std::mutex> guard(syncMap);
+    n += map.evict(atlas,false,stale);
+    n += sdfMap.evict(atlas,false,stale);
+    }
+    if(n>0)
+      dropLayouts(atlas);
+    return n;
+    }
+
+  // cached layouts hold glyph sprites as well
+  void dropLayouts(const TextureAtlas& atlas) {
+    std::lock_guard<std::mutex> guard(syncLayout);
+    for(auto i=layoutLru.begin();i!=layoutLru.end();) {
+      if(i->first.atlas==atlas.id()) {
+        layoutId.erase(i->first);
+        i = layoutLru.erase(i);
+        } else {
+        ++i;
+        }
+      }
+    }
+
   uint8_t* ttfMalloc(size_t sz){
     if(sz<rasterSz)
       return rasterBuf;
@@ -189,14 +365,12 @@ struct FontElement::Impl {
     }
 
   const Letter& letter(char32_t ch,float size,TextureAtlas* tex) {
-    {
-    std::lock_guard<std::mutex> guard(syncMap);
     auto cc=map.find(size,ch);
-    if(cc!=nullptr){
-      if(cc->hasView || tex==nullptr)
-        return *cc;
+    if(cc!=nullptr && (cc->hasView || tex==nullptr)) {
+      if(tex!=nullptr)
+        hit(*tex);
+      return *cc;
       }
-    }
 
     if(this->size==0)
       return nullLater();
@@ -217,9 +391,16 @@ struct FontElement::Impl {
     Sprite spr;
     if(tex!=nullptr){
       std::lock_guard<std::mutex> guard(syncMem);
+      // other thread may have rasterized this glyph already
+      auto cc=map.find(size,ch);
+      if(cc!=nullptr && cc->hasView)
+        return *cc;
       uint8_t* bitmap=getGlyphBitmapSubpixel(&info,scale,index,w,h,dx,dy);
-      if(bitmap!=nullptr)
+      if(bitmap!=nullptr) {
         spr = tex->load(bitmap,uint32_t(w),uint32_t(h),Pixmap::Format::R);
+        track(*tex);
+        miss(*tex);
+        }
       } else {
       int ix0=0,ix1=0,iy0=0,iy1=0;
       stbtt_GetGlyphBitmapBoxSubpixel(&info,index,scale,scale,0.f,0.f,&ix0,&iy0,&ix1,&iy1);
@@ -236,14 +417,90 @@ struct FontElement::Impl {
       return nullLater();
       }
 
-    std::lock_guard<std::mutex> guard(syncMap);
-    Letter& lt = map.at(size,ch);
+    Letter lt;
     lt.view    = std::move(spr);
     lt.size    = Size(w,h);
     lt.dpos    = Point(dx,dy);
     lt.advance = Point(int(ax*scale),int(lineGap*scale));
     lt.hasView = (tex!=nullptr);
-    return lt;
+
+    std::lock_guard<std::mutex> guard(syncMap);
+    auto cc=map.find(size,ch);
+    if(cc!=nullptr && (cc->hasView || !lt.hasView))
+      return *cc;
+    return map.insert(size,ch,lt);
+    }
+
+  const Letter& letterSdf(char32_t ch,float size,TextureAtlas& tex) {
+    auto cc=sdfMap.find(size,ch);
+    if(cc!=nullptr && cc->hasView) {
+      hit(tex);
+      return *cc;
+      }
+    if(this->size==0)
+      return nullLater();
+
+    const Letter& ref = allocSdfLetter(ch,tex);
+    if(size==float(SDF_REF_SIZE))
+      return ref;
+
+    const float scale = stbtt_ScaleForPixelHeight(&info,size);
+    const float k     = size/float(SDF_REF_SIZE);
+    int ax=0;
+    stbtt_GetGlyphHMetrics(&info,stbtt_FindGlyphIndex(&info,int(ch)),&ax,nullptr);
+
+    Letter lt;
+    lt.view    = ref.view;
+    lt.size    = Size (int(std::round(float(ref.size.w)*k)), int(std::round(float(ref.size.h)*k)));
+    lt.dpos    = Point(int(std::round(float(ref.dpos.x)*k)), int(std::round(float(ref.dpos.y)*k)));
+    lt.advance = Point(int(ax*scale),int(lineGap*scale));
+    lt.hasView = true;
+
+    std::lock_guard<std::mutex> guard(syncMap);
+    cc=sdfMap.find(size,ch);
+    if(cc!=nullptr && cc->hasView)
+      return *cc;
+    return sdfMap.insert(size,ch,lt);
+    }
+
+  const Letter& allocSdfLetter(char32_t ch,TextureAtlas& tex) {
+    const float size = float(SDF_REF_SIZE);
+    auto cc=sdfMap.find(size,ch);
+    if(cc!=nullptr && cc->hasView)
+      return *cc;
+
+    const float scale = stbtt_ScaleForPixelHeight(&info,size);
+    const int   index = stbtt_FindGlyphIndex(&info,int(ch));
+    int w=0,h=0,dx=0,dy=0,ax=0;
+    stbtt_GetGlyphHMetrics(&info,index,&ax,nullptr);
+
+    Sprite spr;
+    {
+    std::lock_guard<std::mutex> guard(syncMem);
+    cc=sdfMap.find(size,ch);
+    if(cc!=nullptr && cc->hasView)
+      return *cc;
+    uint8_t* bitmap = stbtt_GetGlyphSDF(&info,scale,index,SDF_PADDING,128,128.f/SDF_PADDING,&w,&h,&dx,&dy);
+    if(bitmap!=nullptr) {
+      spr = tex.load(bitmap,uint32_t(w),uint32_t(h),Pixmap::Format::R);
+      stbtt_FreeSDF(bitmap,info.userdata);
+      track(tex);
+      miss(tex);
+      }
+    }
+
+    Letter lt;
+    lt.view    = std::move(spr);
+    lt.size    = Size(w,h);
+    lt.dpos    = Point(dx,dy);
+    lt.advance = Point(int(ax*scale),int(lineGap*scale));
+    lt.hasView = true;
+
+    std::lock_guard<std::mutex> guard(syncMap);
+    cc=sdfMap.find(size,ch);
+    if(cc!=nullptr && cc->hasView)
+      return *cc;
+    return sdfMap.insert(size,ch,lt);
     }
 
   const Letter& allocFallbackLetter(char32_t ch,float size,TextureAtlas* tex) {
@@ -255,16 +512,67 @@ struct FontElement::Impl {
           throw std::system_error(Tempest::SystemErrc::UnableToLoadAsset);
         }
 
-      Letter  lf = fallback->allocLetter(ch,size,tex,true);
-      Letter& lt = map.at(size,ch);
-      lt = lf;
-      return lt;
+      Letter lf = fallback->allocLetter(ch,size,tex,true);
+      return map.insert(size,ch,lf);
       }
     catch (...) {
       return nullLater();
       }
     }
 
+  TextLayout layout(const char* text,float size,TextureAtlas& tex,bool sdf) {
+    LayoutKey key;
+    key.text  = text;
+    key.size  = uint32_t(size*100);
+    key.atlas = tex.id();
+    key.gen   = tex.generation();
+    key.sdf   = sdf;
+
+    {
+    std::lock_guard<std::mutex> guard(syncLayout);
+    auto it = layoutId.find(key);
+    if(it!=layoutId.end()) {
+      layoutLru.splice(layoutLru.begin(),layoutLru,it->second);
+      return it->second->second;
+      }
+    }
+
+    auto d = std::make_shared<TextLayout::Data>();
+    int  x = 0;
+    d->sdf = sdf;
+    Utf8Iterator i(text,key.text.size());
+    while(i.hasData()) {
+      char32_t c = i.next();
+      if(c=='\0')
+        break;
+      auto& l = sdf ? letterSdf(c,size,tex) : letter(c,size,&tex);
+      if(!l.view.isEmpty()) {
+        TextLayout::Glyph g;
+        g.view = l.view;
+        g.pos  = Point(x+l.dpos.x,l.dpos.y);
+        g.size = l.size;
+        d->glyph.push_back(std::move(g));
+        }
+      d->size.h = std::max(d->size.h,l.size.h);
+      d->bottom = std::max(d->bottom,l.size.h+l.dpos.y);
+      x += l.advance.x;
+      }
+    d->size.w = x;
+
+    TextLayout ret(std::move(d));
+    std::lock_guard<std::mutex> guard(syncLayout);
+    auto it = layoutId.find(key);
+    if(it!=layoutId.end())
+      return it->second->second;
+    layoutLru.emplace_front(key,ret);
+    layoutId[std::move(key)] = layoutLru.begin();
+    if(layoutLru.size()>LAYOUT_CACHE_SZ) {
+      layoutId.erase(layoutLru.back().first);
+      layoutLru.pop_back();
+      }
+    return ret;
+    }
+
   Metrics       metrics(float size) const {
     const float scale = stbtt_ScaleForPixelHeight(&info,size);
     Metrics m = metrics0;
@@ -278,6 +586,7 @@ struct FontElement::Impl {
   stbtt_fontinfo info={};
 
   std::mutex     syncMem;
+  std::vector<TextureAtlas*> atlases;
   uint8_t*       rasterBuf=nullptr;
   size_t         rasterSz =0;
   Metrics        metrics0;
@@ -285,7 +594,12 @@ struct FontElement::Impl {
 
   std::mutex                           syncMap;
   LetterTable                          map;
+  LetterTable                          sdfMap;
   std::unique_ptr<Impl>                fallback;
+
+  std::mutex                           syncLayout;
+  LayoutLru                            layoutLru;
+  std::unordered_map<LayoutKey,LayoutLru::iterator,LayoutKeyHash> layoutId;
   };
 
 FontElement::FontElement() {
@@ -343,6 +657,16 @@ Size FontElement::textSize(const char *text,float fontSize) const {
   return ret;
   }
 
+const FontElement::Letter& FontElement::letterSdf(char32_t ch, float size, TextureAtlas& tex) const {
+  return ptr->letterSdf(ch,size,tex);
+  }
+
+TextLayout FontElement::layout(const char* text, float fontSize, TextureAtlas& tex, bool sdf) const {
+  if(text==nullptr || ptr->size==0)
+    return TextLayout();
+  return ptr->layout(text,fontSize,tex,sdf);
+  }
+
 bool FontElement::isEmpty() const {
   return ptr->size==0;
   }
@@ -403,6 +727,14 @@ bool Font::isItalic() const {
   return italic;
   }
 
+void Font::setSdf(bool s) {
+  sdf = s ? 1 : 0;
+  }
+
+bool Font::isSdf() const {
+  return sdf!=0;
+  }
+
 bool Font::isEmpty() const {
   return fnt[0][0].isEmpty() || fnt[0][1].isEmpty() ||
          fnt[1][0].isEmpty() || fnt[1][1].isEmpty();
@@ -421,10 +753,12 @@ const Font::LetterGeometry &Font::letterGeometry(char32_t ch) const {
   }
 
 const Font::Letter &Font::letter(char16_t ch, TextureAtlas &tex) const {
-  return fnt[bold][italic].letter(ch,size,tex);
+  return letter(char32_t(ch),tex);
   }
 
 const Font::Letter &Font::letter(char32_t ch, TextureAtlas &tex) const {
+  if(sdf)
+    return fnt[bold][italic].letterSdf(ch,size,tex);
   return fnt[bold][italic].letter(ch,size,tex);
   }
 
@@ -443,3 +777,11 @@ Size Font::textSize(const char *text) const {
 Size Font::textSize(const std::string &text) const {
   return textSize(text.c_str());
   }
+
+TextLayout Font::layout(const char* text, TextureAtlas& tex) const {
+  return fnt[bold][italic].layout(text,size,tex,sdf!=0);
+  }
+
+TextLayout Font::layout(const std::string& text, TextureAtlas& tex) const {
+  return layout(text.c_str(),tex);
+  }
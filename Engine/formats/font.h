@@ -3,6 +3,7 @@
 #include <Tempest/File>
 #include <Tempest/Point>
 #include <Tempest/Sprite>
+#include <Tempest/TextLayout>
 
 #include <string>
 #include <memory>
@@ -42,8 +43,11 @@ class FontElement final {
 
     const LetterGeometry& letterGeometry(char32_t ch, float size) const;
     const Letter&         letter(char32_t ch,float size,TextureAtlas& tex) const;
+    // signed distance field glyph: rasterized once at reference size, view is shared by all sizes
+    const Letter&         letterSdf(char32_t ch,float size,TextureAtlas& tex) const;
 
     Size                  textSize(const char* text, float fontSize) const;
+    TextLayout            layout(const char* text, float fontSize, TextureAtlas& tex, bool sdf=false) const;
     bool                  isEmpty() const;
 
     Metrics               metrics(float size) const;
@@ -80,6 +84,10 @@ class Font final {
     void  setItalic(bool i);
     bool  isItalic() const;
 
+    // render glyphs from distance field, instead of rasterizing each pixel size
+    void  setSdf(bool s);
+    bool  isSdf() const;
+
     bool  isEmpty() const;
 
     Metrics               metrics() const;
@@ -95,6 +103,10 @@ class Font final {
     Size                  textSize(const char* text) const;
     Size                  textSize(const std::string& text) const;
 
+    // cached by (font, size, text, atlas)
+    TextLayout            layout(const char* text,TextureAtlas& tex) const;
+    TextLayout            layout(const std::string& text,TextureAtlas& tex) const;
+
   private:
     template<class CharT>
     Font(const CharT* file,std::true_type);
@@ -103,5 +115,6 @@ class Font final {
     float       size   = 18.f;
     uint8_t     bold   = 0;
     uint8_t     italic = 0;
+    uint8_t     sdf    = 0;
   };
 }
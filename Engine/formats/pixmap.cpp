@@ -17,6 +17,10 @@ struct Pixmap::Impl {
   Impl(uint32_t w,uint32_t h,Pixmap::Format frm):w(w),h(h),frm(frm) {
     bpp    = uint32_t(bppForFormat(frm));
     dataSz = size_t(w)*size_t(h)*size_t(bpp);
+    if(isCompressed(frm)) {
+      const size_t blocksize = (frm==Pixmap::Format::DXT1) ? 8 : 16;
+      dataSz = size_t((w+3)/4)*size_t((h+3)/4)*blocksize;
+      }
     data   = reinterpret_cast<uint8_t*>(std::malloc(dataSz));
     if(!data)
       throw std::bad_alloc();
@@ -24,7 +28,7 @@ struct Pixmap::Impl {
     }
 
   Impl(const Impl& other):w(other.w),h(other.h),bpp(other.bpp),dataSz(other.dataSz),frm(other.frm),mipCnt(other.mipCnt){
-    size_t size=size_t(w)*size_t(h)*size_t(bpp);
+    size_t size=dataSz;
     data=reinterpret_cast<uint8_t*>(std::malloc(size));
     if(!data)
       throw std::bad_alloc();
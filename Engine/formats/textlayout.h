@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Tempest/Point>
+#include <Tempest/Size>
+#include <Tempest/Sprite>
+
+#include <memory>
+#include <vector>
+
+namespace Tempest {
+
+class FontElement;
+class Painter;
+
+// immutable, shaped single-line text: glyph sprites with pen positions
+class TextLayout final {
+  public:
+    TextLayout()=default;
+
+    Size   size()       const { return data ? data->size : Size(); }
+    size_t glyphCount() const { return data ? data->glyph.size() : 0; }
+    bool   isEmpty()    const { return glyphCount()==0; }
+
+  private:
+    struct Glyph {
+      Tempest::Sprite view;
+      Tempest::Point  pos;
+      Tempest::Size   size;
+      };
+
+    struct Data {
+      std::vector<Glyph> glyph;
+      Size               size;
+      int                bottom=0; // max(dpos.y+size.h) of glyphs
+      bool               sdf=false;
+      };
+
+    TextLayout(std::shared_ptr<const Data>&& d):data(std::move(d)){}
+
+    std::shared_ptr<const Data> data;
+
+  friend class FontElement;
+  friend class Painter;
+  };
+
+}
@@ -1,5 +1,7 @@
 #include "abstractgraphicsapi.h"
 
+#include <algorithm>
+
 using namespace Tempest;
 
 static Sampler2d mkTrillinear() {
@@ -46,3 +48,130 @@ bool AbstractGraphicsApi::Props::hasDepthFormat(TextureFormat f) const {
   uint64_t  m = uint64_t(1) << uint64_t(f);
   return (dattFormat&m)!=0;
   }
+
+bool AbstractGraphicsApi::Props::hasStorageFormat(TextureFormat f) const {
+  uint64_t  m = uint64_t(1) << uint64_t(f);
+  return (storFormat&m)!=0;
+  }
+
+size_t AbstractGraphicsApi::MemoryStats::reserved() const {
+  size_t ret = 0;
+  for(auto& i:heaps)
+    ret += i.reserved;
+  return ret;
+  }
+
+size_t AbstractGraphicsApi::MemoryStats::allocated() const {
+  size_t ret = 0;
+  for(auto& i:heaps)
+    ret += i.allocated;
+  return ret;
+  }
+
+double AbstractGraphicsApi::MemoryStats::fragmentation() const {
+  size_t freeBytes = 0, largest = 0;
+  for(auto& i:heaps) {
+    freeBytes += i.freeBytes;
+    largest    = std::max(largest,i.largestFree);
+    }
+  if(freeBytes==0)
+    return 0;
+  return 1.0 - double(largest)/double(freeBytes);
+  }
+
+static void jsonUsage(std::string& out, MemUsage u) {
+  static const std::pair<MemUsage,const char*> names[] = {
+    {MemUsage::TransferSrc,   "transferSrc"},
+    {MemUsage::TransferDst,   "transferDst"},
+    {MemUsage::UniformBuffer, "uniform"},
+    {MemUsage::VertexBuffer,  "vertex"},
+    {MemUsage::IndexBuffer,   "index"},
+    {MemUsage::StorageBuffer, "storage"},
+    {MemUsage::Indirect,      "indirect"},
+    };
+  out += '[';
+  bool first = true;
+  for(auto& i:names) {
+    if((u & i.first)!=i.first)
+      continue;
+    if(!first)
+      out += ',';
+    out += '"';
+    out += i.second;
+    out += '"';
+    first = false;
+    }
+  out += ']';
+  }
+
+static void jsonField(std::string& out, const char* name, size_t v, bool last=false) {
+  out += '"';
+  out += name;
+  out += "\":";
+  out += std::to_string(v);
+  if(!last)
+    out += ',';
+  }
+
+std::string AbstractGraphicsApi::MemoryStats::toJson() const {
+  std::string out;
+  out += "{";
+  jsonField(out,"reserved", reserved());
+  jsonField(out,"allocated",allocated());
+  out += "\"fragmentation\":" + std::to_string(fragmentation()) + ",";
+
+  out += "\"heaps\":[";
+  for(size_t i=0; i<heaps.size(); ++i) {
+    auto& h = heaps[i];
+    out += (i==0) ? "{" : ",{";
+    jsonField(out,"id",          h.id);
+    jsonField(out,"pages",       h.pages);
+    jsonField(out,"dedicated",   h.dedicated);
+    jsonField(out,"reserved",    h.reserved);
+    jsonField(out,"allocated",   h.allocated);
+    jsonField(out,"allocations", h.allocations);
+    jsonField(out,"freeBlocks",  h.freeBlocks);
+    jsonField(out,"freeBytes",   h.freeBytes);
+    jsonField(out,"largestFree", h.largestFree);
+    out += "\"fragmentation\":" + std::to_string(h.fragmentation) + "}";
+    }
+  out += "],";
+
+  out += "\"buffers\":[";
+  for(size_t i=0; i<buffers.size(); ++i) {
+    auto& b = buffers[i];
+    out += (i==0) ? "{" : ",{";
+    out += "\"usage\":";
+    jsonUsage(out,b.usage);
+    out += ',';
+    jsonField(out,"allocations",b.allocations);
+    jsonField(out,"bytes",      b.bytes,true);
+    out += "}";
+    }
+  out += "],";
+
+  out += "\"textures\":{";
+  jsonField(out,"allocations",textures.allocations);
+  jsonField(out,"bytes",      textures.bytes,true);
+  out += "},";
+
+  out += "\"allocations\":[";
+  for(size_t i=0; i<allocations.size(); ++i) {
+    auto& a = allocations[i];
+    out += (i==0) ? "{" : ",{";
+    jsonField(out,"id",a.id);
+    out += "\"site\":\"";
+    out += a.site;
+    out += "\",";
+    jsonField(out,"heap",a.heap);
+    out += "\"usage\":";
+    jsonUsage(out,a.usage);
+    out += ',';
+    jsonField(out,"size",a.size,true);
+    out += "}";
+    }
+  out += "]";
+
+  out += "}";
+  return out;
+  }
@@ -6,6 +6,7 @@
 #include <memory>
 #include <atomic>
 #include <vector>
+#include <string>
 
 #include "../utility/dptr.h"
 #include "flags.h"
@@ -32,6 +33,9 @@ namespace Tempest {
 
     half2  = 8,
     half4  = 9,
+
+    ushort2 = 10,
+    ushort4 = 11,
     count
     };
   }
@@ -86,7 +90,9 @@ namespace Tempest {
     R,
     G,
     B,
-    A
+    A,
+    Zero,
+    One
     };
 
   struct ComponentMapping final {
@@ -214,21 +220,80 @@ namespace Tempest {
             size_t maxRange    = 128;
             } push;
 
+          struct {
+            bool   enabled        = false;
+            size_t maxGroups      = 0; // per dimension
+            size_t maxInvocations = 0; // per group
+            } compute;
+
+          struct {
+            bool   multiDraw    = false; // otherwise indirect draws are issued one by one
+            size_t maxDrawCount = 1;
+            bool   firstInstance = false; // otherwise DrawIndirectCommand::firstInstance must be 0
+            } indirect;
+
           bool     anisotropy=false;
           float    maxAnisotropy=1.0f;
 
           bool     hasSamplerFormat(TextureFormat f) const;
           bool     hasAttachFormat (TextureFormat f) const;
           bool     hasDepthFormat  (TextureFormat f) const;
+          bool     hasStorageFormat(TextureFormat f) const;
 
           void     setSamplerFormats(uint64_t t) { smpFormat  = t; }
           void     setAttachFormats (uint64_t t) { attFormat  = t; }
           void     setDepthFormats  (uint64_t t) { dattFormat = t; }
+          void     setStorageFormats(uint64_t t) { storFormat = t; }
 
         private:
           uint64_t smpFormat =0;
           uint64_t attFormat =0;
           uint64_t dattFormat=0;
+          uint64_t storFormat=0;
+        };
+
+      class MemoryStats {
+        public:
+          struct Heap {
+            uint32_t id           =0;
+            size_t   pages        =0;
+            size_t   dedicated    =0;
+            size_t   reserved     =0;
+            size_t   allocated    =0;
+            size_t   allocations  =0;
+            size_t   freeBlocks   =0;
+            size_t   freeBytes    =0;
+            size_t   largestFree  =0;
+            double   fragmentation=0;
+            };
+
+          struct Usage {
+            MemUsage usage      =MemUsage(0);
+            size_t   allocations=0;
+            size_t   bytes      =0;
+            };
+
+          struct Allocation {
+            uint64_t    id     =0;
+            // kind of resource and api call, that created it: "texture", "attachment", "buffer/static"...
+            const char* site   ="";
+            uint32_t    heap   =0;
+            // empty for textures
+            MemUsage    usage  =MemUsage(0);
+            size_t      size   =0;
+            };
+
+          std::vector<Heap>       heaps;
+          // buffers grouped by usage flags
+          std::vector<Usage>      buffers;
+          Usage                   textures;
+          // live allocations, in order of creation
+          std::vector<Allocation> allocations;
+
+          size_t      reserved()  const;
+          size_t      allocated() const;
+          double      fragmentation() const;
+          std::string toJson() const;
         };
 
       struct NoCopy {
@@ -248,12 +313,27 @@ namespace Tempest {
         virtual ~Device()=default;
         virtual const char* renderer() const=0;
         virtual void        waitIdle() = 0;
+        virtual void        savePipelineCache(std::vector<uint8_t>& out) = 0;
+        virtual bool        loadPipelineCache(const void* data, size_t size) = 0;
+        // tickets are issued by createTexture; see Texture::ticket
+        virtual bool        isUploaded(uint64_t ticket) = 0;
+        virtual void        waitUpload(uint64_t ticket) = 0;
+        virtual MemoryStats memoryStats() = 0;
         };
       struct Fence:NoCopy {
         virtual ~Fence()=default;
         virtual void wait() =0;
+        // timeout in milliseconds; false, if fence is not signaled in time
+        virtual bool wait(uint64_t timeout)=0;
         virtual void reset()=0;
         };
+      struct Readback:NoCopy {
+        virtual ~Readback()=default;
+        virtual bool isReady()=0;
+        virtual void wait()=0;
+        // waits for gpu, if needed
+        virtual void read(Pixmap& out)=0;
+        };
       struct Semaphore:NoCopy {
         virtual ~Semaphore()=default;
         };
@@ -266,6 +346,8 @@ namespace Tempest {
         virtual uint32_t      h() const=0;
         };
       struct Texture:Shared  {
+        // upload, that initializes content of this texture; 0, if there is none
+        uint64_t ticket=0;
         };
       struct Fbo:Shared      {
         virtual ~Fbo(){}
@@ -278,6 +360,7 @@ namespace Tempest {
         virtual ~Pass()=default;
         };
       struct Pipeline:Shared {};
+      struct CompPipeline:Shared {};
       struct Shader:Shared   {};
       struct Uniforms        {};
       struct UniformsLay:Shared {
@@ -294,30 +377,46 @@ namespace Tempest {
         };
       struct CommandBuffer:NoCopy {
         virtual ~CommandBuffer()=default;
+        // if bundles is true, pass may contain only execute() commands
         virtual void beginRenderPass(AbstractGraphicsApi::Fbo* f,
                                      AbstractGraphicsApi::Pass*  p,
-                                     uint32_t width,uint32_t height)=0;
+                                     uint32_t width,uint32_t height,bool bundles)=0;
         virtual void endRenderPass()=0;
+        virtual void execute(const CommandBuffer& bundle)=0;
 
         virtual void changeLayout(Swapchain& s, uint32_t id, TextureFormat frm, TextureLayout prev, TextureLayout next)=0;
         virtual void changeLayout(Texture& t,TextureFormat frm,TextureLayout prev,TextureLayout next)=0;
         virtual bool isRecording() const = 0;
         virtual void begin()=0;
         virtual void end()  =0;
-        virtual void setPipeline(Pipeline& p,uint32_t w,uint32_t h)=0;
+        virtual void setPipeline(Pipeline& p)=0;
         virtual void setBytes   (Pipeline &p, const void* data, size_t size)=0;
         virtual void setViewport(const Rect& r)=0;
+        virtual void setScissor (const Rect& r)=0;
         virtual void setUniforms(Pipeline& p,Desc& u)=0;
+        // offsets are in elements of uniform buffers, in order of binding
+        virtual void setUniforms(Pipeline& p,Desc& u,const uint32_t* offsets,size_t count)=0;
+
+        virtual void setComputePipeline(CompPipeline& p)=0;
+        virtual void setBytes   (CompPipeline& p, const void* data, size_t size)=0;
+        virtual void setUniforms(CompPipeline& p, Desc& u)=0;
+        // outside of render pass; results are visible to following draws and dispatches
+        virtual void dispatch   (size_t x, size_t y, size_t z)=0;
 
         virtual void setVbo      (const Buffer& b)=0;
+        virtual void setInstanceVbo(const Buffer& b)=0;
         virtual void setIbo      (const Buffer& b,Detail::IndexClass cls)=0;
-        virtual void draw        (size_t offset,size_t vertexCount)=0;
-        virtual void drawIndexed (size_t ioffset, size_t isize, size_t voffset)=0;
+        virtual void draw        (size_t offset,size_t vertexCount,size_t firstInstance,size_t instanceCount)=0;
+        virtual void drawIndexed (size_t ioffset, size_t isize, size_t voffset,size_t firstInstance,size_t instanceCount)=0;
+        // offset in bytes; stride is size of DrawIndirectCommand or DrawIndexedIndirectCommand
+        virtual void drawIndirect       (const Buffer& indirect,size_t offset,size_t drawCount,size_t stride)=0;
+        virtual void drawIndexedIndirect(const Buffer& indirect,size_t offset,size_t drawCount,size_t stride)=0;
         };
 
       using PBuffer      = Detail::DSharedPtr<Buffer*>;
       using PTexture     = Detail::DSharedPtr<Texture*>;
       using PPipeline    = Detail::DSharedPtr<Pipeline*>;
+      using PCompPipeline= Detail::DSharedPtr<CompPipeline*>;
       using PPass        = Detail::DSharedPtr<Pass*>;
       using PShader      = Detail::DSharedPtr<Shader*>;
       using PFbo         = Detail::DSharedPtr<Fbo*>;
@@ -341,15 +440,20 @@ namespace Tempest {
 
       virtual PFboLayout createFboLayout(Device *d, Swapchain *s, TextureFormat *att, size_t attCount)=0;
 
+      // vertex and fragment shaders, or single compute shader
       virtual PUniformsLay
                          createUboLayout(Device *d,const std::initializer_list<Shader*>& sh)=0;
 
+      // decl: declSize per-vertex components (binding 0), followed by instDeclSize per-instance components (binding 1)
       virtual PPipeline  createPipeline(Device* d, const RenderState &st,
                                         const Tempest::Decl::ComponentType *decl, size_t declSize,
-                                        size_t stride, Topology tp,
+                                        size_t stride, size_t instDeclSize, size_t instStride, Topology tp,
                                         const UniformsLay &ulayImpl,
                                         const std::initializer_list<Shader*>& sh)=0;
 
+      virtual PCompPipeline
+                         createComputePipeline(Device* d, const UniformsLay &ulayImpl, Shader* comp)=0;
+
       virtual PShader    createShader(Device *d,const void* source,size_t src_size)=0;
 
       virtual Fence*     createFence(Device *d)=0;
@@ -358,15 +462,28 @@ namespace Tempest {
 
       virtual CommandBuffer*
                          createCommandBuffer(Device* d)=0;
+      // secondary command buffer, that continues render pass with layout lay
+      virtual CommandBuffer*
+                         createCommandBundle(Device* d,FboLayout* lay,uint32_t width,uint32_t height)=0;
 
       virtual Desc*      createDescriptors(Device* d,UniformsLay& layP)=0;
 
       virtual PBuffer    createBuffer (Device* d,const void *mem,size_t count,size_t sz,size_t alignedSz,MemUsage usage,BufferHeap flg)=0;
+      // host-coherent buffer, that stays mapped at 'mapped' for whole lifetime
+      virtual PBuffer    createMappedBuffer(Device* d,size_t size,MemUsage usage,void*& mapped)=0;
       virtual PTexture   createTexture(Device* d,const Pixmap& p,TextureFormat frm,uint32_t mips)=0;
-      virtual PTexture   createTexture(Device* d,const uint32_t w,const uint32_t h,uint32_t mips, TextureFormat frm)=0;
-      virtual void       readPixels   (AbstractGraphicsApi::Device *d, Pixmap &out,const PTexture t,
+      // storage: texture can be bound as image2D; off by default, as it may disable framebuffer compression
+      virtual PTexture   createTexture(Device* d,const uint32_t w,const uint32_t h,uint32_t mips, TextureFormat frm, bool storage)=0;
+      // blocking copy of device buffer content to cpu
+      virtual void       readBytes    (Device* d,Buffer* buf,void* out,size_t size)=0;
+      // copy of rect r of mip level; multiple readbacks can be in flight
+      virtual Readback*  readPixels   (AbstractGraphicsApi::Device *d, const PTexture t,
                                        TextureLayout lay, TextureFormat frm,
-                                       const uint32_t w, const uint32_t h, uint32_t mip) = 0;
+                                       const Rect& r, uint32_t mip) = 0;
+      // copy regions of p into same regions of mip 0; texture must be in Sampler layout
+      // regions of block-compressed textures are aligned to 4x4 blocks
+      virtual void       updateTexture(AbstractGraphicsApi::Device *d, PTexture t, const Pixmap& p, TextureFormat frm,
+                                       const Rect* rect, size_t count) = 0;
 
       virtual void       present  (Device *d,Swapchain* sw,uint32_t imageId,const Semaphore *wait)=0;
 
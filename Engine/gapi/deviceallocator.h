@@ -1,17 +1,21 @@
 #pragma once
 
 #include <cstdint>
-#include <forward_list>
+#include <list>
 #include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
 #include <algorithm>
 
 namespace Tempest {
 namespace Detail {
 
+// two-level segregated fit sub-allocator; each heap has own lock
 template<class MemoryProvider>
 class DeviceAllocator {
   struct Page;
-  struct Block;
+  struct Heap;
   public:
     enum {
       DEFAULT_PAGE_SIZE=128*1024*1024
@@ -24,232 +28,422 @@ class DeviceAllocator {
     DeviceAllocator(const DeviceAllocator&)=delete;
 
     ~DeviceAllocator(){
-      for(auto& i:pages)
-        device.free(i.memory,i.size,i.type);
+      for(auto& h:heaps)
+        for(auto& i:h.second->pages)
+          device.free(i.memory,i.allSize,i.typeId);
       }
 
     struct Allocation {
-      Page*  page  =nullptr;
-      size_t offset=0,size=0;
+      Page*    page  =nullptr;
+      size_t   offset=0,size=0;
+      uint32_t block =0;
+      };
+
+    struct Stats {
+      size_t pages       =0;
+      size_t dedicated   =0;
+      size_t reserved    =0;
+      size_t allocated   =0;
+      size_t allocations =0;
+      size_t freeBlocks  =0;
+      size_t freeBytes   =0;
+      size_t largestFree =0;
+
+      // 0 - free memory is one contiguous block, close to 1 - free memory is scattered over small blocks
+      double fragmentation() const {
+        if(freeBytes==0)
+          return 0;
+        return 1.0 - double(largestFree)/double(freeBytes);
+        }
       };
 
     Allocation alloc(size_t size, size_t align, uint32_t heapId, uint32_t typeId) {
-      std::lock_guard<std::mutex> guard(sync);
-      for(auto& i:pages){
-        if(i.type==heapId && i.allocated+size<=i.allSize){
-          auto ret=i.alloc(size,align,device);
+      Heap& h = heap(heapId);
+      std::lock_guard<std::mutex> guard(h.sync);
+      for(auto& i:h.pages){
+        if(i.allocated+size<=i.allSize){
+          auto ret=i.alloc(size,align);
           if(ret.page!=nullptr)
             return ret;
           }
         }
-      return rawAlloc(size,align,heapId,typeId);
+      return rawAlloc(h,std::max<size_t>(DEFAULT_PAGE_SIZE,size+align),size,align,heapId,typeId,false);
       }
 
     void free(const Allocation& a){
-      std::lock_guard<std::mutex> guard(sync);
-      a.page->free(a);
-      if(a.page->allocated==0){
-        device.free(a.page->memory,a.page->size,a.page->type);
-        pages.remove(*a.page);
+      Page& pg = *a.page;
+      Heap& h  = *pg.owner;
+      std::lock_guard<std::mutex> guard(h.sync);
+      pg.free(a);
+      if(pg.count==0){
+        freeDevMemory(pg);
+        h.pages.remove_if([&pg](const Page& p){ return &p==&pg; });
         }
       }
 
     Allocation dedicatedAlloc(size_t size, size_t align, uint32_t heapId, uint32_t typeId) {
+      Heap& h = heap(heapId);
+      std::lock_guard<std::mutex> guard(h.sync);
+      return rawAlloc(h,size,size,align,heapId,typeId,true);
+      }
+
+    Stats stats() {
+      Stats ret;
       std::lock_guard<std::mutex> guard(sync);
-      Page pg(static_cast<uint32_t>(size));
-      pg.memory = device.alloc(pg.allSize,typeId);
-      pg.type   = heapId;
-      if(pg.memory==null)
-        return Allocation();
-      try {
-        pages.push_front(Page(0));
+      for(auto& h:heaps) {
+        std::lock_guard<std::mutex> g(h.second->sync);
+        for(auto& i:h.second->pages)
+          i.stats(ret);
         }
-      catch(...){
-        device.free(pg.memory,pg.size,pg.type);
-        throw;
+      return ret;
+      }
+
+    // per heap, ordered by heap id
+    std::vector<std::pair<uint32_t,Stats>> heapStats() {
+      std::vector<std::pair<uint32_t,Stats>> ret;
+      std::lock_guard<std::mutex> guard(sync);
+      for(auto& h:heaps) {
+        Stats st;
+        std::lock_guard<std::mutex> g(h.second->sync);
+        for(auto& i:h.second->pages)
+          i.stats(st);
+        ret.emplace_back(h.first,st);
         }
-      pages.front() = std::move(pg);
-      return pages.front().alloc(size,align,device);
+      std::sort(ret.begin(),ret.end(),[](const std::pair<uint32_t,Stats>& l,const std::pair<uint32_t,Stats>& r){
+        return l.first<r.first;
+        });
+      return ret;
       }
 
   private:
-    Allocation rawAlloc(size_t size, size_t align, uint32_t heapId, uint32_t typeId){
-      Page pg(std::max<uint32_t>(DEFAULT_PAGE_SIZE,uint32_t(size)));
-      pg.memory = device.alloc(pg.allSize,typeId);
-      pg.type   = heapId;
-      if(pg.memory==null)
+    Heap& heap(uint32_t heapId) {
+      std::lock_guard<std::mutex> guard(sync);
+      auto& h = heaps[heapId];
+      if(h==nullptr)
+        h.reset(new Heap());
+      return *h;
+      }
+
+    Allocation rawAlloc(Heap& h, size_t pageSize, size_t size, size_t align, uint32_t heapId, uint32_t typeId, bool dedicated){
+      Memory mem = null;
+      {
+      std::lock_guard<std::mutex> guard(syncProvider);
+      mem = device.alloc(pageSize,typeId);
+      }
+      if(mem==null)
         return Allocation();
       try {
-        pages.push_front(Page(0));
+        h.pages.emplace_front(pageSize);
         }
       catch(...){
-        device.free(pg.memory,pg.size,pg.type);
+        std::lock_guard<std::mutex> guard(syncProvider);
+        device.free(mem,pageSize,typeId);
         throw;
         }
-      pages.front() = std::move(pg);
-      return pages.front().alloc(size,align,device);
+      Page& pg  = h.pages.front();
+      pg.memory = mem;
+      pg.type   = heapId;
+      pg.typeId = typeId;
+      pg.owner  = &h;
+      pg.dedicated = dedicated;
+      return pg.alloc(size,align);
       }
 
-    void       freeDevMemory(Memory mem){
-      return device.free(mem);
+    void freeDevMemory(Page& pg){
+      std::lock_guard<std::mutex> guard(syncProvider);
+      device.free(pg.memory,pg.allSize,pg.typeId);
       }
 
     MemoryProvider&         device;
+    std::mutex              syncProvider;
     std::mutex              sync;
-    std::forward_list<Page> pages;
+    std::unordered_map<uint32_t,std::unique_ptr<Heap>> heaps;
   };
 
 template<class MemoryProvider>
-struct DeviceAllocator<MemoryProvider>::Block {
-  Block*   next  =nullptr;
-  uint32_t size  =0;
-  uint32_t offset=0;
+struct DeviceAllocator<MemoryProvider>::Heap {
+  std::mutex       sync;
+  std::list<Page>  pages;
   };
 
 template<class MemoryProvider>
-struct DeviceAllocator<MemoryProvider>::Page : Block {
-  using    Block::next;
-  using    Block::size;
-  using    Block::offset;
+struct DeviceAllocator<MemoryProvider>::Page {
+  enum : uint32_t {
+    SL_LOG2  = 4,
+    SL_COUNT = 1u<<SL_LOG2,
+    FL_COUNT = 64-SL_LOG2+1,
+    NONE     = uint32_t(-1),
+    };
+
+  struct Block {
+    size_t   offset  =0;
+    size_t   size    =0;
+    uint32_t prevPhys=NONE;
+    uint32_t nextPhys=NONE;
+    uint32_t prevFree=NONE;
+    uint32_t nextFree=NONE;
+    bool     isFree  =false;
+    };
 
   Memory     memory =null;
   std::mutex mmapSync;
   uint32_t   type   =0;
-  uint32_t   allSize=0;
-  uint32_t   allocated=0;
-
-  Page(uint32_t sz) noexcept {
-    size   =sz;
-    allSize=sz;
+  uint32_t   typeId =0;
+  size_t     allSize=0;
+  size_t     allocated=0;
+  size_t     count  =0;
+  Heap*      owner  =nullptr;
+  bool       dedicated=false;
+
+  std::vector<Block>    blocks;
+  std::vector<uint32_t> unused;
+  uint64_t              flBitmap=0;
+  uint32_t              slBitmap[FL_COUNT]={};
+  uint32_t              heads[FL_COUNT][SL_COUNT];
+
+  Page(size_t sz):allSize(sz) {
+    for(auto& i:heads)
+      std::fill(std::begin(i),std::end(i),NONE);
+    reserveBlocks();
+    uint32_t b = newBlock();
+    blocks[b].offset = 0;
+    blocks[b].size   = sz;
+    insert(b);
     }
 
-  Page(Page&& p) noexcept {
-    std::swap(next,p.next);
-    size  =p.size;
-    offset=p.offset;
-    std::swap(memory,p.memory);
-    type=p.type;
-    allSize=p.allSize;
+  Page(const Page&)=delete;
+
+  Allocation alloc(size_t size,size_t align) {
+    if(size==0)
+      size = 1;
+    const size_t need = (align>1) ? size+align-1 : size;
+    reserveBlocks();
+
+    uint32_t fl=0, sl=0;
+    mappingSearch(need,fl,sl);
+    uint32_t b = findSuitable(fl,sl);
+    if(b==NONE) {
+      // rounding up may skip the only fitting block, like a fresh dedicated page; check exact classes
+      mapping(size,fl,sl);
+      b = findInList(fl,sl,size,align);
+      }
+    if(b==NONE) {
+      mapping(need,fl,sl);
+      b = findInList(fl,sl,size,align);
+      }
+    if(b==NONE)
+      return Allocation{};
+    remove(b);
+
+    // split front padding and tail remainder into free blocks
+    const size_t at  = alignUp(blocks[b].offset,align);
+    const size_t pad = at-blocks[b].offset;
+    if(pad>0) {
+      uint32_t f = split(b,pad);
+      insert(b);
+      b = f;
+      }
+    if(blocks[b].size>size) {
+      uint32_t t = split(b,size);
+      insert(t);
+      }
+
+    blocks[b].isFree = false;
+    allocated += size;
+    count++;
+
+    Allocation a;
+    a.page   = this;
+    a.offset = blocks[b].offset;
+    a.size   = size;
+    a.block  = b;
+    return a;
     }
 
-  ~Page(){
-    Block* b=next;
-    while(b!=nullptr){
-      Block* p=b->next;
-      delete b;
-      b=p;
+  void free(const Allocation& a) noexcept {
+    allocated -= a.size;
+    count--;
+
+    uint32_t b = a.block;
+    uint32_t p = blocks[b].prevPhys;
+    if(p!=NONE && blocks[p].isFree) {
+      remove(p);
+      merge(p,b);
+      b = p;
+      }
+    uint32_t n = blocks[b].nextPhys;
+    if(n!=NONE && blocks[n].isFree) {
+      remove(n);
+      merge(b,n);
       }
+    insert(b);
     }
 
-  Page& operator=(Page&& p) noexcept {
-    std::swap(next,p.next);
-    size  =p.size;
-    offset=p.offset;
-    std::swap(memory,p.memory);
-    type=p.type;
-    allSize=p.allSize;
-    return *this;
+  void stats(Stats& st) const {
+    st.pages       += 1;
+    st.dedicated   += dedicated ? 1 : 0;
+    st.reserved    += allSize;
+    st.allocated   += allocated;
+    st.allocations += count;
+    for(uint32_t fl=0; fl<FL_COUNT; ++fl) {
+      if(slBitmap[fl]==0)
+        continue;
+      for(uint32_t sl=0; sl<SL_COUNT; ++sl)
+        for(uint32_t b=heads[fl][sl]; b!=NONE; b=blocks[b].nextFree) {
+          st.freeBlocks  += 1;
+          st.freeBytes   += blocks[b].size;
+          st.largestFree  = std::max(st.largestFree,blocks[b].size);
+          }
+      }
     }
 
-  bool operator==(const Page& other) const noexcept {
-    return memory==other.memory;
-    }
+  private:
+    static size_t alignUp(size_t v, size_t align) {
+      if(align<=1)
+        return v;
+      return ((v+align-1)/align)*align;
+      }
 
-  Allocation alloc(size_t size,size_t align,MemoryProvider& /*prov*/) noexcept {
-    Block*   b=this;
-    while(b!=nullptr) {
-      if(size<=b->size) {
-        size_t padding=b->offset%align;
-        if(padding==0)
-          return alloc(*b,size);
-
-        padding=align-padding;
-        if(size+padding==b->size) {
-          return alloc(*b,size,padding);
-          } else
-        if(size+padding<b->size){
-          Block* bp=new(std::nothrow) Block();
-          if(bp!=nullptr){
-            bp->next=b->next;
-            b->next =bp;
-
-            bp->size  =uint32_t(b->size-padding);
-            bp->offset=uint32_t(b->offset+padding);
-            b->size   =uint32_t(padding);
-
-            return alloc(*bp,size);
-            }
-          }
+    static uint32_t msb(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+      return uint32_t(63-__builtin_clzll(v));
+#else
+      uint32_t r=0;
+      while(v>>=1)
+        ++r;
+      return r;
+#endif
+      }
+
+    static uint32_t lsb(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+      return uint32_t(__builtin_ctzll(v));
+#else
+      uint32_t r=0;
+      while((v&1)==0) {
+        v>>=1;
+        ++r;
         }
-      b=b->next;
+      return r;
+#endif
       }
-    return Allocation{};
-    }
 
-  Allocation alloc(Block& b,size_t size) noexcept {
-    Allocation a;
-    a.offset=b.offset;
-    a.page  =this;
-    a.size  =size;
+    static void mapping(size_t size, uint32_t& fl, uint32_t& sl) {
+      if(size<SL_COUNT) {
+        fl = 0;
+        sl = uint32_t(size);
+        return;
+        }
+      const uint32_t m = msb(size);
+      fl = m-SL_LOG2+1;
+      sl = uint32_t(size>>(m-SL_LOG2)) - SL_COUNT;
+      }
 
-    b.offset +=uint32_t(size);
-    b.size   -=uint32_t(size);
-    allocated+=uint32_t(size);
-    return a;
-    }
+    static void mappingSearch(size_t size, uint32_t& fl, uint32_t& sl) {
+      if(size>=SL_COUNT)
+        size += (size_t(1)<<(msb(size)-SL_LOG2))-1;
+      mapping(size,fl,sl);
+      }
 
-  Allocation alloc(Block& b,size_t size,size_t padding) noexcept {
-    Allocation a;
-    a.offset=b.offset+padding;
-    a.page  =this;
-    a.size  =size;
-
-    uint32_t sz=uint32_t(size+padding);
-    b.offset +=sz;
-    b.size   -=sz;
-    allocated+=uint32_t(size);
-    return a;
-    }
+    uint32_t findSuitable(uint32_t fl, uint32_t sl) const {
+      if(fl>=FL_COUNT)
+        return NONE;
+      uint32_t slMap = (sl<SL_COUNT) ? (slBitmap[fl] & (~0u << sl)) : 0;
+      if(slMap==0) {
+        const uint64_t flMap = (fl+1<64) ? (flBitmap & (~uint64_t(0) << (fl+1))) : 0;
+        if(flMap==0)
+          return NONE;
+        fl    = lsb(flMap);
+        slMap = slBitmap[fl];
+        }
+      return heads[fl][lsb(slMap)];
+      }
 
-  void free(const Allocation& a) noexcept {
-    allocated -= uint32_t(a.size);
-
-    Block* b=this;
-    while(b!=nullptr && (b->offset+b->size)<a.offset)
-      b=b->next;
-
-    if(b->offset+b->size==a.offset){
-      b->size+=uint32_t(a.size);
-      mergeWithNext(b);
-      return;
-      }
-    if(b->offset==a.offset+a.size){
-      b->offset=uint32_t(a.offset);
-      b->size +=uint32_t(a.size);
-      return;
-      }
-
-    Block* r=new(std::nothrow) Block();
-    if(r==nullptr)
-      return; // no error, but sort of leak in Page
-    *r=*b;
-    b->next  =r;
-    b->size  =uint32_t(a.size);
-    b->offset=uint32_t(a.offset);
-    }
+    uint32_t findInList(uint32_t fl, uint32_t sl, size_t size, size_t align) const {
+      for(uint32_t b=heads[fl][sl]; b!=NONE; b=blocks[b].nextFree) {
+        const size_t pad = alignUp(blocks[b].offset,align)-blocks[b].offset;
+        if(pad+size<=blocks[b].size)
+          return b;
+        }
+      return NONE;
+      }
 
-  void mergeWithNext(Block* b) noexcept {
-    while(b->next!=nullptr){
-      if(b->offset+b->size==b->next->offset){
-        auto rm=b->next;
-        b->size+=b->next->size;
-        b->next=b->next->next;
-        delete rm;
-        } else {
-        return;
+    // split must not throw, once block is taken out of free-lists
+    void reserveBlocks() {
+      if(blocks.capacity()<blocks.size()+2)
+        blocks.reserve(blocks.capacity()*2+2);
+      unused.reserve(blocks.capacity());
+      }
+
+    uint32_t newBlock() {
+      if(!unused.empty()) {
+        uint32_t b = unused.back();
+        unused.pop_back();
+        blocks[b] = Block();
+        return b;
         }
+      blocks.emplace_back();
+      return uint32_t(blocks.size()-1);
+      }
+
+    // cuts b to size, returns block with the rest
+    uint32_t split(uint32_t b, size_t size) {
+      uint32_t r = newBlock();
+      Block&   rb = blocks[r];
+      Block&   bb = blocks[b];
+      rb.offset   = bb.offset+size;
+      rb.size     = bb.size-size;
+      rb.prevPhys = b;
+      rb.nextPhys = bb.nextPhys;
+      if(bb.nextPhys!=NONE)
+        blocks[bb.nextPhys].prevPhys = r;
+      bb.nextPhys = r;
+      bb.size     = size;
+      return r;
+      }
+
+    // appends n to b; n is physically next to b
+    void merge(uint32_t b, uint32_t n) noexcept {
+      Block& bb = blocks[b];
+      Block& nb = blocks[n];
+      bb.size    += nb.size;
+      bb.nextPhys = nb.nextPhys;
+      if(nb.nextPhys!=NONE)
+        blocks[nb.nextPhys].prevPhys = b;
+      unused.push_back(n); // capacity is reserved by reserveBlocks
+      }
+
+    void insert(uint32_t b) noexcept {
+      uint32_t fl=0, sl=0;
+      mapping(blocks[b].size,fl,sl);
+      Block& bb = blocks[b];
+      bb.isFree   = true;
+      bb.prevFree = NONE;
+      bb.nextFree = heads[fl][sl];
+      if(bb.nextFree!=NONE)
+        blocks[bb.nextFree].prevFree = b;
+      heads[fl][sl] = b;
+      slBitmap[fl] |= (1u<<sl);
+      flBitmap     |= (uint64_t(1)<<fl);
+      }
+
+    void remove(uint32_t b) noexcept {
+      uint32_t fl=0, sl=0;
+      mapping(blocks[b].size,fl,sl);
+      Block& bb = blocks[b];
+      if(bb.prevFree!=NONE)
+        blocks[bb.prevFree].nextFree = bb.nextFree; else
+        heads[fl][sl] = bb.nextFree;
+      if(bb.nextFree!=NONE)
+        blocks[bb.nextFree].prevFree = bb.prevFree;
+      if(heads[fl][sl]==NONE) {
+        slBitmap[fl] &= ~(1u<<sl);
+        if(slBitmap[fl]==0)
+          flBitmap &= ~(uint64_t(1)<<fl);
+        }
+      bb.isFree   = false;
+      bb.prevFree = NONE;
+      bb.nextFree = NONE;
       }
-    }
   };
 }}
-
@@ -79,6 +79,21 @@ DxBuffer DxAllocator::alloc(const void* mem, size_t count, size_t size, size_t a
   return DxBuffer(std::move(ret),UINT(resDesc.Width));
   }
 
+DxBuffer DxAllocator::allocStaging(size_t size) {
+  return alloc(nullptr,size,1,1,MemUsage::TransferSrc,BufferHeap::Upload);
+  }
+
+void* DxAllocator::map(DxBuffer& buf) {
+  D3D12_RANGE rgn    = {0,0}; // cpu doesn't read
+  void*       mapped = nullptr;
+  dxAssert(buf.impl->Map(0,&rgn,&mapped));
+  return mapped;
+  }
+
+void DxAllocator::unmap(DxBuffer& buf) {
+  buf.impl->Unmap(0,nullptr);
+  }
+
 DxTexture DxAllocator::alloc(const Pixmap& pm, uint32_t mip, DXGI_FORMAT format) {
   ComPtr<ID3D12Resource> ret;
 
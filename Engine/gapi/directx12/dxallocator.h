@@ -21,6 +21,11 @@ class DxAllocator {
     DxBuffer  alloc(const void *mem, size_t count,  size_t size, size_t alignedSz, MemUsage usage, BufferHeap bufFlg);
     DxTexture alloc(const Pixmap &pm, uint32_t mip, DXGI_FORMAT format);
     DxTexture alloc(const uint32_t w, const uint32_t h, const uint32_t mip, TextureFormat frm);
+    DxBuffer  allocStaging(size_t size);
+
+    // persistent mapping of staging buffer
+    void*     map  (DxBuffer& buf);
+    void      unmap(DxBuffer& buf);
 
   private:
     ID3D12Device*   device=nullptr;
@@ -33,11 +33,11 @@ void DxBuffer::update(const void* data, size_t off, size_t count, size_t sz, siz
 void DxBuffer::read(void* data, size_t off, size_t sz) {
   ID3D12Resource& ret = *impl;
 
-  D3D12_RANGE rgn = {off,sz};
+  D3D12_RANGE rgn = {off,off+sz};
   void*       mapped=nullptr;
   dxAssert(ret.Map(0,&rgn,&mapped));
 
-  std::memcpy(data,mapped,sz);
+  std::memcpy(data,reinterpret_cast<uint8_t*>(mapped)+off,sz);
 
   ret.Unmap(0,nullptr);
   }
@@ -72,7 +72,7 @@ bool DxCommandBuffer::isRecording() const {
 
 void DxCommandBuffer::beginRenderPass(AbstractGraphicsApi::Fbo*  f,
                                       AbstractGraphicsApi::Pass* p,
-                                      uint32_t w, uint32_t h) {
+                                      uint32_t w, uint32_t h, bool /*bundles*/) {
   auto& fbo  = *reinterpret_cast<DxFramebuffer*>(f);
   auto& pass = *reinterpret_cast<DxRenderPass*>(p);
 
@@ -141,10 +141,14 @@ void DxCommandBuffer::beginRenderPass(AbstractGraphicsApi::Fbo*  f,
 void DxCommandBuffer::endRenderPass() {
   }
 
-void Tempest::Detail::DxCommandBuffer::setPipeline(Tempest::AbstractGraphicsApi::Pipeline& p,
-                                                   uint32_t /*w*/, uint32_t /*h*/) {
+void DxCommandBuffer::execute(const AbstractGraphicsApi::CommandBuffer&) {
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
+void Tempest::Detail::DxCommandBuffer::setPipeline(Tempest::AbstractGraphicsApi::Pipeline& p) {
   DxPipeline& px = reinterpret_cast<DxPipeline&>(p);
-  vboStride = px.stride;
+  vboStride  = px.stride;
+  instStride = px.instStride;
 
   impl->SetPipelineState(&px.instance(*currentFbo));
   impl->SetGraphicsRootSignature(px.sign.get());
@@ -163,11 +167,36 @@ void DxCommandBuffer::setViewport(const Rect& r) {
   impl->RSSetViewports(1, &vp);
   }
 
+void DxCommandBuffer::setScissor(const Rect& r) {
+  D3D12_RECT sr={};
+  sr.left   = LONG(r.x);
+  sr.top    = LONG(r.y);
+  sr.right  = LONG(r.x+r.w);
+  sr.bottom = LONG(r.y+r.h);
+  impl->RSSetScissorRects(1, &sr);
+  }
+
 void DxCommandBuffer::setBytes(AbstractGraphicsApi::Pipeline& p, const void* data, size_t size) {
   auto& px = reinterpret_cast<DxPipeline&>(p);
   impl->SetGraphicsRoot32BitConstants(px.pushConstantId,size/4,data,0);
   }
 
+void DxCommandBuffer::setComputePipeline(AbstractGraphicsApi::CompPipeline&) {
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
+void DxCommandBuffer::setBytes(AbstractGraphicsApi::CompPipeline&, const void*, size_t) {
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
+void DxCommandBuffer::setUniforms(AbstractGraphicsApi::CompPipeline&, AbstractGraphicsApi::Desc&) {
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
+void DxCommandBuffer::dispatch(size_t, size_t, size_t) {
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
 void DxCommandBuffer::setUniforms(AbstractGraphicsApi::Pipeline& /*p*/, AbstractGraphicsApi::Desc& u) {
   DxDescriptorArray& ux = reinterpret_cast<DxDescriptorArray&>(u);
 
@@ -194,6 +223,15 @@ void DxCommandBuffer::setUniforms(AbstractGraphicsApi::Pipeline& /*p*/, Abstract
     }
   }
 
+void DxCommandBuffer::setUniforms(AbstractGraphicsApi::Pipeline& p, AbstractGraphicsApi::Desc& u,
+                                  const uint32_t* offsets, size_t count) {
+  // dynamic offsets are not implemented on DirectX12
+  for(size_t i=0;i<count;++i)
+    if(offsets[i]!=0)
+      throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  setUniforms(p,u);
+  }
+
 void DxCommandBuffer::changeLayout(AbstractGraphicsApi::Swapchain& s, uint32_t id, TextureFormat /*frm*/,
                                    TextureLayout prev, TextureLayout next) {
   DxSwapchain&    sw  = reinterpret_cast<DxSwapchain&>(s);
@@ -245,6 +283,16 @@ void DxCommandBuffer::setVbo(const AbstractGraphicsApi::Buffer& b) {
   impl->IASetVertexBuffers(0,1,&view);
   }
 
+void DxCommandBuffer::setInstanceVbo(const AbstractGraphicsApi::Buffer& b) {
+  const DxBuffer& bx = reinterpret_cast<const DxBuffer&>(b);
+
+  D3D12_VERTEX_BUFFER_VIEW view;
+  view.BufferLocation = bx.impl.get()->GetGPUVirtualAddress();
+  view.SizeInBytes    = bx.sizeInBytes;
+  view.StrideInBytes  = instStride;
+  impl->IASetVertexBuffers(1,1,&view);
+  }
+
 void DxCommandBuffer::setIbo(const AbstractGraphicsApi::Buffer& b, IndexClass cls) {
   const DxBuffer& bx = reinterpret_cast<const DxBuffer&>(b);
   static const DXGI_FORMAT type[]={
@@ -259,24 +307,44 @@ void DxCommandBuffer::setIbo(const AbstractGraphicsApi::Buffer& b, IndexClass cl
   impl->IASetIndexBuffer(&view);
   }
 
-void DxCommandBuffer::draw(size_t offset, size_t vertexCount) {
-  impl->DrawInstanced(UINT(vertexCount),1,UINT(offset),0);
+void DxCommandBuffer::draw(size_t offset, size_t vertexCount, size_t firstInstance, size_t instanceCount) {
+  impl->DrawInstanced(UINT(vertexCount),UINT(instanceCount),UINT(offset),UINT(firstInstance));
+  }
+
+void DxCommandBuffer::drawIndexed(size_t ioffset, size_t isize, size_t voffset, size_t firstInstance, size_t instanceCount) {
+  impl->DrawIndexedInstanced(UINT(isize),UINT(instanceCount),UINT(ioffset),INT(voffset),UINT(firstInstance));
+  }
+
+void DxCommandBuffer::drawIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t /*stride*/) {
+  const DxBuffer& bx = reinterpret_cast<const DxBuffer&>(indirect);
+  // static buffers stay in COMMON state and are promoted to INDIRECT_ARGUMENT on use
+  impl->ExecuteIndirect(dev.drawSign.get(),UINT(drawCount),bx.impl.get(),UINT64(offset),nullptr,0);
   }
 
-void DxCommandBuffer::drawIndexed(size_t ioffset, size_t isize, size_t voffset) {
-  impl->DrawIndexedInstanced(UINT(isize),1,UINT(ioffset),INT(voffset),0);
+void DxCommandBuffer::drawIndexedIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t /*stride*/) {
+  const DxBuffer& bx = reinterpret_cast<const DxBuffer&>(indirect);
+  impl->ExecuteIndirect(dev.drawIndexedSign.get(),UINT(drawCount),bx.impl.get(),UINT64(offset),nullptr,0);
   }
 
 void DxCommandBuffer::flush(const DxBuffer&, size_t /*size*/) {
   // NOP
   }
 
+void DxCommandBuffer::uploadBarrier() {
+  // NOP: DirectX12Api::submit waits for upload batches on cpu
+  }
+
 void DxCommandBuffer::copy(DxBuffer& dest, size_t offsetDest, const DxBuffer& src, size_t offsetSrc, size_t size) {
   impl->CopyBufferRegion(dest.impl.get(),offsetDest,src.impl.get(),offsetSrc, size);
   }
 
 void DxCommandBuffer::copy(DxTexture& dest, size_t width, size_t height, size_t mip,
                            const DxBuffer& src, size_t offset) {
+  copy(dest,0,0,width,height,mip,src,offset);
+  }
+
+void DxCommandBuffer::copy(DxTexture& dest, size_t x, size_t y, size_t width, size_t height, size_t mip,
+                           const DxBuffer& src, size_t offset) {
   //assert(offset%512==0);
 
   D3D12_PLACED_SUBRESOURCE_FOOTPRINT foot = {};
@@ -307,11 +375,16 @@ void DxCommandBuffer::copy(DxTexture& dest, size_t width, size_t height, size_t
   srcLoc.Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
   srcLoc.PlacedFootprint  = foot;
 
-  impl->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+  impl->CopyTextureRegion(&dstLoc, UINT(x), UINT(y), 0, &srcLoc, nullptr);
   }
 
 void DxCommandBuffer::copy(DxBuffer& dest, size_t width, size_t height, size_t mip,
                            const DxTexture& src, size_t offset) {
+  copy(dest,0,0,width,height,mip,src,offset);
+  }
+
+void DxCommandBuffer::copy(DxBuffer& dest, size_t x, size_t y, size_t width, size_t height, size_t mip,
+                           const DxTexture& src, size_t offset) {
   const UINT bpp = src.bitCount()/8;
 
   D3D12_PLACED_SUBRESOURCE_FOOTPRINT foot = {};
@@ -332,7 +405,15 @@ void DxCommandBuffer::copy(DxBuffer& dest, size_t width, size_t height, size_t m
   dstLoc.Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
   dstLoc.PlacedFootprint  = foot;
 
-  impl->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+  D3D12_BOX box = {};
+  box.left   = UINT(x);
+  box.top    = UINT(y);
+  box.front  = 0;
+  box.right  = UINT(x+width);
+  box.bottom = UINT(y+height);
+  box.back   = 1;
+
+  impl->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, &box);
   }
 
 void DxCommandBuffer::generateMipmap(DxTexture& image, TextureFormat imageFormat, uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels) {
@@ -31,25 +31,38 @@ class DxCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
     bool isRecording() const override;
     void beginRenderPass(AbstractGraphicsApi::Fbo* f,
                          AbstractGraphicsApi::Pass*  p,
-                         uint32_t width,uint32_t height) override;
+                         uint32_t width,uint32_t height,bool bundles) override;
     void endRenderPass() override;
+    void execute(const AbstractGraphicsApi::CommandBuffer& bundle) override;
 
-    void setPipeline (AbstractGraphicsApi::Pipeline& p,uint32_t w,uint32_t h) override;
+    void setPipeline (AbstractGraphicsApi::Pipeline& p) override;
     void setViewport (const Rect& r) override;
+    void setScissor  (const Rect& r) override;
     void setBytes    (AbstractGraphicsApi::Pipeline& p, const void* data, size_t size) override;
     void setUniforms (AbstractGraphicsApi::Pipeline& p, AbstractGraphicsApi::Desc& u) override;
+    void setUniforms (AbstractGraphicsApi::Pipeline& p, AbstractGraphicsApi::Desc& u, const uint32_t* offsets, size_t count) override;
+    void setComputePipeline(AbstractGraphicsApi::CompPipeline& p) override;
+    void setBytes    (AbstractGraphicsApi::CompPipeline& p, const void* data, size_t size) override;
+    void setUniforms (AbstractGraphicsApi::CompPipeline& p, AbstractGraphicsApi::Desc& u) override;
+    void dispatch    (size_t x, size_t y, size_t z) override;
     void changeLayout(AbstractGraphicsApi::Swapchain& s, uint32_t id, TextureFormat frm, TextureLayout prev, TextureLayout next) override;
     void changeLayout(AbstractGraphicsApi::Texture& t,TextureFormat frm,TextureLayout prev,TextureLayout next) override;
     void changeLayout(AbstractGraphicsApi::Texture& t,TextureFormat frm,TextureLayout prev,TextureLayout next,uint32_t mipCnt);
     void setVbo      (const AbstractGraphicsApi::Buffer& b) override;
+    void setInstanceVbo(const AbstractGraphicsApi::Buffer& b) override;
     void setIbo      (const AbstractGraphicsApi::Buffer& b, Detail::IndexClass cls) override;
-    void draw        (size_t offset,size_t vertexCount) override;
-    void drawIndexed (size_t ioffset, size_t isize, size_t voffset) override;
+    void draw        (size_t offset,size_t vertexCount,size_t firstInstance,size_t instanceCount) override;
+    void drawIndexed (size_t ioffset, size_t isize, size_t voffset,size_t firstInstance,size_t instanceCount) override;
+    void drawIndirect       (const AbstractGraphicsApi::Buffer& indirect,size_t offset,size_t drawCount,size_t stride) override;
+    void drawIndexedIndirect(const AbstractGraphicsApi::Buffer& indirect,size_t offset,size_t drawCount,size_t stride) override;
 
     void flush(const Detail::DxBuffer& src, size_t size);
+    void uploadBarrier();
     void copy(DxBuffer&  dest, size_t offsetDest, const DxBuffer& src, size_t offsetSrc, size_t size);
     void copy(DxTexture& dest, size_t width, size_t height, size_t mip, const DxBuffer&  src, size_t offset);
+    void copy(DxTexture& dest, size_t x, size_t y, size_t width, size_t height, size_t mip, const DxBuffer& src, size_t offset);
     void copy(DxBuffer&  dest, size_t width, size_t height, size_t mip, const DxTexture& src, size_t offset);
+    void copy(DxBuffer&  dest, size_t x, size_t y, size_t width, size_t height, size_t mip, const DxTexture& src, size_t offset);
     void generateMipmap(DxTexture& image, TextureFormat imageFormat,
                         uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels);
 
@@ -68,6 +81,7 @@ class DxCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
     ID3D12DescriptorHeap*             currentHeaps[DxUniformsLay::MAX_BINDS]={};
 
     UINT                              vboStride=0;
+    UINT                              instStride=0;
 
     std::vector<ImgState>             imgState;
 
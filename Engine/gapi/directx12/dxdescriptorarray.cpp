@@ -25,6 +25,10 @@ static int swizzle(ComponentSwizzle cs, int def){
       return 2;
     case ComponentSwizzle::A:
       return 3;
+    case ComponentSwizzle::Zero:
+      return D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0;
+    case ComponentSwizzle::One:
+      return D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1;
     }
   return def;
   }
@@ -45,6 +45,19 @@ DxDevice::DxDevice(IDXGIAdapter1& adapter) {
 
   allocator.setDevice(*this);
 
+  D3D12_INDIRECT_ARGUMENT_DESC arg = {};
+  D3D12_COMMAND_SIGNATURE_DESC sign = {};
+  sign.NumArgumentDescs = 1;
+  sign.pArgumentDescs   = &arg;
+
+  arg.Type         = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+  sign.ByteStride  = sizeof(D3D12_DRAW_ARGUMENTS);
+  dxAssert(device->CreateCommandSignature(&sign, nullptr, uuid<ID3D12CommandSignature>(), reinterpret_cast<void**>(&drawSign)));
+
+  arg.Type         = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+  sign.ByteStride  = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+  dxAssert(device->CreateCommandSignature(&sign, nullptr, uuid<ID3D12CommandSignature>(), reinterpret_cast<void**>(&drawIndexedSign)));
+
   dxAssert(device->CreateFence(DxFence::Waiting, D3D12_FENCE_FLAG_NONE,
                                uuid<ID3D12Fence>(),
                                reinterpret_cast<void**>(&idleFence)));
@@ -102,17 +115,35 @@ void DxDevice::getProp(DXGI_ADAPTER_DESC1& desc, AbstractGraphicsApi::Props& pro
 
   prop.anisotropy    = true;
   prop.maxAnisotropy = 16;
+
+  prop.indirect.multiDraw     = true;
+  prop.indirect.maxDrawCount  = 0xFFFFFFFF;
+  prop.indirect.firstInstance = true;
   }
 
 void DxDevice::waitData() {
   data->wait();
   }
 
+bool DxDevice::isUploaded(uint64_t ticket) {
+  return data->isComplete(ticket);
+  }
+
+void DxDevice::waitUpload(uint64_t ticket) {
+  data->wait(ticket);
+  }
+
+AbstractGraphicsApi::MemoryStats DxDevice::memoryStats() {
+  // resources are committed: no sub-allocation to report
+  return MemoryStats();
+  }
+
 const char* Detail::DxDevice::renderer() const {
   return props.name;
   }
 
 void Detail::DxDevice::waitIdle() {
+  waitData(); // submit batched uploads
   std::lock_guard<SpinLock> guard(syncCmdQueue);
   dxAssert(cmdQueue->Signal(idleFence.get(),DxFence::Ready));
   dxAssert(idleFence->SetEventOnCompletion(DxFence::Ready,idleEvent));
@@ -120,6 +151,14 @@ void Detail::DxDevice::waitIdle() {
   dxAssert(idleFence->Signal(DxFence::Waiting));
   }
 
+void Detail::DxDevice::savePipelineCache(std::vector<uint8_t>& out) {
+  out.clear();
+  }
+
+bool Detail::DxDevice::loadPipelineCache(const void*, size_t) {
+  return false;
+  }
+
 void DxDevice::submit(DxCommandBuffer& cmdBuffer, DxFence& sync) {
   sync.reset();
 
@@ -105,6 +105,11 @@ class DxDevice : public AbstractGraphicsApi::Device {
     void         waitData();
     const char*  renderer() const override;
     void         waitIdle() override;
+    void         savePipelineCache(std::vector<uint8_t>& out) override;
+    bool         loadPipelineCache(const void* data, size_t size) override;
+    bool         isUploaded(uint64_t ticket) override;
+    void         waitUpload(uint64_t ticket) override;
+    MemoryStats  memoryStats() override;
 
     static void  getProp(IDXGIAdapter1& adapter, AbstractGraphicsApi::Props& prop);
     static void  getProp(DXGI_ADAPTER_DESC1& desc, AbstractGraphicsApi::Props& prop);
@@ -114,6 +119,8 @@ class DxDevice : public AbstractGraphicsApi::Device {
     ComPtr<ID3D12Device>       device;
     SpinLock                   syncCmdQueue;
     ComPtr<ID3D12CommandQueue> cmdQueue;
+    ComPtr<ID3D12CommandSignature> drawSign;
+    ComPtr<ID3D12CommandSignature> drawIndexedSign;
 
     DxAllocator                allocator;
 
@@ -33,11 +33,22 @@ DxFenceBase<Interface>::~DxFenceBase() {
 
 template<class Interface>
 void DxFenceBase<Interface>::wait() {
-  wait(Ready);
+  waitValue(Ready);
   }
 
 template<class Interface>
-void DxFenceBase<Interface>::wait(UINT64 val) {
+bool DxFenceBase<Interface>::wait(uint64_t timeout) {
+  if(impl->GetCompletedValue()==Ready)
+    return true;
+  if(timeout==0)
+    return false;
+  dxAssert(impl->SetEventOnCompletion(Ready,event));
+  DWORD ms = timeout>=INFINITE ? INFINITE : DWORD(timeout);
+  return WaitForSingleObjectEx(event, ms, FALSE)==WAIT_OBJECT_0;
+  }
+
+template<class Interface>
+void DxFenceBase<Interface>::waitValue(UINT64 val) {
   UINT64 v = impl->GetCompletedValue();
   if(val==v)
     return;
@@ -13,11 +13,12 @@ using namespace Tempest::Detail;
 
 DxPipeline::DxPipeline(DxDevice& device, const RenderState& st,
                        const Decl::ComponentType* decl, size_t declSize, size_t stride,
+                       size_t instDeclSize, size_t instStride,
                        Topology tp, const DxUniformsLay& ulay,
                        DxShader& vert, DxShader& frag)
-  : sign(ulay.impl.get()), stride(UINT(stride)),
+  : sign(ulay.impl.get()), stride(UINT(stride)), instStride(UINT(instStride)),
     device(device),
-    vsShader(&vert), fsShader(&frag), declSize(UINT(declSize)), rState(st) {
+    vsShader(&vert), fsShader(&frag), declSize(UINT(declSize+instDeclSize)), rState(st) {
   sign.get()->AddRef();
   static const D3D_PRIMITIVE_TOPOLOGY dxTopolgy[]= {
     D3D_PRIMITIVE_TOPOLOGY_UNDEFINED,
@@ -41,6 +42,9 @@ DxPipeline::DxPipeline(DxDevice& device, const RenderState& st,
 
     DXGI_FORMAT_R16G16_SNORM,
     DXGI_FORMAT_R16G16B16A16_SNORM,
+
+    DXGI_FORMAT_R16G16_UNORM,
+    DXGI_FORMAT_R16G16B16A16_UNORM,
     };
   static const uint32_t vertSize[]={
     0,
@@ -54,22 +58,28 @@ DxPipeline::DxPipeline(DxDevice& device, const RenderState& st,
     4,
     8,
 
+    4,
+    8,
+
     4,
     8
   };
 
-  vsInput.reset(new D3D12_INPUT_ELEMENT_DESC[declSize]);
+  vsInput.reset(new D3D12_INPUT_ELEMENT_DESC[declSize+instDeclSize]);
 
   uint32_t offset=0;
-  for(size_t i=0;i<declSize;++i){
+  for(size_t i=0;i<declSize+instDeclSize;++i){
+    const bool inst = (i>=declSize);
+    if(i==declSize)
+      offset = 0;
     auto& loc=vsInput[i];
     loc.SemanticName         = "TEXCOORD"; // spirv cross compiles everything as TEXCOORD
     loc.SemanticIndex        = UINT(i);
     loc.Format               = vertFormats[decl[i]];
-    loc.InputSlot            = 0;
+    loc.InputSlot            = inst ? 1 : 0;
     loc.AlignedByteOffset    = offset;
-    loc.InputSlotClass       = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
-    loc.InstanceDataStepRate = 0;
+    loc.InputSlotClass       = inst ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+    loc.InstanceDataStepRate = inst ? 1 : 0;
 
     offset+=vertSize[decl[i]];
     }
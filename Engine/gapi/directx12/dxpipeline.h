@@ -21,7 +21,7 @@ class DxPipeline : public AbstractGraphicsApi::Pipeline {
     DxPipeline(DxDevice &device,
                const RenderState &st,
                const Decl::ComponentType *decl, size_t declSize,
-               size_t stride, Topology tp,
+               size_t stride, size_t instDeclSize, size_t instStride, Topology tp,
                const DxUniformsLay& ulay,
                DxShader &vert, DxShader &frag);
 
@@ -37,6 +37,7 @@ class DxPipeline : public AbstractGraphicsApi::Pipeline {
     ComPtr<ID3D12RootSignature> sign;
 
     UINT                        stride=0;
+    UINT                        instStride=0;
     D3D_PRIMITIVE_TOPOLOGY      topology=D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
     size_t                      pushConstantId=0;
 
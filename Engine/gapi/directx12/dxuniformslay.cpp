@@ -93,6 +93,11 @@ DxUniformsLay::DxUniformsLay(DxDevice& dev,
         add(l,D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER,desc);
         break;
         }
+      case UniformsLayout::Ssbo:
+      case UniformsLayout::Image: {
+        add(l,D3D12_DESCRIPTOR_RANGE_TYPE_UAV,desc);
+        break;
+        }
       case UniformsLayout::Push: {
         //TODO
         break;
@@ -20,8 +20,13 @@
 #include "directx12/dxrenderpass.h"
 #include "directx12/dxfbolayout.h"
 
+#include "graphicsmemutils.h"
+#include "pixmapreadback.h"
+
 #include <Tempest/Pixmap>
 
+#include <cstring>
+
 using namespace Tempest;
 using namespace Tempest::Detail;
 
@@ -185,6 +190,7 @@ AbstractGraphicsApi::PFboLayout DirectX12Api::createFboLayout(AbstractGraphicsAp
 
 AbstractGraphicsApi::PPipeline DirectX12Api::createPipeline(AbstractGraphicsApi::Device* d, const RenderState& st,
                                                             const Decl::ComponentType* decl, size_t declSize, size_t stride,
+                                                            size_t instDeclSize, size_t instStride,
                                                             Topology tp,
                                                             const UniformsLay& ulayImpl,
                                                             const std::initializer_list<AbstractGraphicsApi::Shader*>& shaders) {
@@ -194,7 +200,7 @@ AbstractGraphicsApi::PPipeline DirectX12Api::createPipeline(AbstractGraphicsApi:
   auto* fs = reinterpret_cast<Detail::DxShader*>(arr[1]);
   auto& ul = reinterpret_cast<const Detail::DxUniformsLay&>(ulayImpl);
 
-  return PPipeline(new Detail::DxPipeline(*dx,st,decl,declSize,stride,tp,ul,*vs,*fs));
+  return PPipeline(new Detail::DxPipeline(*dx,st,decl,declSize,stride,instDeclSize,instStride,tp,ul,*vs,*fs));
   }
 
 AbstractGraphicsApi::PShader DirectX12Api::createShader(AbstractGraphicsApi::Device*,
@@ -222,17 +228,23 @@ AbstractGraphicsApi::PBuffer DirectX12Api::createBuffer(AbstractGraphicsApi::Dev
     return PBuffer(new Detail::DxBuffer(std::move(stage)));
     }
   else {
-    Detail::DxBuffer  stage=dx.allocator.alloc(mem,    count,size,alignedSz,MemUsage::TransferSrc,      BufferHeap::Upload);
     Detail::DxBuffer  buf  =dx.allocator.alloc(nullptr,count,size,alignedSz,usage|MemUsage::TransferDst,BufferHeap::Static);
-
-    Detail::DSharedPtr<Detail::DxBuffer*> pstage(new Detail::DxBuffer(std::move(stage)));
     Detail::DSharedPtr<Detail::DxBuffer*> pbuf  (new Detail::DxBuffer(std::move(buf)));
 
-    DxDevice::Data dat(dx);
-    dat.flush(*pstage.handler,count*alignedSz);
+    DxDevice::Data  dat(dx);
+    const DxBuffer* stage  = nullptr;
+    size_t          offset = 0;
+    if(auto ptr = dat.stage(count*alignedSz,16,stage,offset)) {
+      copyUpsample(mem,ptr,count,size,alignedSz);
+      } else {
+      Detail::DxBuffer s=dx.allocator.alloc(mem,count,size,alignedSz,MemUsage::TransferSrc,BufferHeap::Upload);
+      Detail::DSharedPtr<Detail::DxBuffer*> pstage(new Detail::DxBuffer(std::move(s)));
+      dat.flush(*pstage.handler,count*alignedSz);
+      dat.hold(pstage); // preserve stage buffer, until gpu side copy is finished
+      stage = pstage.handler;
+      }
     dat.hold(pbuf);
-    dat.hold(pstage); // preserve stage buffer, until gpu side copy is finished
-    dat.copy(*pbuf.handler,*pstage.handler,count*alignedSz);
+    dat.copy(*pbuf.handler,0,*stage,offset,count*alignedSz);
     dat.commit();
 
     return PBuffer(pbuf.handler);
@@ -240,15 +252,30 @@ AbstractGraphicsApi::PBuffer DirectX12Api::createBuffer(AbstractGraphicsApi::Dev
   return PBuffer();
   }
 
+AbstractGraphicsApi::PBuffer DirectX12Api::createMappedBuffer(Device* d, size_t size, MemUsage usage, void*& mapped) {
+  Detail::DxDevice& dx  = *reinterpret_cast<Detail::DxDevice*>(d);
+  // upload heap is coherent; resource release unmaps it
+  Detail::DxBuffer  buf = dx.allocator.alloc(nullptr,size,1,1,usage,BufferHeap::Upload);
+  mapped = dx.allocator.map(buf);
+  return PBuffer(new Detail::DxBuffer(std::move(buf)));
+  }
+
 AbstractGraphicsApi::Desc* DirectX12Api::createDescriptors(AbstractGraphicsApi::Device* d, UniformsLay& layP) {
   Detail::DxDevice&      dx = *reinterpret_cast<Detail::DxDevice*>(d);
   Detail::DxUniformsLay& u  = reinterpret_cast<Detail::DxUniformsLay&>(layP);
   return new DxDescriptorArray(dx,u);
   }
 
+AbstractGraphicsApi::PCompPipeline DirectX12Api::createComputePipeline(Device*, const UniformsLay&, Shader*) {
+  // compute is not implemented on DirectX12: Props::compute.enabled is false
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
 AbstractGraphicsApi::PUniformsLay DirectX12Api::createUboLayout(Device* d, const std::initializer_list<Shader*>& shaders) {
   Shader*const*        arr=shaders.begin();
   auto* dx = reinterpret_cast<Detail::DxDevice*>(d);
+  if(shaders.size()==1)
+    throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
   auto* vs = reinterpret_cast<Detail::DxShader*>(arr[0]);
   auto* fs = reinterpret_cast<Detail::DxShader*>(arr[1]);
 
@@ -266,22 +293,28 @@ AbstractGraphicsApi::PTexture DirectX12Api::createTexture(Device* d, const Pixma
   DXGI_FORMAT       format = Detail::nativeFormat(frm);
   uint32_t          row    = p.w()*p.bpp();
   const uint32_t    pith   = ((row+D3D12_TEXTURE_DATA_PITCH_ALIGNMENT-1)/D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)*D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
-  Detail::DxBuffer  stage  = dx.allocator.alloc(p.data(),p.h(),row,pith,MemUsage::TransferSrc,BufferHeap::Upload);
   Detail::DxTexture buf    = dx.allocator.alloc(p,mipCnt,format);
-
-  Detail::DSharedPtr<Detail::DxBuffer*>  pstage(new Detail::DxBuffer (std::move(stage)));
-  Detail::DSharedPtr<Detail::DxTexture*> pbuf  (new Detail::DxTexture(std::move(buf)));
+  Detail::DSharedPtr<Detail::DxTexture*> pbuf(new Detail::DxTexture(std::move(buf)));
 
   Detail::DxDevice::Data dat(dx);
-  dat.hold(pstage);
+  const DxBuffer*        stage  = nullptr;
+  size_t                 offset = 0;
+  if(auto ptr = dat.stage(size_t(p.h())*pith,D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,stage,offset)) {
+    copyUpsample(p.data(),ptr,p.h(),row,pith);
+    } else {
+    Detail::DxBuffer s = dx.allocator.alloc(p.data(),p.h(),row,pith,MemUsage::TransferSrc,BufferHeap::Upload);
+    Detail::DSharedPtr<Detail::DxBuffer*> pstage(new Detail::DxBuffer(std::move(s)));
+    dat.hold(pstage);
+    stage  = pstage.handler;
+    }
   dat.hold(pbuf);
 
   // dat.changeLayout(*pbuf.handler, frm, TextureLayout::Undefined, TextureLayout::TransferDest, mipCnt);
-  dat.copy(*pbuf.handler,p.w(),p.h(),0,*pstage.handler,0);
+  dat.copy(*pbuf.handler,p.w(),p.h(),0,*stage,offset);
   if(mipCnt>1)
     dat.generateMipmap(*pbuf.handler,frm,p.w(),p.h(),mipCnt); else
     dat.changeLayout(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler,mipCnt);
-  dat.commit();
+  pbuf.handler->ticket = dat.commit();
   return PTexture(pbuf.handler);
   }
 
@@ -340,11 +373,12 @@ AbstractGraphicsApi::PTexture DirectX12Api::createCompressedTexture(Device* d, c
     }
 
   dat.changeLayout(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler, mipCnt);
-  dat.commit();
+  pbuf.handler->ticket = dat.commit();
   return PTexture(pbuf.handler);
   }
 
-AbstractGraphicsApi::PTexture DirectX12Api::createTexture(Device* d, const uint32_t w, const uint32_t h, uint32_t mipCnt, TextureFormat frm) {
+AbstractGraphicsApi::PTexture DirectX12Api::createTexture(Device* d, const uint32_t w, const uint32_t h, uint32_t mipCnt, TextureFormat frm, bool /*storage*/) {
+  // storage images are compute-only: compute is not implemented on DirectX12
   Detail::DxDevice& dx = *reinterpret_cast<Detail::DxDevice*>(d);
 
   Detail::DxTexture buf=dx.allocator.alloc(w,h,mipCnt,frm);
@@ -353,8 +387,8 @@ AbstractGraphicsApi::PTexture DirectX12Api::createTexture(Device* d, const uint3
   return PTexture(pbuf.handler);
   }
 
-void DirectX12Api::readPixels(Device* d, Pixmap& out, const PTexture t, TextureLayout lay,
-                              TextureFormat frm, const uint32_t w, const uint32_t h, uint32_t mip) {
+AbstractGraphicsApi::Readback* DirectX12Api::readPixels(Device* d, const PTexture t, TextureLayout lay,
+                                                       TextureFormat frm, const Rect& r, uint32_t mip) {
   Detail::DxDevice&  dx = *reinterpret_cast<Detail::DxDevice*>(d);
   Detail::DxTexture& tx = *reinterpret_cast<Detail::DxTexture*>(t.handler);
 
@@ -383,20 +417,89 @@ void DirectX12Api::readPixels(Device* d, Pixmap& out, const PTexture t, TextureL
     case TextureFormat::DXT5:      bpp=0; break;
     }
 
-  const size_t     size  = w*h*bpp;
+  if(mip>=tx.mips)
+    throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+
+  // rows of readback footprint are aligned to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+  const uint32_t   w     = uint32_t(r.w);
+  const uint32_t   h     = uint32_t(r.h);
+  const size_t     pitch = alignTo(UINT(w*bpp),D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+  const size_t     size  = pitch*h;
   Detail::DxBuffer stage = dx.allocator.alloc(nullptr,size,1,1,MemUsage::TransferDst,BufferHeap::Readback);
+  Detail::DSharedPtr<Detail::DxBuffer*>  pstage(new Detail::DxBuffer(std::move(stage)));
+  Detail::DSharedPtr<Detail::DxTexture*> ptex(&tx);
 
-  //TODO: D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
   Detail::DxDevice::Data dat(dx);
-  dat.changeLayout(tx, frm, lay, TextureLayout::TransferSrc, 1);
-  dat.copy(stage,w,h,mip,tx,0);
-  dat.changeLayout(tx, frm, TextureLayout::TransferSrc, lay, 1);
-  dat.commit();
+  dat.hold(pstage);
+  dat.hold(ptex);
+  dat.changeLayout(tx, frm, lay, TextureLayout::TransferSrc, tx.mips);
+  dat.copy(*pstage.handler,uint32_t(r.x),uint32_t(r.y),w,h,mip,tx,0);
+  dat.changeLayout(tx, frm, TextureLayout::TransferSrc, lay, tx.mips);
+  const uint64_t ticket = dat.commit();
 
-  dx.waitData();
+  return new Detail::PixmapReadback<Detail::DxDevice,Detail::DxBuffer>(dx,std::move(pstage),ticket,w,h,pfrm,bpp,pitch);
+  }
 
-  out = Pixmap(w,h,pfrm);
-  stage.read(out.data(),0,size);
+void DirectX12Api::readBytes(Device* d, Buffer* buf, void* out, size_t size) {
+  Detail::DxDevice& dx = *reinterpret_cast<Detail::DxDevice*>(d);
+  Detail::DxBuffer& bx = *reinterpret_cast<Detail::DxBuffer*>(buf);
+
+  Detail::DxBuffer stage = dx.allocator.alloc(nullptr,size,1,1,MemUsage::TransferDst,BufferHeap::Readback);
+  // order copy after every submitted frame
+  dx.waitIdle();
+
+  Detail::DxDevice::Data dat(dx);
+  dat.copy(stage,0,bx,0,size);
+  dx.waitUpload(dat.commit());
+
+  stage.read(out,0,size);
+  }
+
+void DirectX12Api::updateTexture(Device* d, PTexture t, const Pixmap& p, TextureFormat frm,
+                                 const Rect* rect, size_t count) {
+  Detail::DxDevice&  dx  = *reinterpret_cast<Detail::DxDevice*>(d);
+  Detail::DxTexture& tx  = *reinterpret_cast<Detail::DxTexture*>(t.handler);
+  // compressed formats are copied as rows of 4x4 blocks; rects are block-aligned
+  const uint32_t     blk = isCompressedFormat(frm) ? 4 : 1;
+  const uint32_t     bpp = isCompressedFormat(frm) ? (frm==TextureFormat::DXT1 ? 8 : 16) : p.bpp();
+  const uint32_t     pw  = (p.w()+blk-1)/blk;
+
+  std::vector<uint32_t> offset(count);
+  uint32_t size = 0;
+  for(size_t i=0;i<count;++i) {
+    const uint32_t pitch = alignTo((uint32_t(rect[i].w)+blk-1)/blk*bpp,D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+    offset[i] = size;
+    size     += pitch*((uint32_t(rect[i].h)+blk-1)/blk);
+    size      = alignTo(size,D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    }
+  if(size==0)
+    return;
+
+  std::vector<uint8_t> tmp(size);
+  auto src = reinterpret_cast<const uint8_t*>(p.data());
+  for(size_t i=0;i<count;++i) {
+    const Rect&    r     = rect[i];
+    const uint32_t row   = (uint32_t(r.w)+blk-1)/blk*bpp;
+    const uint32_t h     = (uint32_t(r.h)+blk-1)/blk;
+    const uint32_t pitch = alignTo(row,D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+    for(uint32_t y=0;y<h;++y)
+      std::memcpy(&tmp[offset[i]+y*pitch], src+(size_t(uint32_t(r.y)/blk+y)*pw+size_t(r.x)/blk)*bpp, row);
+    }
+
+  Detail::DxBuffer stage = dx.allocator.alloc(tmp.data(),size,1,1,MemUsage::TransferSrc,BufferHeap::Upload);
+  Detail::DSharedPtr<Detail::DxBuffer*>  pstage(new Detail::DxBuffer(std::move(stage)));
+  Detail::DSharedPtr<Detail::DxTexture*> ptex  (&tx);
+
+  Detail::DxDevice::Data dat(dx);
+  dat.hold(pstage);
+  dat.hold(ptex);
+  dat.changeLayout(tx, frm, TextureLayout::Sampler, TextureLayout::TransferDest, 1);
+  for(size_t i=0;i<count;++i) {
+    const Rect& r = rect[i];
+    dat.copy(tx,uint32_t(r.x),uint32_t(r.y),uint32_t(r.w),uint32_t(r.h),0,*pstage.handler,offset[i]);
+    }
+  dat.changeLayout(tx, frm, TextureLayout::TransferDest, TextureLayout::Sampler, 1);
+  dat.commit();
   }
 
 AbstractGraphicsApi::CommandBuffer* DirectX12Api::createCommandBuffer(Device* d) {
@@ -404,6 +507,11 @@ AbstractGraphicsApi::CommandBuffer* DirectX12Api::createCommandBuffer(Device* d)
   return new DxCommandBuffer(*dx);
   }
 
+AbstractGraphicsApi::CommandBuffer* DirectX12Api::createCommandBundle(Device*, FboLayout*, uint32_t, uint32_t) {
+  // command bundles are not implemented on DirectX12
+  throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  }
+
 void DirectX12Api::present(AbstractGraphicsApi::Device* d, AbstractGraphicsApi::Swapchain* sw,
                            uint32_t imageId, const AbstractGraphicsApi::Semaphore* wait) {
   // TODO: handle imageId
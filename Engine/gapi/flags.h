@@ -10,6 +10,8 @@ enum class MemUsage : uint8_t {
   UniformBuffer=1<<2,
   VertexBuffer =1<<3,
   IndexBuffer  =1<<4,
+  StorageBuffer=1<<5,
+  Indirect     =1<<6,
   };
 
 inline MemUsage operator | (MemUsage a,const MemUsage& b) {
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+#include <Tempest/Pixmap>
+
+#include <cstring>
+#include <vector>
+
+#include "utility/dptr.h"
+
+namespace Tempest {
+namespace Detail {
+
+// rows of readback buffer, that are copied by data engine with given pitch
+template<class Device, class Buffer>
+class PixmapReadback : public AbstractGraphicsApi::Readback {
+  public:
+    PixmapReadback(Device& dev, DSharedPtr<Buffer*> stage, uint64_t ticket,
+                   uint32_t w, uint32_t h, Pixmap::Format frm, size_t bpp, size_t pitch)
+      :dev(dev), stage(std::move(stage)), ticket(ticket), w(w), h(h), frm(frm), bpp(bpp), pitch(pitch) {
+      }
+
+    bool isReady() override {
+      return dev.isUploaded(ticket);
+      }
+
+    void wait() override {
+      dev.waitUpload(ticket);
+      }
+
+    void read(Pixmap& out) override {
+      wait();
+      out = Pixmap(w,h,frm);
+
+      auto         dst = reinterpret_cast<uint8_t*>(out.data());
+      const size_t row = w*bpp;
+      if(row==pitch) {
+        stage.handler->read(dst,0,row*h);
+        return;
+        }
+      std::vector<uint8_t> tmp(pitch*h);
+      stage.handler->read(tmp.data(),0,tmp.size());
+      for(size_t i=0;i<h;++i)
+        std::memcpy(dst+i*row,tmp.data()+i*pitch,row);
+      }
+
+  private:
+    Device&             dev;
+    DSharedPtr<Buffer*> stage;
+    uint64_t            ticket=0;
+    uint32_t            w=0;
+    uint32_t            h=0;
+    Pixmap::Format      frm=Pixmap::Format::RGBA;
+    size_t              bpp=0;
+    size_t              pitch=0;
+  };
+
+}
+}
@@ -3,6 +3,9 @@
 #include <Tempest/Point>
 
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <tuple>
 #include <cstdint>
 #include <cstddef>
 #include <atomic>
@@ -15,12 +18,28 @@ class RectAllocator {
   private:
     struct Page;
     struct Node;
+    struct Shelf;
     template<class T>
     struct Allocator;
 
   public:
     using Memory=typename MemoryProvider::DeviceMemory;
 
+    enum Packing : uint8_t {
+      P_Tree,  // 3-way split tree; tight packing, linear lookup
+      P_Shelf, // rows of equal height; O(log n) lookup by height, rows are recycled once empty
+      };
+
+    struct Move {
+      size_t      srcPage=0;
+      Rect        src;
+      size_t      dstPage=0;
+      Point       dst;
+      // pageId() of allocation before and after compaction; source id is dangling after compact returns
+      const void* srcId=nullptr;
+      const void* dstId=nullptr;
+      };
+
     explicit RectAllocator(MemoryProvider& device):device(device){}
 
     RectAllocator(const RectAllocator&)=delete;
@@ -30,51 +49,46 @@ class RectAllocator {
       Allocation()=default;
 
       Allocation(Allocation&& a)
-        :owner(a.owner),node(a.node),pId(a.pId){
+        :owner(a.owner),node(a.node){
         a.owner=nullptr;
         a.node =nullptr;
-        a.pId  =0;
         }
 
-      Allocation(const Allocation& a):owner(a.owner),node(a.node),pId(a.pId) {
+      Allocation(const Allocation& a):owner(a.owner),node(a.node) {
         if(node!=nullptr)
           node->addref();
         }
 
       ~Allocation(){
-        if(node!=nullptr)
-          node->decref();
+        release();
         }
 
       Allocation& operator=(const Allocation& a){
         if(a.node!=nullptr)
           a.node->addref();
-        if(node!=nullptr)
-          node->decref();
+        release();
         owner=a.owner;
         node =a.node;
-        pId  =a.pId;
         return *this;
         }
 
       Allocation& operator=(Allocation&& a){
         std::swap(owner,a.owner);
         std::swap(node ,a.node);
-        std::swap(pId  ,a.pId);
         return *this;
         }
 
       Memory& memory(){
-        return owner->pages[pId].memory;
+        return owner->pages[node->page].memory;
         }
 
       const Memory& memory() const {
-        return owner->pages[pId].memory;
+        return owner->pages[node->page].memory;
         }
 
       Rect pageRect() const {
-        auto& p=owner->pages[pId];
-        return Rect(int(node->x),int(node->y),int(p.root->w),int(p.root->h));
+        auto& p=owner->pages[node->page];
+        return Rect(int(node->x),int(node->y),int(p.w),int(p.h));
         }
 
       Point pos() const {
@@ -82,27 +96,86 @@ class RectAllocator {
         }
 
       void* pageId() const {
-        return owner==nullptr ? nullptr : &owner->pages[pId];
+        return owner==nullptr ? nullptr : &owner->pages[node->page];
+        }
+
+      void touch(uint32_t frame) const {
+        if(node!=nullptr)
+          node->lastUse.store(frame,std::memory_order_relaxed);
+        }
+
+      uint32_t lastUse() const {
+        return node==nullptr ? 0 : node->lastUse.load(std::memory_order_relaxed);
         }
 
       RectAllocator* owner=nullptr;
       Node*          node =nullptr;
-      size_t         pId  =0;
+
+      private:
+        void release() {
+          if(node==nullptr)
+            return;
+          // node can be merged by allocator, as soon as it's free
+          const bool tree = (node->shelf==nullptr);
+          if(node->decref() && tree)
+            owner->freed.fetch_add(1,std::memory_order_release);
+          }
       };
 
+    void     setPageSize(uint32_t sz) { defPageSize = sz; }
+    uint32_t pageSize() const { return defPageSize; }
+
+    // applies to pages created after this call
+    void     setPacking(Packing p) { packing = p; }
+    Packing  packingMode() const { return packing; }
+
+    size_t   pageCount() const { return pages.size(); }
+
+    // total area of all pages, in pixels
+    size_t   area() const {
+      size_t ret=0;
+      for(auto& p:pages)
+        ret += size_t(p.w)*size_t(p.h);
+      return ret;
+      }
+
+    // calls fn(w,h,lastUse) for each live allocation
+    template<class Fn>
+    void     forEachLive(Fn fn) const {
+      std::vector<Node*> live;
+      for(auto& p:pages)
+        p.collect(live);
+      for(auto i:live)
+        fn(i->w,i->h,i->lastUse.load(std::memory_order_relaxed));
+      }
+
     Allocation alloc(uint32_t iw,uint32_t ih) {
       if(iw==0 || ih==0)
         return Allocation();
 
-      for(size_t i=0;i<pages.size();++i){
-        auto a=alloc(pages[i],i,iw,ih);
+      if(freed.exchange(0,std::memory_order_acquire)>0) {
+        for(auto& p:pages)
+          if(p.root!=nullptr)
+            Page::coalesce(*p.root);
+        }
+
+      if(packing==P_Shelf) {
+        auto a=allocShelf(iw,ih);
         if(a.owner)
           return a;
+        } else {
+        for(size_t i=0;i<pages.size();++i){
+          if(pages[i].packing!=P_Tree)
+            continue;
+          auto a=alloc(pages[i],i,iw,ih);
+          if(a.owner)
+            return a;
+          }
         }
       const uint32_t w=std::max(iw,defPageSize);
       const uint32_t h=std::max(ih,defPageSize);
 
-      pages.emplace_back(*this,w,h);
+      pages.emplace_back(*this,w,h,packing);
       auto a=alloc(pages.back(),pages.size()-1,iw,ih);
       if(a.owner)
         return a;
@@ -110,16 +183,74 @@ class RectAllocator {
       throw std::bad_alloc();
       }
 
+    // Repacks all live allocations into as few pages as possible, using current packing and page size.
+    // For every moved rect copy(srcMemory,dstMemory,move) is called, while both pages are alive;
+    // outstanding Allocation objects stay valid and point to the new location.
+    // Not thread-safe: no allocations should happen concurrently.
+    template<class Fn>
+    std::vector<Move> compact(Fn copy) {
+      std::vector<Node*> live;
+      for(auto& p:pages)
+        p.collect(live);
+      std::sort(live.begin(),live.end(),[](const Node* a,const Node* b){
+        return std::tie(a->h,a->w) > std::tie(b->h,b->w);
+        });
+
+      std::vector<Page> old;
+      std::swap(old,pages);
+      shelves.clear();
+
+      std::vector<Move> mv(live.size());
+      for(size_t i=0;i<live.size();++i) {
+        Node* ln = live[i];
+        Move& m  = mv[i];
+        m.srcPage = ln->page;
+        m.src     = Rect(int(ln->x),int(ln->y),int(ln->w),int(ln->h));
+        m.srcId   = &old[ln->page];
+
+        Allocation a = alloc(ln->w,ln->h);
+        Node*      nx = a.node;
+        a.owner = nullptr;
+        a.node  = nullptr;
+
+        old[ln->page].detach(ln);
+        transplant(nx,ln);
+        m.dstPage = ln->page;
+        m.dst     = Point(int(ln->x),int(ln->y));
+        }
+
+      for(auto& m:mv) {
+        m.dstId = &pages[m.dstPage];
+        copy(old[m.srcPage].memory,pages[m.dstPage].memory,m);
+        }
+      return mv;
+      }
+
   private:
     MemoryProvider&   device;
     std::vector<Page> pages;
-    uint32_t          defPageSize=512; //TODO: get-set
+    // tree nodes released since last coalesce; Allocation can be released from any thread
+    std::atomic<size_t> freed{0};
+    uint32_t          defPageSize=512;
+    Packing           packing=P_Tree;
+
+    // free shelves, ordered by height
+    std::multimap<uint32_t,Shelf*> shelves;
+
+    enum {
+      ShelfAlign = 4,
+      ShelfProbe = 8,
+      };
 
     struct Node {
       Node()=default;
-      Node(uint32_t x,uint32_t y,uint32_t w,uint32_t h,Node* owner):x(x),y(y),w(w),h(h),owner(owner){}
+      Node(uint32_t x,uint32_t y,uint32_t w,uint32_t h,Node* owner):x(x),y(y),w(w),h(h),owner(owner){
+        if(owner!=nullptr)
+          page=owner->page;
+        }
 
       std::atomic<uint32_t> refcount{};
+      std::atomic<uint32_t> lastUse{};
 
       uint32_t x=0;
       uint32_t y=0;
@@ -146,14 +277,20 @@ class RectAllocator {
 
       Node*    owner=nullptr;
       Node*    sub[3]={};
+      Shelf*   shelf=nullptr;
+      size_t   page =0;
 
       void     remove(Node* n){
+        replace(n,nullptr);
+        }
+
+      void     replace(Node* n,Node* to){
         if(sub[0]==n)
-          sub[0]=nullptr;
+          sub[0]=to;
         else if(sub[1]==n)
-          sub[1]=nullptr;
+          sub[1]=to;
         else if(sub[2]==n)
-          sub[2]=nullptr;
+          sub[2]=to;
         }
 
       bool hasLeafs() const {
@@ -164,46 +301,225 @@ class RectAllocator {
         refcount.fetch_add(1,std::memory_order_acq_rel);
         }
 
-      void decref() {
-        Node* nx=this;
-        if(nx->refcount.fetch_add(-1,std::memory_order_acq_rel)!=1)
-          return;
-
-        Node* ow=nx->owner;
-        while(true) {
-          ow->remove(nx);
-          nx=ow;
-          if(nx==nullptr || nx->hasLeafs())
-            return;
-          }
-        delete this;
+      // true, if node is free now
+      bool decref() {
+        if(refcount.fetch_add(-1,std::memory_order_acq_rel)!=1)
+          return false;
+        // released leaf is merged by next alloc; shelf is recycled by allocator, once it's empty
+        if(shelf!=nullptr)
+          shelf->live.fetch_sub(1,std::memory_order_acq_rel);
+        return true;
         }
 
       Point pos() const { return Point(x,y); }
       };
 
+    struct Shelf {
+      Shelf(uint32_t y,uint32_t w,uint32_t h,size_t page):y(y),w(w),h(h),page(page){}
+      ~Shelf(){
+        for(auto i:nodes)
+          delete i;
+        }
+
+      std::atomic<uint32_t> live{};
+      uint32_t              y=0;
+      uint32_t              w=0;
+      uint32_t              h=0;
+      uint32_t              x=0;
+      size_t                page=0;
+      bool                  indexed=false;
+      std::vector<Node*>    nodes;
+
+      void reset() {
+        for(auto i:nodes)
+          delete i;
+        nodes.clear();
+        x = 0;
+        }
+      };
+
     struct Page {
-      Page(RectAllocator& owner,uint32_t w,uint32_t h)
-        :owner(owner),root(new Node(0,0,w,h,nullptr)) {
+      Page(RectAllocator& owner,uint32_t w,uint32_t h,Packing packing)
+        :owner(owner),w(w),h(h),packing(packing) {
+        if(packing==P_Tree) {
+          root.reset(new Node(0,0,w,h,nullptr));
+          root->page = owner.pages.size();
+          }
         memory = owner.device.alloc(w,h);// std::bad_alloc, if error
         }
 
-      Page(Page&&)=default;
+      Page(Page&& p)
+        :owner(p.owner),w(p.w),h(p.h),packing(p.packing),root(std::move(p.root)),
+         shelf(std::move(p.shelf)),top(p.top),memory(std::move(p.memory)) {
+        p.memory = Memory();
+        }
 
       ~Page(){
+        if(root!=nullptr)
+          freeTree(*root);
         // memory!=null; 100%!!
         owner.device.free(memory);
         }
 
-      RectAllocator&        owner;
-      std::unique_ptr<Node> root;
-      Memory                memory={};
+      static void freeTree(Node& n) {
+        for(auto& i:n.sub) {
+          if(i==nullptr)
+            continue;
+          freeTree(*i);
+          delete i;
+          i = nullptr;
+          }
+        }
+
+      // merges free siblings back into parent; true, if whole subtree is free
+      static bool coalesce(Node& n) {
+        if(n.refcount.load(std::memory_order_acquire)>0)
+          return false;
+        bool free = true;
+        for(auto i:n.sub)
+          if(i!=nullptr && !coalesce(*i))
+            free = false;
+        if(!free)
+          return false;
+        for(auto& i:n.sub) {
+          delete i;
+          i = nullptr;
+          }
+        return true;
+        }
+
+      void collect(std::vector<Node*>& out) const {
+        if(root!=nullptr)
+          collect(*root,out);
+        for(auto& s:shelf)
+          for(auto i:s->nodes)
+            if(i!=nullptr && i->refcount.load(std::memory_order_acquire)>0)
+              out.push_back(i);
+        }
+
+      static void collect(Node& n,std::vector<Node*>& out) {
+        if(n.refcount.load(std::memory_order_acquire)>0) {
+          out.push_back(&n);
+          return;
+          }
+        for(auto i:n.sub)
+          if(i!=nullptr)
+            collect(*i,out);
+        }
+
+      void detach(Node* n) {
+        if(n->owner!=nullptr)
+          n->owner->remove(n);
+        else if(n==root.get())
+          root.release();
+        if(n->shelf!=nullptr)
+          std::replace(n->shelf->nodes.begin(),n->shelf->nodes.end(),n,static_cast<Node*>(nullptr));
+        }
+
+      RectAllocator&                      owner;
+      uint32_t                            w=0;
+      uint32_t                            h=0;
+      Packing                             packing=P_Tree;
+      std::unique_ptr<Node>               root;
+      std::vector<std::unique_ptr<Shelf>> shelf;
+      uint32_t                            top=0;
+      Memory                              memory={};
       };
 
     Allocation alloc(Page& p,size_t page,uint32_t pw,uint32_t ph) {
+      if(p.packing==P_Shelf)
+        return allocShelf(p,page,pw,ph);
       return alloc(*p.root,page,pw,ph);
       }
 
+    Allocation allocShelf(uint32_t pw,uint32_t ph) {
+      // shelves of close height first: no more, than 50% vertical waste
+      auto it = shelves.lower_bound(ph);
+      for(size_t i=0; i<ShelfProbe && it!=shelves.end() && it->first<=ph+ph/2; ++i, ++it) {
+        Shelf& s = *it->second;
+        if(s.x!=0 && s.live.load(std::memory_order_acquire)==0)
+          s.reset();
+        if(s.w-s.x>=pw) {
+          auto a = emplace(s,pw,ph);
+          if(s.w-s.x<pw) {
+            // most likely full: keep it out of lookup, until it's empty again
+            s.indexed = false;
+            shelves.erase(it);
+            }
+          return a;
+          }
+        }
+
+      for(size_t i=0;i<pages.size();++i){
+        if(pages[i].packing!=P_Shelf)
+          continue;
+        auto a=allocShelf(pages[i],i,pw,ph);
+        if(a.owner)
+          return a;
+        }
+
+      // no space for new shelf - pick up full shelves, that are empty by now
+      bool recycled = false;
+      for(auto& p:pages)
+        for(auto& sh:p.shelf)
+          if(!sh->indexed && sh->live.load(std::memory_order_acquire)==0) {
+            sh->reset();
+            sh->indexed = true;
+            shelves.emplace(sh->h,sh.get());
+            recycled = true;
+            }
+      if(recycled)
+        return allocShelf(pw,ph);
+      return Allocation();
+      }
+
+    Allocation allocShelf(Page& p,size_t page,uint32_t pw,uint32_t ph) {
+      if(pw>p.w || p.h-p.top<ph)
+        return Allocation();
+      const uint32_t sh = std::min(((ph+ShelfAlign-1)/ShelfAlign)*ShelfAlign, p.h-p.top);
+      p.shelf.emplace_back(new Shelf(p.top,p.w,sh,page));
+      p.top += sh;
+
+      Shelf* s = p.shelf.back().get();
+      auto   a = emplace(*s,pw,ph);
+      if(s->w-s->x>=pw) {
+        s->indexed = true;
+        shelves.emplace(sh,s);
+        }
+      return a;
+      }
+
+    Allocation emplace(Shelf& s,uint32_t pw,uint32_t ph) {
+      std::unique_ptr<Node> nx(new Node(s.x,s.y,pw,ph,nullptr));
+      nx->shelf = &s;
+      nx->page  = s.page;
+      s.nodes.push_back(nx.get());
+      s.x += pw;
+      s.live.fetch_add(1,std::memory_order_acq_rel);
+      return emplace(nx.release());
+      }
+
+    // puts live node 'ln' in place of freshly allocated 'nx'
+    void transplant(Node* nx,Node* ln) {
+      ln->x     = nx->x;
+      ln->y     = nx->y;
+      ln->page  = nx->page;
+      ln->owner = nx->owner;
+      ln->shelf = nx->shelf;
+      if(nx->owner!=nullptr) {
+        nx->owner->replace(nx,ln);
+        }
+      else if(nx==pages[nx->page].root.get()) {
+        pages[nx->page].root.release();
+        pages[nx->page].root.reset(ln);
+        }
+      if(nx->shelf!=nullptr)
+        std::replace(nx->shelf->nodes.begin(),nx->shelf->nodes.end(),nx,ln);
+      nx->owner = nullptr;
+      nx->shelf = nullptr;
+      delete nx;
+      }
+
     Allocation alloc(Node& n,size_t page,uint32_t pw,uint32_t ph){
       if(n.refcount.load(std::memory_order_acquire)>0)
         return Allocation();
@@ -241,7 +557,7 @@ class RectAllocator {
         n.sub[1] = sub1.release();
         n.sub[2] = sub2.release();
 
-        return emplace(n.sub[0],page);
+        return emplace(n.sub[0]);
         }
 
       if(pw==n.w && ph<n.h) {
@@ -251,7 +567,7 @@ class RectAllocator {
         n.sub[0] = sub0.release();
         n.sub[1] = sub1.release();
 
-        return emplace(n.sub[0],page);
+        return emplace(n.sub[0]);
         }
 
       if(pw<n.w && ph==n.h){
@@ -261,20 +577,19 @@ class RectAllocator {
         n.sub[0] = sub0.release();
         n.sub[1] = sub1.release();
 
-        return emplace(n.sub[0],page);
+        return emplace(n.sub[0]);
         }
 
       if(pw==n.w && ph==n.h)
-        return emplace(&n,page);
+        return emplace(&n);
 
       return Allocation();
       }
 
-    Allocation emplace(Node* nx,size_t page) {
+    Allocation emplace(Node* nx) {
       Allocation a;
       a.owner = this;
       a.node  = nx;
-      a.pId   = page;
 
       nx->addref();
       return a;
@@ -303,12 +618,13 @@ class RectAllocator {
         }
 
       bool free(T* t) noexcept {
-        if(t<val)
-          return false;
-        ptrdiff_t i=t-val;
-        if(i>=32)
+        // compare addresses: pointer arithmetic across different blocks is undefined
+        const uintptr_t p = reinterpret_cast<uintptr_t>(t);
+        const uintptr_t b = reinterpret_cast<uintptr_t>(val);
+        if(p<b || p>=b+sizeof(val))
           return false;
-        uint32_t id=(1<<i);
+        size_t   i=(p-b)/sizeof(T);
+        uint32_t id=(1u<<i);
         mask.fetch_and(~id,std::memory_order_release);
         return true;
         }
@@ -27,6 +27,20 @@ void ShaderReflection::getBindings(std::vector<Binding>&  lay,
     b.layout = binding;
     lay.push_back(b);
     }
+  for(auto &resource : resources.storage_buffers) {
+    unsigned binding = comp.get_decoration(resource.id, spv::DecorationBinding);
+    Binding b;
+    b.cls    = UniformsLayout::Ssbo;
+    b.layout = binding;
+    lay.push_back(b);
+    }
+  for(auto &resource : resources.storage_images) {
+    unsigned binding = comp.get_decoration(resource.id, spv::DecorationBinding);
+    Binding b;
+    b.cls    = UniformsLayout::Image;
+    b.layout = binding;
+    lay.push_back(b);
+    }
   for(auto &resource : resources.push_constant_buffers) {
     auto& t = comp.get_type_from_variable(resource.id);
     auto sz = comp.get_declared_struct_size(t);
@@ -77,3 +91,21 @@ void ShaderReflection::merge(std::vector<ShaderReflection::Binding>& ret,
     return a.layout<b.layout;
     });
   }
+
+void ShaderReflection::merge(std::vector<ShaderReflection::Binding>& ret,
+                             PushBlock& pb,
+                             const std::vector<ShaderReflection::Binding>& comp) {
+  ret.reserve(comp.size());
+  for(auto& u:comp) {
+    if(u.cls==UniformsLayout::Push) {
+      pb.stage = UniformsLayout::Compute;
+      pb.size  = u.size;
+      continue;
+      }
+    ret.push_back(u);
+    ret.back().stage = UniformsLayout::Compute;
+    }
+  std::sort(ret.begin(),ret.end(),[](const Binding& a, const Binding& b){
+    return a.layout<b.layout;
+    });
+  }
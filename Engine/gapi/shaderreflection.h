@@ -20,6 +20,9 @@ class ShaderReflection final {
                       PushBlock& pb,
                       const std::vector<Binding>& vs,
                       const std::vector<Binding>& fs);
+    static void merge(std::vector<Binding>& ret,
+                      PushBlock& pb,
+                      const std::vector<Binding>& comp);
   };
 
 }
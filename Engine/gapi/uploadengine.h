@@ -3,10 +3,12 @@
 #include <Tempest/AbstractGraphicsApi>
 #include <Tempest/Log>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdint>
 #include <mutex>
 #include <atomic>
+#include <thread>
 #include <vector>
 
 #include "utility/spinlock.h"
@@ -21,11 +23,13 @@ class UploadEngine final {
     class DataStream;
 
   public:
-    UploadEngine(Device& dev);
+    UploadEngine(Device& dev, size_t streams=DefaultStreams);
     ~UploadEngine();
 
-    DataStream& get();
     void        wait();
+    void        flush();
+    bool        isComplete(uint64_t ticket);
+    void        wait(uint64_t ticket);
 
     using ResPtr = Detail::DSharedPtr<AbstractGraphicsApi::Shared*>;
     using BufPtr = Detail::DSharedPtr<Buffer*>;
@@ -34,7 +38,10 @@ class UploadEngine final {
     class Data final {
       public:
         Data(Device& dev)
-          :sync(dev.data->allocSync), stream(dev.data->get()) {
+          :Data(*dev.data) {
+          }
+        Data(UploadEngine& e)
+          :sync(e.allocSync), engine(e) {
           }
         ~Data() noexcept(false) {
           try {
@@ -47,170 +54,342 @@ class UploadEngine final {
             }
           }
 
+        // sub-allocates size bytes from persistently mapped staging ring; nullptr, if ring has no room
+        uint8_t* stage(size_t size, size_t align, const Buffer*& buf, size_t& offset) {
+          begin(size);
+          if(engine.ring==nullptr)
+            return nullptr;
+          const size_t at = stream->alloc(size,align);
+          if(at==size_t(-1))
+            return nullptr;
+          buf    = engine.ring.get();
+          offset = at;
+          return engine.mapped+at;
+          }
+
         void flush(const Buffer& src, size_t size) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.flush(src,size);
+          begin();
+          stream->cmdBuffer.flush(src,size);
           }
         void copy(Buffer&  dest, const Buffer& src, size_t size) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.copy(dest,0,src,0,size);
+          begin();
+          stream->cmdBuffer.copy(dest,0,src,0,size);
+          }
+        void copy(Buffer&  dest, size_t offsetDest, const Buffer& src, size_t offsetSrc, size_t size) {
+          begin();
+          stream->cmdBuffer.copy(dest,offsetDest,src,offsetSrc,size);
           }
         void copy(Texture& dest, uint32_t w, uint32_t h, uint32_t mip, const Buffer&  src, size_t offset) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.copy(dest,w,h,mip,src,offset);
+          begin();
+          stream->cmdBuffer.copy(dest,w,h,mip,src,offset);
+          }
+        void copy(Texture& dest, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t mip, const Buffer& src, size_t offset) {
+          begin();
+          stream->cmdBuffer.copy(dest,x,y,w,h,mip,src,offset);
           }
         void copy(Buffer&  dest, uint32_t w, uint32_t h, uint32_t mip, const Texture& src, size_t offset) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.copy(dest,w,h,mip,src,offset);
+          begin();
+          stream->cmdBuffer.copy(dest,w,h,mip,src,offset);
+          }
+        void copy(Buffer&  dest, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t mip, const Texture& src, size_t offset) {
+          begin();
+          stream->cmdBuffer.copy(dest,x,y,w,h,mip,src,offset);
           }
         void changeLayout(Texture& dest, TextureFormat frm, TextureLayout oldLayout, TextureLayout newLayout) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.changeLayout(dest,frm,oldLayout,newLayout);
+          begin();
+          stream->cmdBuffer.changeLayout(dest,frm,oldLayout,newLayout);
           }
         void changeLayout(Texture& dest, TextureFormat frm, TextureLayout oldLayout, TextureLayout newLayout, uint32_t mipCnt) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.changeLayout(dest,frm,oldLayout,newLayout,mipCnt);
+          begin();
+          stream->cmdBuffer.changeLayout(dest,frm,oldLayout,newLayout,mipCnt);
           }
         void generateMipmap(Texture& image, TextureFormat frm, uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.cmdBuffer.generateMipmap(image,frm,texWidth,texHeight,mipLevels);
+          begin();
+          stream->cmdBuffer.generateMipmap(image,frm,texWidth,texHeight,mipLevels);
+          }
+
+        // queue family ownership transfer to graphics queue; only for dedicated transfer queues
+        void release(Buffer& dest, size_t size) {
+          begin();
+          stream->cmdBuffer.release(dest,size);
+          }
+        void release(Texture& dest, TextureFormat frm, TextureLayout oldLayout, TextureLayout newLayout, uint32_t mipCnt) {
+          begin();
+          stream->cmdBuffer.release(dest,frm,oldLayout,newLayout,mipCnt);
           }
 
         void hold(BufPtr &b) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.hold.emplace_back(ResPtr(b.handler));
+          begin();
+          stream->hold.emplace_back(ResPtr(b.handler));
           }
 
         void hold(TexPtr &b) {
-          if(commited){
-            stream.begin();
-            commited=false;
-            }
-          stream.hold.emplace_back(ResPtr(b.handler));
+          begin();
+          stream->hold.emplace_back(ResPtr(b.handler));
           }
 
-        void commit() {
-          if(commited)
-            return;
-          commited=true;
-          stream.end();
+        // commands are submitted in batches: on UploadEngine::flush/wait, or once stream is full
+        // returns ticket, that can be tested by UploadEngine::isComplete
+        uint64_t commit() {
+          if(stream==nullptr)
+            return 0;
+          const uint64_t ticket = stream->ticket;
+          engine.commit(*stream);
+          stream=nullptr;
+          return ticket;
           }
 
       private:
+        void begin(size_t stageSize=0) {
+          if(stream==nullptr)
+            stream = &engine.get(stageSize);
+          stream->begin();
+          }
+
         std::lock_guard<std::mutex> sync;
-        DataStream&                 stream;
-        bool                        commited=true;
+        UploadEngine&               engine;
+        DataStream*                 stream=nullptr;
       };
 
   private:
     enum  DataState : uint8_t {
       StIdle      = 0,
       StRecording = 1,
-      StWait      = 2,
+      StPending   = 2,
+      StWait      = 3,
       };
 
+    static constexpr size_t DefaultStreams = 3;
+    // commits per submit
+    static constexpr size_t MaxBatch  = 256;
+    // staging bytes per stream
+    static constexpr size_t StageSize = 4*1024*1024;
+
     class DataStream {
       public:
-        DataStream(Device &owner):owner(owner), cmdBuffer(owner), fence(owner) {
+        DataStream(Device &owner,size_t id):owner(owner), cmdBuffer(owner), fence(owner), id(id), base(id*StageSize) {
           hold.reserve(32);
           }
         ~DataStream() { wait(); }
 
         void begin() {
+          if(begun)
+            return;
           cmdBuffer.begin();
+          begun = true;
           }
 
-        void end() {
+        void submit() {
+          cmdBuffer.uploadBarrier();
           cmdBuffer.end();
           owner.submit(cmdBuffer,fence);
+          begun = false;
           state.store(StWait);
           }
 
+        bool hasRoom(size_t size) const {
+          return staged+size<=StageSize;
+          }
+
+        size_t alloc(size_t size, size_t align) {
+          const size_t at = ((staged+align-1)/align)*align;
+          if(at+size>StageSize)
+            return size_t(-1);
+          staged = at+size;
+          return base+at;
+          }
+
         void wait() {
           while(true) {
             auto s = state.load();
             if(s==StIdle)
               return;
+            if(s==StPending) {
+              submit();
+              continue;
+              }
             if(s==StWait)  {
               fence.wait();
-              cmdBuffer.reset();
-              hold.clear();
-              state.store(StIdle);
+              recycle();
               return;
               }
             }
           }
 
+        // non-blocking version of wait; false, if stream is still in use
+        bool tryWait() {
+          auto s = state.load();
+          if(s==StPending) {
+            submit();
+            s = StWait;
+            }
+          if(s==StWait && fence.wait(0))
+            recycle();
+          return state.load()==StIdle;
+          }
+
+        void recycle() {
+          cmdBuffer.reset();
+          hold.clear();
+          staged = 0;
+          batch  = 0;
+          state.store(StIdle);
+          }
+
         Device&                owner;
         CommandBuffer          cmdBuffer;
         std::vector<ResPtr>    hold;
 
         Fence                  fence;
+        SpinLock               sync;
         std::atomic<DataState> state{StIdle};
+        bool                   begun=false;
+        uint64_t               ticket=0;
+
+        // region of staging ring, recycled once fence is signaled
+        const size_t           id;
+        const size_t           base;
+        size_t                 staged=0;
+        size_t                 batch =0;
       };
 
+    DataStream& get(size_t stageSize);
+    DataStream& open(DataStream& st);
+    void        commit(DataStream& s);
+
+    Device&                     owner;
     std::mutex                  allocSync;
 
-    static constexpr size_t     size=2;
-    SpinLock                    sync[size];
-    std::unique_ptr<DataStream> streams[size];
-    std::atomic_int             at{0};
+    std::unique_ptr<Buffer>     ring;
+    uint8_t*                    mapped=nullptr;
+
+    std::vector<std::unique_ptr<DataStream>> streams;
+    std::atomic_size_t          at{0};
+    DataStream*                 current=nullptr;
+    uint64_t                    ticket =0;
   };
 
 template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
-UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::UploadEngine(Device& dev) {
-  for(auto& i:streams)
-    i.reset(new DataStream(dev));
+UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::UploadEngine(Device& dev, size_t size)
+  :owner(dev) {
+  size = std::max<size_t>(size,1);
+  ring.reset(new Buffer(dev.allocator.allocStaging(StageSize*size)));
+  mapped = reinterpret_cast<uint8_t*>(dev.allocator.map(*ring));
+  if(mapped==nullptr)
+    ring.reset();
+  streams.resize(size);
+  for(size_t i=0;i<size;++i)
+    streams[i].reset(new DataStream(dev,i));
   }
 
 template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
 UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::~UploadEngine() {
   wait();
+  if(ring!=nullptr)
+    owner.allocator.unmap(*ring);
   }
 
 template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
-auto UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::get() -> DataStream& {
-  auto id = at.fetch_add(1)%2;
+auto UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::get(size_t stageSize) -> DataStream& {
+  if(stageSize>StageSize)
+    stageSize = 0; // doesn't fit anyway
+
+  if(current!=nullptr) {
+    // keep recording into the same stream, while there is room
+    std::lock_guard<SpinLock> guard(current->sync);
+    auto s = current->state.load();
+    if((s==StPending || s==StIdle) && current->batch<MaxBatch && current->hasRoom(stageSize)) {
+      current->state.store(StRecording);
+      return *current;
+      }
+    if(s==StPending)
+      current->submit();
+    current = nullptr;
+    }
+
+  // take any stream, that gpu is done with; block only if all of them are in flight
+  const size_t size = streams.size();
+  const size_t id   = at.fetch_add(1)%size;
+  for(size_t i=0;i<size;++i) {
+    auto& st = *streams[(id+i)%size];
+    std::lock_guard<SpinLock> guard(st.sync);
+    if(st.tryWait())
+      return open(st);
+    }
 
-  std::lock_guard<SpinLock> guard(sync[id]);
   auto& st = *streams[id];
+  std::lock_guard<SpinLock> guard(st.sync);
   st.wait();
+  return open(st);
+  }
+
+template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
+auto UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::open(DataStream& st) -> DataStream& {
+  st.ticket = ++ticket;
   st.state.store(StRecording);
+  current = &st;
   return st;
   }
 
+template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
+void UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::commit(DataStream& s) {
+  s.batch++;
+  s.state.store(s.begun ? StPending : StIdle);
+  }
+
 template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
 void UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::wait() {
-  for(size_t i=0;i<size;++i) {
-    std::lock_guard<SpinLock> guard(sync[i]);
-    streams[i]->wait();
+  for(auto& i:streams) {
+    std::lock_guard<SpinLock> guard(i->sync);
+    i->wait();
     }
   }
 
-}}
+template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
+void UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::flush() {
+  for(auto& i:streams) {
+    std::lock_guard<SpinLock> guard(i->sync);
+    if(i->state.load()==StPending)
+      i->submit();
+    }
+  }
+
+template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
+bool UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::isComplete(uint64_t t) {
+  if(t==0)
+    return true;
+  for(auto& i:streams) {
+    std::lock_guard<SpinLock> guard(i->sync);
+    if(i->ticket!=t)
+      continue;
+    if(i->state.load()==StRecording)
+      return false;
+    return i->tryWait();
+    }
+  // stream was recycled already
+  return true;
+  }
 
+template<class Device, class CommandBuffer, class Fence, class Buffer, class Texture>
+void UploadEngine<Device,CommandBuffer,Fence,Buffer,Texture>::wait(uint64_t t) {
+  if(t==0)
+    return;
+  while(true) {
+    bool recording = false;
+    for(auto& i:streams) {
+      std::lock_guard<SpinLock> guard(i->sync);
+      if(i->ticket!=t)
+        continue;
+      if(i->state.load()!=StRecording) {
+        i->wait();
+        return;
+        }
+      recording = true;
+      }
+    if(!recording)
+      return;
+    std::this_thread::yield();
+    }
+  }
 
+}}
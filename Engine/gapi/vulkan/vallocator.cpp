@@ -9,6 +9,7 @@
 #include <Tempest/Pixmap>
 #include <Tempest/Log>
 #include <thread>
+#include <algorithm>
 
 #include "gapi/graphicsmemutils.h"
 
@@ -83,10 +84,39 @@ static size_t LCM(size_t n1, size_t n2)  {
   return n1*n2 / GCD(n1, n2);
   }
 
+static VkBufferUsageFlags nativeUsage(MemUsage usage) {
+  VkBufferUsageFlags ret = 0;
+  if(MemUsage::TransferSrc==(usage & MemUsage::TransferSrc))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  if(MemUsage::TransferDst==(usage & MemUsage::TransferDst))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  if(MemUsage::UniformBuffer==(usage & MemUsage::UniformBuffer))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  if(MemUsage::VertexBuffer==(usage & MemUsage::VertexBuffer))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+  if(MemUsage::IndexBuffer==(usage & MemUsage::IndexBuffer))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  if(MemUsage::StorageBuffer==(usage & MemUsage::StorageBuffer))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  if(MemUsage::Indirect==(usage & MemUsage::Indirect))
+    ret |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  return ret;
+  }
+
+static const char* bufferSite(BufferHeap h) {
+  switch(h) {
+    case BufferHeap::Static:   return "buffer/static";
+    case BufferHeap::Upload:   return "buffer/upload";
+    case BufferHeap::Readback: return "buffer/readback";
+    }
+  return "buffer";
+  }
+
 VBuffer VAllocator::alloc(const void *mem, size_t count, size_t size, size_t alignedSz,
                           MemUsage usage, BufferHeap bufHeap) {
   VBuffer ret;
   ret.alloc = this;
+  ret.size  = count*alignedSz;
 
   VkBufferCreateInfo createInfo={};
   createInfo.sType                 = VkStructureType::VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -97,16 +127,7 @@ VBuffer VAllocator::alloc(const void *mem, size_t count, size_t size, size_t ali
   createInfo.queueFamilyIndexCount = 0;
   createInfo.pQueueFamilyIndices   = nullptr;
 
-  if(MemUsage::TransferSrc==(usage & MemUsage::TransferSrc))
-    createInfo.usage |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  if(MemUsage::TransferDst==(usage & MemUsage::TransferDst))
-    createInfo.usage |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-  if(MemUsage::UniformBuffer==(usage & MemUsage::UniformBuffer))
-    createInfo.usage |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-  if(MemUsage::VertexBuffer==(usage & MemUsage::VertexBuffer))
-    createInfo.usage |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-  if(MemUsage::IndexBuffer==(usage & MemUsage::IndexBuffer))
-    createInfo.usage |= VkBufferUsageFlagBits::VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  createInfo.usage                 = nativeUsage(usage);
 
   vkAssert(vkCreateBuffer(device,&createInfo,nullptr,&ret.impl));
 
@@ -132,6 +153,7 @@ VBuffer VAllocator::alloc(const void *mem, size_t count, size_t size, size_t ali
              mem,count,size,alignedSz)) {
     throw std::system_error(Tempest::GraphicsErrc::OutOfHostMemory);
     }
+  track(ret.page,bufferSite(bufHeap),usage);
   return ret;
   }
 
@@ -179,12 +201,17 @@ VTexture VAllocator::alloc(const Pixmap& pm,uint32_t mip,VkFormat format) {
   ret.format   = imageInfo.format;
   ret.mipCount = mip;
   ret.createViews(device);
+  track(ret.page,"texture",MemUsage(0));
   return ret;
   }
 
-VTexture VAllocator::alloc(const uint32_t w, const uint32_t h, const uint32_t mip, TextureFormat frm) {
+VTexture VAllocator::alloc(const uint32_t w, const uint32_t h, const uint32_t mip, TextureFormat frm, bool storage) {
+  if(storage && (isDepthFormat(frm) || !provider.device->props.hasStorageFormat(frm)))
+    throw std::system_error(Tempest::GraphicsErrc::UnsupportedTextureFormat);
+
   VTexture ret;
-  ret.alloc = this;
+  ret.alloc   = this;
+  ret.storage = storage;
 
   VkImageCreateInfo imageInfo = {};
   imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -199,6 +226,8 @@ VTexture VAllocator::alloc(const uint32_t w, const uint32_t h, const uint32_t mi
   imageInfo.usage         = isDepthFormat(frm) ?
         (VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) :
         (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT|VK_IMAGE_USAGE_SAMPLED_BIT|VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+  if(storage)
+    imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
   imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
   imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
   imageInfo.format        = nativeFormat(frm);
@@ -223,15 +252,50 @@ VTexture VAllocator::alloc(const uint32_t w, const uint32_t h, const uint32_t mi
   ret.format   = imageInfo.format;
   ret.mipCount = mip;
   ret.createViews(device);
+  track(ret.page,isDepthFormat(frm) ? "zbuffer" : "attachment",MemUsage(0));
+  return ret;
+  }
+
+VBuffer VAllocator::allocStaging(size_t size, MemUsage usage) {
+  VBuffer ret;
+  ret.alloc = this;
+  ret.size  = size;
+
+  VkBufferCreateInfo createInfo={};
+  createInfo.sType       = VkStructureType::VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  createInfo.size        = size;
+  createInfo.usage       = nativeUsage(usage);
+  createInfo.sharingMode = VkSharingMode::VK_SHARING_MODE_EXCLUSIVE;
+
+  vkAssert(vkCreateBuffer(device,&createInfo,nullptr,&ret.impl));
+
+  MemRequirements memRq={};
+  getMemoryRequirements(memRq,ret.impl);
+
+  // own memory object: it stays mapped for whole lifetime of the buffer
+  const auto        props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VDevice::MemIndex memId = provider.device->memoryTypeIndex(memRq.memoryTypeBits,VkMemoryPropertyFlagBits(props),VK_IMAGE_TILING_LINEAR);
+  const size_t      align = LCM(memRq.alignment,provider.device->props.nonCoherentAtomSize);
+  ret.page = allocator.dedicatedAlloc(memRq.size,align,memId.heapId,memId.typeId);
+
+  if(!ret.page.page)
+    throw std::system_error(Tempest::GraphicsErrc::OutOfHostMemory);
+  if(!commit(ret.page.page->memory,ret.page.page->mmapSync,ret.impl,ret.page.offset,nullptr,0,0,0))
+    throw std::system_error(Tempest::GraphicsErrc::OutOfHostMemory);
+  track(ret.page,usage==MemUsage::TransferSrc ? "staging" : "buffer/mapped",usage);
   return ret;
   }
 
 void VAllocator::free(VBuffer &buf) {
+  if(buf.mapped)
+    unmap(buf);
   if(buf.impl!=VK_NULL_HANDLE)
     vkDestroyBuffer (device,buf.impl,nullptr);
 
-  if(buf.page.page!=nullptr)
+  if(buf.page.page!=nullptr) {
+    untrack(buf.page);
     allocator.free(buf.page);
+    }
   }
 
 void VAllocator::free(VTexture &buf) {
@@ -242,8 +306,10 @@ void VAllocator::free(VTexture &buf) {
   else if(buf.impl!=VK_NULL_HANDLE) {
     vkDestroyImage  (device,buf.impl,nullptr);
     }
-  if(buf.page.page!=nullptr)
+  if(buf.page.page!=nullptr) {
+    untrack(buf.page);
     allocator.free(buf.page);
+    }
   }
 
 void VAllocator::getMemoryRequirements(MemRequirements& out,VkBuffer buf) {
@@ -368,6 +434,24 @@ bool VAllocator::read(VBuffer &src, void *mem, size_t offset, size_t size) {
   return true;
   }
 
+void* VAllocator::map(VBuffer& buf) {
+  auto& page = buf.page;
+  void* data = nullptr;
+
+  std::lock_guard<std::mutex> g(page.page->mmapSync);
+  if(vkMapMemory(device,page.page->memory,page.offset,page.size,0,&data)!=VkResult::VK_SUCCESS)
+    return nullptr;
+  buf.mapped = true;
+  return data;
+  }
+
+void VAllocator::unmap(VBuffer& buf) {
+  auto& page = buf.page;
+  std::lock_guard<std::mutex> g(page.page->mmapSync);
+  vkUnmapMemory(device,page.page->memory);
+  buf.mapped = false;
+  }
+
 void VAllocator::updateSampler(VkSampler &smp, const Tempest::Sampler2d &s, uint32_t mipCount) {
   auto ns = samplers.get(s,mipCount);
   samplers.free(smp);
@@ -402,3 +486,68 @@ bool VAllocator::commit(VkDeviceMemory dev, std::mutex& mmapSync, VkImage dest,
   std::lock_guard<std::mutex> g(mmapSync); // on practice bind requires external sync
   return vkBindImageMemory(device, dest, dev, offset)==VkResult::VK_SUCCESS;
   }
+
+void VAllocator::track(const Allocation& a, const char* site, MemUsage usage) {
+  AbstractGraphicsApi::MemoryStats::Allocation r;
+  r.site  = site;
+  r.heap  = a.page->type;
+  r.usage = usage;
+  r.size  = a.size;
+
+  std::lock_guard<std::mutex> g(liveSync);
+  r.id = ++liveId;
+  live[LiveKey(a.page,a.offset)] = r;
+  }
+
+void VAllocator::untrack(const Allocation& a) {
+  std::lock_guard<std::mutex> g(liveSync);
+  live.erase(LiveKey(a.page,a.offset));
+  }
+
+AbstractGraphicsApi::MemoryStats VAllocator::stats() {
+  AbstractGraphicsApi::MemoryStats ret;
+  for(auto& i:allocator.heapStats()) {
+    AbstractGraphicsApi::MemoryStats::Heap h;
+    h.id            = i.first;
+    h.pages         = i.second.pages;
+    h.dedicated     = i.second.dedicated;
+    h.reserved      = i.second.reserved;
+    h.allocated     = i.second.allocated;
+    h.allocations   = i.second.allocations;
+    h.freeBlocks    = i.second.freeBlocks;
+    h.freeBytes     = i.second.freeBytes;
+    h.largestFree   = i.second.largestFree;
+    h.fragmentation = i.second.fragmentation();
+    ret.heaps.push_back(h);
+    }
+
+  {
+  std::lock_guard<std::mutex> g(liveSync);
+  ret.allocations.reserve(live.size());
+  for(auto& i:live)
+    ret.allocations.push_back(i.second);
+  }
+  std::sort(ret.allocations.begin(),ret.allocations.end(),
+            [](const AbstractGraphicsApi::MemoryStats::Allocation& l,const AbstractGraphicsApi::MemoryStats::Allocation& r){
+    return l.id<r.id;
+    });
+
+  for(auto& a:ret.allocations) {
+    AbstractGraphicsApi::MemoryStats::Usage* u = nullptr;
+    if(a.usage!=MemUsage(0)) {
+      for(auto& b:ret.buffers)
+        if(b.usage==a.usage)
+          u = &b;
+      if(u==nullptr) {
+        ret.buffers.emplace_back();
+        u = &ret.buffers.back();
+        u->usage = a.usage;
+        }
+      } else {
+      u = &ret.textures;
+      }
+    u->allocations += 1;
+    u->bytes       += a.size;
+    }
+  return ret;
+  }
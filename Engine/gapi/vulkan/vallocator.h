@@ -5,6 +5,9 @@
 #include "gapi/deviceallocator.h"
 #include "vsamplercache.h"
 
+#include <map>
+#include <mutex>
+
 namespace Tempest {
 namespace Detail {
 
@@ -46,7 +49,9 @@ class VAllocator {
 
     VBuffer  alloc(const void *mem, size_t count, size_t size, size_t alignedSz, MemUsage usage, BufferHeap bufHeap);
     VTexture alloc(const Pixmap &pm, uint32_t mip, VkFormat format);
-    VTexture alloc(const uint32_t w, const uint32_t h, const uint32_t mip, TextureFormat frm);
+    VTexture alloc(const uint32_t w, const uint32_t h, const uint32_t mip, TextureFormat frm, bool storage);
+    // dedicated host-coherent memory, suitable for persistent mapping
+    VBuffer  allocStaging(size_t size, MemUsage usage = MemUsage::TransferSrc);
     void     free(VBuffer&  buf);
     void     free(VTexture& buf);
 
@@ -55,14 +60,28 @@ class VAllocator {
     bool     update(VBuffer& dest, const void *mem, size_t offset, size_t count, size_t size, size_t alignedSz);
     bool     read  (VBuffer& src,        void *mem, size_t offset, size_t size);
 
+    // persistent mapping of staging buffer; free() unmaps it, if needed
+    void*    map  (VBuffer& buf);
+    void     unmap(VBuffer& buf);
+
     void     updateSampler(VkSampler& smp, const Sampler2d& s, uint32_t mipCount);
 
+    AbstractGraphicsApi::MemoryStats stats();
+
   private:
     VkDevice                          device=nullptr;
     Provider                          provider;
     VSamplerCache                     samplers;
     Detail::DeviceAllocator<Provider> allocator{provider};
 
+    using LiveKey = std::pair<const void*,size_t>;
+    std::mutex                        liveSync;
+    uint64_t                          liveId=0;
+    std::map<LiveKey,AbstractGraphicsApi::MemoryStats::Allocation> live;
+
+    void track  (const Allocation& a, const char* site, MemUsage usage);
+    void untrack(const Allocation& a);
+
     void getMemoryRequirements   (MemRequirements& out, VkBuffer buf);
     void getImgMemoryRequirements(MemRequirements& out, VkImage  img);
     Allocation allocMemory(const MemRequirements& rq, const uint32_t heapId, const uint32_t typeId);
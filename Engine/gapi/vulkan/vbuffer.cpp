@@ -9,8 +9,10 @@ using namespace Tempest::Detail;
 
 VBuffer::VBuffer(VBuffer &&other) {
   std::swap(impl, other.impl);
+  std::swap(size, other.size);
   std::swap(alloc,other.alloc);
   std::swap(page, other.page);
+  std::swap(mapped,other.mapped);
   }
 
 VBuffer::~VBuffer() {
@@ -20,8 +22,10 @@ VBuffer::~VBuffer() {
 
 VBuffer& VBuffer::operator=(VBuffer&& other) {
   std::swap(impl, other.impl);
+  std::swap(size, other.size);
   std::swap(alloc,other.alloc);
   std::swap(page, other.page);
+  std::swap(mapped,other.mapped);
   return *this;
   }
 
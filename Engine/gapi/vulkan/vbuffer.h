@@ -20,10 +20,12 @@ class VBuffer : public AbstractGraphicsApi::Buffer {
     void read  (void* data,size_t off,size_t sz);
 
     VkBuffer               impl=VK_NULL_HANDLE;
+    size_t                 size=0; // bytes
 
   private:
     VAllocator*            alloc=nullptr;
     VAllocator::Allocation page={};
+    bool                   mapped=false;
 
   friend class VAllocator;
   };
@@ -11,6 +11,8 @@
 #include "vswapchain.h"
 #include "vtexture.h"
 
+#include <algorithm>
+
 using namespace Tempest;
 using namespace Tempest::Detail;
 
@@ -23,20 +25,36 @@ struct VCommandBuffer::ImgState {
   };
 
 VCommandBuffer::VCommandBuffer(VDevice& device, VkCommandPoolCreateFlags flags)
-  :device(device), pool(device,flags) {
+  :VCommandBuffer(device,device.props.graphicsFamily,flags) {
+  }
+
+VCommandBuffer::VCommandBuffer(VDevice& device, uint32_t family, VkCommandPoolCreateFlags flags)
+  :device(device), pool(device,family,flags) {
+  alloc(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+  }
+
+VCommandBuffer::VCommandBuffer(VDevice& device, VFramebufferLayout& lay, uint32_t width, uint32_t height)
+  :device(device), pool(device,device.props.graphicsFamily,VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT) {
+  bundle.lay    = Detail::DSharedPtr<VFramebufferLayout*>(&lay);
+  bundle.width  = width;
+  bundle.height = height;
+  alloc(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  }
+
+VCommandBuffer::~VCommandBuffer() {
+  vkFreeCommandBuffers(device.device,pool.impl,1,&impl);
+  }
+
+void VCommandBuffer::alloc(VkCommandBufferLevel level) {
   VkCommandBufferAllocateInfo allocInfo = {};
   allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.commandPool        = pool.impl;
-  allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.level              = level;
   allocInfo.commandBufferCount = 1;
 
   vkAssert(vkAllocateCommandBuffers(device.device,&allocInfo,&impl));
   }
 
-VCommandBuffer::~VCommandBuffer() {
-  vkFreeCommandBuffers(device.device,pool.impl,1,&impl);
-  }
-
 void VCommandBuffer::reset() {
   vkResetCommandBuffer(impl,VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
   }
@@ -46,18 +64,39 @@ void VCommandBuffer::begin() {
   }
 
 void VCommandBuffer::begin(VkCommandBufferUsageFlags flg) {
-  state = NoPass;
+  state       = NoPass;
+  curCompDesc = nullptr;
 
   VkCommandBufferBeginInfo beginInfo = {};
   beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   beginInfo.flags            = flg;
   beginInfo.pInheritanceInfo = nullptr;
 
+  if(bundle.lay.handler==nullptr) {
+    vkAssert(vkBeginCommandBuffer(impl,&beginInfo));
+    return;
+    }
+
+  // any render pass compatible with layout can execute this bundle
+  VkCommandBufferInheritanceInfo inheritance = {};
+  inheritance.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.renderPass  = bundle.lay.handler->impl;
+  inheritance.subpass     = 0;
+  inheritance.framebuffer = VK_NULL_HANDLE;
+
+  beginInfo.flags            |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo  = &inheritance;
   vkAssert(vkBeginCommandBuffer(impl,&beginInfo));
+
+  state  = RenderPass;
+  curFbo = bundle.lay;
+  // dynamic state is not inherited from primary buffer
+  setViewport(Rect(0,0,int32_t(bundle.width),int32_t(bundle.height)));
+  setScissor (Rect(0,0,int32_t(bundle.width),int32_t(bundle.height)));
   }
 
 void VCommandBuffer::end() {
-  if(state==RenderPass)
+  if(state==RenderPass && bundle.lay.handler==nullptr)
     endRenderPass();
   for(auto& i:imgState)
     i.outdated = true;
@@ -73,7 +112,7 @@ bool VCommandBuffer::isRecording() const {
 
 void VCommandBuffer::beginRenderPass(AbstractGraphicsApi::Fbo*   f,
                                      AbstractGraphicsApi::Pass*  p,
-                                     uint32_t width,uint32_t height) {
+                                     uint32_t width,uint32_t height,bool bundles) {
   VFramebuffer& fbo =*reinterpret_cast<VFramebuffer*>(f);
   VRenderPass&  pass=*reinterpret_cast<VRenderPass*>(p);
 
@@ -107,6 +146,12 @@ void VCommandBuffer::beginRenderPass(AbstractGraphicsApi::Fbo*   f,
   renderPassInfo.clearValueCount   = pass.attCount;
   renderPassInfo.pClearValues      = rp.clear.get();
 
+  if(bundles) {
+    vkCmdBeginRenderPass(impl, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    state = RenderPass;
+    return;
+    }
+
   vkCmdBeginRenderPass(impl, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
   state = RenderPass;
@@ -114,6 +159,7 @@ void VCommandBuffer::beginRenderPass(AbstractGraphicsApi::Fbo*   f,
   // setup dynamic state
   // https://www.khronos.org/registry/vulkan/specs/1.1-extensions/html/vkspec.html#pipelines-dynamic-state
   setViewport(Rect(0,0,int32_t(width),int32_t(height)));
+  setScissor (Rect(0,0,int32_t(width),int32_t(height)));
   }
 
 void VCommandBuffer::endRenderPass() {
@@ -121,10 +167,15 @@ void VCommandBuffer::endRenderPass() {
   state = NoPass;
   }
 
-void VCommandBuffer::setPipeline(AbstractGraphicsApi::Pipeline &p,uint32_t w,uint32_t h) {
+void VCommandBuffer::execute(const AbstractGraphicsApi::CommandBuffer& b) {
+  const VCommandBuffer& bx = reinterpret_cast<const VCommandBuffer&>(b);
+  vkCmdExecuteCommands(impl,1,&bx.impl);
+  }
+
+void VCommandBuffer::setPipeline(AbstractGraphicsApi::Pipeline &p) {
   VPipeline&           px = reinterpret_cast<VPipeline&>(p);
   VFramebufferLayout*  l  = reinterpret_cast<VFramebufferLayout*>(curFbo.handler);
-  auto& v = px.instance(*l,w,h);
+  auto& v = px.instance(*l);
   vkCmdBindPipeline(impl,VK_PIPELINE_BIND_POINT_GRAPHICS,v.val);
   }
 
@@ -134,20 +185,101 @@ void VCommandBuffer::setBytes(AbstractGraphicsApi::Pipeline& p, const void* data
   }
 
 void VCommandBuffer::setUniforms(AbstractGraphicsApi::Pipeline &p, AbstractGraphicsApi::Desc &u) {
+  setUniforms(p,u,nullptr,0);
+  }
+
+void VCommandBuffer::setUniforms(AbstractGraphicsApi::Pipeline &p, AbstractGraphicsApi::Desc &u,
+                                 const uint32_t* offsets, size_t count) {
   VPipeline&        px=reinterpret_cast<VPipeline&>(p);
   VDescriptorArray& ux=reinterpret_cast<VDescriptorArray&>(u);
+  uint32_t          dyn[VUniformsLay::MAX_DYNAMIC]={};
+  const uint32_t    dynCount = ux.dynamicOffsets(offsets,count,dyn);
   vkCmdBindDescriptorSets(impl,VK_PIPELINE_BIND_POINT_GRAPHICS,
                           px.pipelineLayout,0,
                           1,&ux.desc,
-                          0,nullptr);
+                          dynCount,dyn);
   }
 
-void VCommandBuffer::draw(size_t offset,size_t size) {
-  vkCmdDraw(impl,uint32_t(size), 1, uint32_t(offset),0);
+void VCommandBuffer::setComputePipeline(AbstractGraphicsApi::CompPipeline& p) {
+  VCompPipeline& px = reinterpret_cast<VCompPipeline&>(p);
+  vkCmdBindPipeline(impl,VK_PIPELINE_BIND_POINT_COMPUTE,px.impl);
   }
 
-void VCommandBuffer::drawIndexed(size_t ioffset, size_t isize, size_t voffset) {
-  vkCmdDrawIndexed(impl,uint32_t(isize),1, uint32_t(ioffset), int32_t(voffset),0);
+void VCommandBuffer::setBytes(AbstractGraphicsApi::CompPipeline& p, const void* data, size_t size) {
+  VCompPipeline& px = reinterpret_cast<VCompPipeline&>(p);
+  vkCmdPushConstants(impl, px.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, uint32_t(size), data);
+  }
+
+void VCommandBuffer::setUniforms(AbstractGraphicsApi::CompPipeline& p, AbstractGraphicsApi::Desc& u) {
+  VCompPipeline&    px = reinterpret_cast<VCompPipeline&>(p);
+  VDescriptorArray& ux = reinterpret_cast<VDescriptorArray&>(u);
+  uint32_t          dyn[VUniformsLay::MAX_DYNAMIC]={};
+  const uint32_t    dynCount = ux.dynamicOffsets(nullptr,0,dyn);
+  curCompDesc = &ux;
+  vkCmdBindDescriptorSets(impl,VK_PIPELINE_BIND_POINT_COMPUTE,
+                          px.pipelineLayout,0,
+                          1,&ux.desc,
+                          dynCount,dyn);
+  }
+
+void VCommandBuffer::dispatch(size_t x, size_t y, size_t z) {
+  // attachments of previous passes are expected in read-only layout
+  for(auto& i:imgState)
+    i.outdated = true;
+  flushLayout();
+
+  if(curCompDesc!=nullptr) {
+    for(auto& i:curCompDesc->storage)
+      changeLayout(i.img,i.frm,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,VK_IMAGE_LAYOUT_GENERAL,VK_REMAINING_MIP_LEVELS,false);
+    }
+
+  vkCmdDispatch(impl,uint32_t(x),uint32_t(y),uint32_t(z));
+
+  if(curCompDesc!=nullptr) {
+    for(auto& i:curCompDesc->storage)
+      changeLayout(i.img,i.frm,VK_IMAGE_LAYOUT_GENERAL,VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,VK_REMAINING_MIP_LEVELS,false);
+    }
+
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                          VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(impl,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       1, &barrier,
+                       0, nullptr,
+                       0, nullptr);
+  }
+
+void VCommandBuffer::draw(size_t offset,size_t size,size_t firstInstance,size_t instanceCount) {
+  vkCmdDraw(impl,uint32_t(size),uint32_t(instanceCount),uint32_t(offset),uint32_t(firstInstance));
+  }
+
+void VCommandBuffer::drawIndexed(size_t ioffset, size_t isize, size_t voffset, size_t firstInstance, size_t instanceCount) {
+  vkCmdDrawIndexed(impl,uint32_t(isize),uint32_t(instanceCount),uint32_t(ioffset),int32_t(voffset),uint32_t(firstInstance));
+  }
+
+void VCommandBuffer::drawIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t stride) {
+  const VBuffer& ind = reinterpret_cast<const VBuffer&>(indirect);
+  const size_t   max = std::max<size_t>(device.props.indirect.maxDrawCount,1);
+  for(size_t i=0; i<drawCount; i+=max) {
+    const size_t cnt = std::min(max,drawCount-i);
+    vkCmdDrawIndirect(impl,ind.impl,VkDeviceSize(offset+i*stride),uint32_t(cnt),uint32_t(stride));
+    }
+  }
+
+void VCommandBuffer::drawIndexedIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t stride) {
+  const VBuffer& ind = reinterpret_cast<const VBuffer&>(indirect);
+  const size_t   max = std::max<size_t>(device.props.indirect.maxDrawCount,1);
+  for(size_t i=0; i<drawCount; i+=max) {
+    const size_t cnt = std::min(max,drawCount-i);
+    vkCmdDrawIndexedIndirect(impl,ind.impl,VkDeviceSize(offset+i*stride),uint32_t(cnt),uint32_t(stride));
+    }
   }
 
 void VCommandBuffer::setVbo(const Tempest::AbstractGraphicsApi::Buffer &b) {
@@ -161,6 +293,12 @@ void VCommandBuffer::setVbo(const Tempest::AbstractGraphicsApi::Buffer &b) {
         offsets.begin() );
   }
 
+void VCommandBuffer::setInstanceVbo(const AbstractGraphicsApi::Buffer& b) {
+  const VBuffer&     vbo    = reinterpret_cast<const VBuffer&>(b);
+  const VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(impl,1,1,&vbo.impl,&offset);
+  }
+
 void VCommandBuffer::setIbo(const AbstractGraphicsApi::Buffer& b,Detail::IndexClass cls) {
   static const VkIndexType type[]={
     VK_INDEX_TYPE_UINT16,
@@ -182,6 +320,19 @@ void VCommandBuffer::setViewport(const Tempest::Rect &r) {
   vkCmdSetViewport(impl,0,1,&viewPort);
   }
 
+void VCommandBuffer::setScissor(const Tempest::Rect& r) {
+  // offset must be non-negative
+  int32_t x  = std::max(r.x,0);
+  int32_t y  = std::max(r.y,0);
+  int32_t x1 = std::max(r.x+r.w,x);
+  int32_t y1 = std::max(r.y+r.h,y);
+
+  VkRect2D scissor = {};
+  scissor.offset = {x, y};
+  scissor.extent = {uint32_t(x1-x), uint32_t(y1-y)};
+  vkCmdSetScissor(impl,0,1,&scissor);
+  }
+
 void VCommandBuffer::setLayout(VFramebuffer::Attach& a, VkFormat frm, VkImageLayout lay, bool preserve) {
   ImgState* img;
   if(a.tex!=nullptr) {
@@ -242,6 +393,18 @@ void VCommandBuffer::flush(const VBuffer &src, size_t size) {
         );
   }
 
+void VCommandBuffer::uploadBarrier() {
+  // make copies of upload batch visible to every later submit on graphics queue
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(impl,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
 void VCommandBuffer::copy(VBuffer &dest, size_t offsetDest, const VBuffer &src,size_t offsetSrc,size_t size) {
   VkBufferCopy copyRegion = {};
   copyRegion.dstOffset = offsetDest;
@@ -251,6 +414,11 @@ void VCommandBuffer::copy(VBuffer &dest, size_t offsetDest, const VBuffer &src,s
   }
 
 void VCommandBuffer::copy(VTexture &dest, size_t width, size_t height, size_t mip, const VBuffer &src, size_t offset) {
+  copy(dest,0,0,width,height,mip,src,offset);
+  }
+
+void VCommandBuffer::copy(VTexture& dest, size_t x, size_t y, size_t width, size_t height, size_t mip,
+                          const VBuffer& src, size_t offset) {
   VkBufferImageCopy region = {};
   region.bufferOffset      = offset;
   region.bufferRowLength   = 0;
@@ -259,7 +427,7 @@ void VCommandBuffer::copy(VTexture &dest, size_t width, size_t height, size_t mi
   region.imageSubresource.mipLevel = uint32_t(mip);
   region.imageSubresource.baseArrayLayer = 0;
   region.imageSubresource.layerCount = 1;
-  region.imageOffset = {0, 0, 0};
+  region.imageOffset = {int32_t(x), int32_t(y), 0};
   region.imageExtent = {
       uint32_t(width),
       uint32_t(height),
@@ -270,6 +438,11 @@ void VCommandBuffer::copy(VTexture &dest, size_t width, size_t height, size_t mi
   }
 
 void VCommandBuffer::copy(VBuffer &dest, size_t width, size_t height, size_t mip, const VTexture &src, size_t offset) {
+  copy(dest,0,0,width,height,mip,src,offset);
+  }
+
+void VCommandBuffer::copy(VBuffer& dest, size_t x, size_t y, size_t width, size_t height, size_t mip,
+                          const VTexture& src, size_t offset) {
   VkBufferImageCopy region={};
   region.bufferOffset      = offset;
   region.bufferRowLength   = 0;
@@ -278,7 +451,7 @@ void VCommandBuffer::copy(VBuffer &dest, size_t width, size_t height, size_t mip
   region.imageSubresource.mipLevel = uint32_t(mip);
   region.imageSubresource.baseArrayLayer = 0;
   region.imageSubresource.layerCount = 1;
-  region.imageOffset = {0, 0, 0};
+  region.imageOffset = {int32_t(x), int32_t(y), 0};
   region.imageExtent = {
       uint32_t(width),
       uint32_t(height),
@@ -370,6 +543,9 @@ void VCommandBuffer::changeLayout(VkImage dest, VkFormat imageFormat,
       sourceStage   = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
       break;
     case VK_IMAGE_LAYOUT_GENERAL:
+      srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+      sourceStage   = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+      break;
     case VK_IMAGE_LAYOUT_PREINITIALIZED:
     case VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR:
     case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
@@ -413,6 +589,9 @@ void VCommandBuffer::changeLayout(VkImage dest, VkFormat imageFormat,
       destStage     = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
       break;
     case VK_IMAGE_LAYOUT_GENERAL:
+      dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+      destStage     = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+      break;
     case VK_IMAGE_LAYOUT_PREINITIALIZED:
     case VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR:
     case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
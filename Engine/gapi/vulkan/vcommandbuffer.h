@@ -38,6 +38,9 @@ class VCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
 
     VCommandBuffer()=delete;
     VCommandBuffer(VDevice &device, VkCommandPoolCreateFlags flags=VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    VCommandBuffer(VDevice &device, uint32_t family, VkCommandPoolCreateFlags flags);
+    // secondary buffer; has own pool, so each bundle can be recorded on separate thread
+    VCommandBuffer(VDevice &device, VFramebufferLayout& lay, uint32_t width, uint32_t height);
     ~VCommandBuffer();
 
     VkCommandBuffer impl=nullptr;
@@ -51,24 +54,38 @@ class VCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
 
     void beginRenderPass(AbstractGraphicsApi::Fbo* f,
                          AbstractGraphicsApi::Pass*  p,
-                         uint32_t width,uint32_t height);
+                         uint32_t width,uint32_t height,bool bundles);
     void endRenderPass();
+    void execute(const AbstractGraphicsApi::CommandBuffer& bundle);
 
-    void setPipeline(AbstractGraphicsApi::Pipeline& p, uint32_t w, uint32_t h);
+    void setPipeline(AbstractGraphicsApi::Pipeline& p);
     void setBytes   (AbstractGraphicsApi::Pipeline &p, const void* data, size_t size);
     void setUniforms(AbstractGraphicsApi::Pipeline &p, AbstractGraphicsApi::Desc &u);
+    void setUniforms(AbstractGraphicsApi::Pipeline &p, AbstractGraphicsApi::Desc &u, const uint32_t* offsets, size_t count);
+    void setComputePipeline(AbstractGraphicsApi::CompPipeline& p);
+    void setBytes   (AbstractGraphicsApi::CompPipeline& p, const void* data, size_t size);
+    void setUniforms(AbstractGraphicsApi::CompPipeline& p, AbstractGraphicsApi::Desc& u);
+    void dispatch   (size_t x, size_t y, size_t z);
+
     void setViewport(const Rect& r);
+    void setScissor (const Rect& r);
 
     void setVbo(const AbstractGraphicsApi::Buffer& b);
+    void setInstanceVbo(const AbstractGraphicsApi::Buffer& b);
     void setIbo(const AbstractGraphicsApi::Buffer& b, Detail::IndexClass cls);
 
-    void draw(size_t offset, size_t size);
-    void drawIndexed(size_t ioffset, size_t isize, size_t voffset);
+    void draw(size_t offset, size_t size, size_t firstInstance, size_t instanceCount);
+    void drawIndexed(size_t ioffset, size_t isize, size_t voffset, size_t firstInstance, size_t instanceCount);
+    void drawIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t stride);
+    void drawIndexedIndirect(const AbstractGraphicsApi::Buffer& indirect, size_t offset, size_t drawCount, size_t stride);
 
     void flush(const Detail::VBuffer& src, size_t size);
+    void uploadBarrier();
     void copy(Detail::VBuffer&  dest, size_t offsetDest, const Detail::VBuffer& src, size_t offsetSrc, size_t size);
     void copy(Detail::VTexture& dest, size_t width, size_t height, size_t mip, const Detail::VBuffer&  src, size_t offset);
+    void copy(Detail::VTexture& dest, size_t x, size_t y, size_t width, size_t height, size_t mip, const Detail::VBuffer& src, size_t offset);
     void copy(Detail::VBuffer&  dest, size_t width, size_t height, size_t mip, const Detail::VTexture& src, size_t offset);
+    void copy(Detail::VBuffer&  dest, size_t x, size_t y, size_t width, size_t height, size_t mip, const Detail::VTexture& src, size_t offset);
 
     void changeLayout(AbstractGraphicsApi::Swapchain& s, uint32_t id, TextureFormat frm, TextureLayout prev, TextureLayout next);
     void changeLayout(AbstractGraphicsApi::Texture& t, TextureFormat frm, TextureLayout prev, TextureLayout next);
@@ -82,6 +99,13 @@ class VCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
   private:
     struct ImgState;
 
+    struct Bundle {
+      Detail::DSharedPtr<VFramebufferLayout*> lay;
+      uint32_t                                width =0;
+      uint32_t                                height=0;
+      };
+
+    void            alloc(VkCommandBufferLevel level);
     void            flushLayout();
 
     VCommandBuffer::ImgState&
@@ -96,6 +120,8 @@ class VCommandBuffer:public AbstractGraphicsApi::CommandBuffer {
     RpState                                 state=NoRecording;
     Detail::DSharedPtr<VFramebufferLayout*> curFbo;
     VkViewport                              viewPort={};
+    VDescriptorArray*                       curCompDesc=nullptr;
+    Bundle                                  bundle;
   };
 
 }}
@@ -7,10 +7,14 @@
 using namespace Tempest::Detail;
 
 VCommandPool::VCommandPool(VDevice& device,VkCommandPoolCreateFlags flags)
+  :VCommandPool(device,device.props.graphicsFamily,flags) {
+  }
+
+VCommandPool::VCommandPool(VDevice& device, uint32_t family, VkCommandPoolCreateFlags flags)
   :device(device.device) {
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-  poolInfo.queueFamilyIndex = device.props.graphicsFamily;
+  poolInfo.queueFamilyIndex = family;
   poolInfo.flags            = flags;
 
   vkAssert(vkCreateCommandPool(device.device,&poolInfo,nullptr,&impl));
@@ -7,6 +7,8 @@
 #include "vtexture.h"
 #include "vuniformslay.h"
 
+#include <algorithm>
+
 using namespace Tempest;
 using namespace Tempest::Detail;
 
@@ -46,14 +48,20 @@ VDescriptorArray::~VDescriptorArray() {
   }
 
 VkDescriptorPool VDescriptorArray::allocPool(const VUniformsLay& lay, size_t size) {
-  VkDescriptorPoolSize poolSize[3] = {};
+  VkDescriptorPoolSize poolSize[5] = {};
   size_t               pSize=0;
 
   for(size_t i=0;i<lay.lay.size();++i){
     auto cls = lay.lay[i].cls;
     switch(cls) {
-      case UniformsLayout::Ubo:     addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);         break;
+      case UniformsLayout::Ubo:
+        if(lay.isDynamic(lay.lay[i].layout))
+          addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC); else
+          addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        break;
       case UniformsLayout::Texture: addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER); break;
+      case UniformsLayout::Ssbo:    addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);         break;
+      case UniformsLayout::Image:   addPoolSize(poolSize,pSize,VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);          break;
       case UniformsLayout::Push:    break;
       }
     }
@@ -90,27 +98,54 @@ bool VDescriptorArray::allocDescSet(VkDescriptorPool pool, VkDescriptorSetLayout
 
 void VDescriptorArray::set(size_t id, Tempest::AbstractGraphicsApi::Texture* t, const Sampler2d& smp) {
   VTexture* tex=reinterpret_cast<VTexture*>(t);
+  const bool image = (bindingClass(id)==UniformsLayout::Image);
+  if(image && !tex->storage)
+    throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
 
   VkDescriptorImageInfo imageInfo = {};
   imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
   imageInfo.imageView   = tex->getView(device,smp.mapping);
 
-  tex->alloc->updateSampler(imageInfo.sampler,smp,tex->mipCount);
+  if(image) {
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView   = tex->view;
+
+    auto it = std::find_if(storage.begin(),storage.end(),[id](const StorageImg& s){ return s.id==id; });
+    if(it==storage.end())
+      it = storage.insert(storage.end(),StorageImg());
+    it->id  = id;
+    it->img = tex->impl;
+    it->frm = tex->format;
+    } else {
+    tex->alloc->updateSampler(imageInfo.sampler,smp,tex->mipCount);
+    }
 
   VkWriteDescriptorSet descriptorWrite = {};
   descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   descriptorWrite.dstSet          = desc;
   descriptorWrite.dstBinding      = uint32_t(id);
   descriptorWrite.dstArrayElement = 0;
-  descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  descriptorWrite.descriptorType  = image ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   descriptorWrite.descriptorCount = 1;
   descriptorWrite.pImageInfo      = &imageInfo;
 
   vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
   }
 
-void VDescriptorArray::set(size_t id, Tempest::AbstractGraphicsApi::Buffer *buf, size_t offset, size_t size, size_t /*align*/) {
-  VBuffer* memory=reinterpret_cast<VBuffer*>(buf);
+void VDescriptorArray::set(size_t id, Tempest::AbstractGraphicsApi::Buffer *buf, size_t offset, size_t size, size_t align) {
+  VBuffer*         memory=reinterpret_cast<VBuffer*>(buf);
+  auto&            dyn   = lay.handler->dynamic;
+  VkDescriptorType type  = bindingClass(id)==UniformsLayout::Ssbo ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                  : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  auto it = std::lower_bound(dyn.begin(),dyn.end(),uint32_t(id));
+  if(it!=dyn.end() && *it==id) {
+    type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    const auto d = std::distance(dyn.begin(),it);
+    dynStride[d] = uint32_t(align);
+    dynRange [d] = uint32_t(size);
+    dynAvail [d] = memory->size>offset ? memory->size-offset : 0;
+    }
+
   VkDescriptorBufferInfo bufferInfo = {};
   bufferInfo.buffer = memory->impl;
   bufferInfo.offset = offset;
@@ -121,13 +156,34 @@ void VDescriptorArray::set(size_t id, Tempest::AbstractGraphicsApi::Buffer *buf,
   descriptorWrite.dstSet          = desc;
   descriptorWrite.dstBinding      = uint32_t(id);
   descriptorWrite.dstArrayElement = 0;
-  descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  descriptorWrite.descriptorType  = type;
   descriptorWrite.descriptorCount = 1;
   descriptorWrite.pBufferInfo     = &bufferInfo;
 
   vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
   }
 
+uint32_t VDescriptorArray::dynamicOffsets(const uint32_t* offsets, size_t count, uint32_t* out) const {
+  const size_t dynCount = lay.handler->dynamic.size();
+  for(size_t i=0;i<dynCount;++i) {
+    const size_t off = i<count ? size_t(offsets[i])*dynStride[i] : 0;
+    // offset on top of multi-element range would read past the buffer
+    if(off!=0 && dynRange[i]>dynStride[i])
+      throw std::system_error(Tempest::GraphicsErrc::InvalidUniformBuffer);
+    if(off!=0 && off+dynRange[i]>dynAvail[i])
+      throw std::system_error(Tempest::GraphicsErrc::InvalidUniformBuffer);
+    out[i] = uint32_t(off);
+    }
+  return uint32_t(dynCount);
+  }
+
+UniformsLayout::Class VDescriptorArray::bindingClass(size_t id) const {
+  for(auto& i:lay.handler->lay)
+    if(i.layout==id)
+      return i.cls;
+  return UniformsLayout::Ubo;
+  }
+
 void VDescriptorArray::addPoolSize(VkDescriptorPoolSize *p, size_t &sz, VkDescriptorType elt) {
   for(size_t i=0;i<sz;++i){
     if(p[i].type==elt) {
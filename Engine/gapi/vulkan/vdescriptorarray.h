@@ -21,12 +21,28 @@ class VDescriptorArray : public AbstractGraphicsApi::Desc {
 
     void                     set   (size_t id, AbstractGraphicsApi::Texture *tex, const Sampler2d& smp) override;
     void                     set   (size_t id, AbstractGraphicsApi::Buffer* buf, size_t offset, size_t size, size_t align) override;
+    // offsets are in elements; non-zero offset requires binding with range of one element
+    // returns count of written dynamic offsets
+    uint32_t                 dynamicOffsets(const uint32_t* offsets, size_t count, uint32_t* out) const;
+
+    struct StorageImg {
+      size_t   id     = 0;
+      VkImage  img    = VK_NULL_HANDLE;
+      VkFormat frm    = VK_FORMAT_UNDEFINED;
+      };
+    // images in GENERAL layout, only for the duration of dispatch
+    std::vector<StorageImg>  storage;
 
   private:
     Detail::VUniformsLay::Pool* pool=nullptr;
+    uint32_t                    dynStride[VUniformsLay::MAX_DYNAMIC]={};
+    uint32_t                    dynRange [VUniformsLay::MAX_DYNAMIC]={};
+    // bytes of bound buffer, that are available past descriptor offset
+    size_t                      dynAvail [VUniformsLay::MAX_DYNAMIC]={};
 
     VkDescriptorPool         allocPool(const VUniformsLay& lay, size_t size);
     bool                     allocDescSet(VkDescriptorPool pool, VkDescriptorSetLayout lay);
+    UniformsLayout::Class    bindingClass(size_t id) const;
     static void              addPoolSize(VkDescriptorPoolSize* p, size_t& sz, VkDescriptorType elt);
   };
 
@@ -82,8 +82,14 @@ VDevice::VDevice(VulkanApi &api, const char* gpuName)
 
 VDevice::~VDevice(){
   vkDeviceWaitIdle(device);
+  transfer.reset();
   data.reset();
+  // everything, that is still alive, is not released by application
+  for(auto& i:allocator.stats().allocations)
+    Log::e("VDevice: leaked allocation #",i.id,", site=",i.site,", size=",i.size,", heap=",i.heap);
   allocator.freeLast();
+  if(pipelineCache!=VK_NULL_HANDLE)
+    vkDestroyPipelineCache(device,pipelineCache,nullptr);
   vkDestroyDevice(device,nullptr);
   }
 
@@ -97,6 +103,59 @@ void VDevice::implInit(VkPhysicalDevice pdev, VkSurfaceKHR surf) {
   physicalDevice = pdev;
   allocator.setDevice(*this);
   data.reset(new DataMgr(*this));
+  if(transferQueue!=nullptr)
+    transfer.reset(new TransferMgr(*this));
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  vkAssert(vkCreatePipelineCache(device,&cacheInfo,nullptr,&pipelineCache));
+  }
+
+void VDevice::savePipelineCache(std::vector<uint8_t>& out) {
+  size_t size = 0;
+  vkAssert(vkGetPipelineCacheData(device,pipelineCache,&size,nullptr));
+  out.resize(size);
+  VkResult ret = vkGetPipelineCacheData(device,pipelineCache,&size,out.data());
+  if(ret!=VK_INCOMPLETE)
+    vkAssert(ret);
+  out.resize(size);
+  }
+
+bool VDevice::loadPipelineCache(const void* data, size_t size) {
+  if(!isCompatibleCache(data,size))
+    return false;
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = size;
+  cacheInfo.pInitialData    = data;
+
+  VkPipelineCache src = VK_NULL_HANDLE;
+  if(vkCreatePipelineCache(device,&cacheInfo,nullptr,&src)!=VK_SUCCESS)
+    return false;
+  // NOTE: pipelineCache is externally synchronized here; expected to be loaded before pipelines are created
+  VkResult ret = vkMergePipelineCaches(device,pipelineCache,1,&src);
+  vkDestroyPipelineCache(device,src,nullptr);
+  return ret==VK_SUCCESS;
+  }
+
+bool VDevice::isCompatibleCache(const void* data, size_t size) const {
+  // VkPipelineCacheHeaderVersionOne
+  const size_t headerSize = 4*sizeof(uint32_t)+VK_UUID_SIZE;
+  if(data==nullptr || size<headerSize)
+    return false;
+
+  uint32_t head[4] = {};
+  std::memcpy(head,data,sizeof(head));
+
+  VkPhysicalDeviceProperties prop={};
+  vkGetPhysicalDeviceProperties(physicalDevice,&prop);
+
+  if(head[0]<headerSize || head[1]!=VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    return false;
+  if(head[2]!=prop.vendorID || head[3]!=prop.deviceID)
+    return false;
+  return std::memcmp(reinterpret_cast<const uint8_t*>(data)+sizeof(head),prop.pipelineCacheUUID,VK_UUID_SIZE)==0;
   }
 
 VkSurfaceKHR VDevice::createSurface(void* hwnd) {
@@ -158,6 +217,7 @@ void VDevice::deviceQueueProps(Detail::VulkanApi::VkProp& prop,VkPhysicalDevice
 
   uint32_t graphics = uint32_t(-1);
   uint32_t present  = uint32_t(-1);
+  uint32_t dma      = uint32_t(-1);
 
   for(uint32_t i=0;i<queueFamilyCount;++i) {
     const auto& queueFamily = queueFamilies[i];
@@ -167,6 +227,14 @@ void VDevice::deviceQueueProps(Detail::VulkanApi::VkProp& prop,VkPhysicalDevice
     if(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
       graphics = i;
 
+    // prefer dedicated dma family, then any non-graphics family with transfer support
+    // NOTE: copies are always whole mip levels, so any minImageTransferGranularity is fine
+    const VkQueueFlags flg = queueFamily.queueFlags;
+    if((flg & VK_QUEUE_GRAPHICS_BIT)==0 && (flg & (VK_QUEUE_TRANSFER_BIT|VK_QUEUE_COMPUTE_BIT))!=0) {
+      if(dma==uint32_t(-1) || (flg & VK_QUEUE_COMPUTE_BIT)==0)
+        dma = i;
+      }
+
     VkBool32 presentSupport=false;
     if(surf!=VK_NULL_HANDLE)
       vkGetPhysicalDeviceSurfaceSupportKHR(device,i,surf,&presentSupport);
@@ -180,6 +248,7 @@ void VDevice::deviceQueueProps(Detail::VulkanApi::VkProp& prop,VkPhysicalDevice
 
   prop.graphicsFamily = graphics;
   prop.presentFamily  = present;
+  prop.transferFamily = dma;
   }
 
 bool VDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -247,7 +316,7 @@ void VDevice::createLogicalDevice(VkPhysicalDevice pdev) {
     rqExt.push_back(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
     }
 
-  std::array<uint32_t,2> uniqueQueueFamilies = {props.graphicsFamily, props.presentFamily};
+  std::array<uint32_t,3> uniqueQueueFamilies = {props.graphicsFamily, props.presentFamily, props.transferFamily};
   float  queuePriority = 1.0f;
   size_t queueCnt      = 0;
   VkDeviceQueueCreateInfo qinfo[3]={};
@@ -259,7 +328,7 @@ void VDevice::createLogicalDevice(VkPhysicalDevice pdev) {
 
     bool nonUnique=false;
     for(size_t r=0;r<queueCnt;++r)
-      if(q.family==family)
+      if(queues[r].family==family)
         nonUnique = true;
     if(nonUnique)
       continue;
@@ -280,6 +349,8 @@ void VDevice::createLogicalDevice(VkPhysicalDevice pdev) {
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy    = supportedFeatures.samplerAnisotropy;
   deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  deviceFeatures.multiDrawIndirect    = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -300,6 +371,8 @@ void VDevice::createLogicalDevice(VkPhysicalDevice pdev) {
       graphicsQueue = &queues[i];
     if(queues[i].family==props.presentFamily)
       presentQueue = &queues[i];
+    if(queues[i].family==props.transferFamily)
+      transferQueue = &queues[i];
     }
 
   if(props.hasMemRq2) {
@@ -342,18 +415,48 @@ VkResult VDevice::present(VSwapchain &sw, const VSemaphore *wait, size_t wSize,
   }
 
 void VDevice::waitData() {
+  if(transfer!=nullptr)
+    transfer->wait();
   data->wait();
   }
 
+void VDevice::flushData() {
+  // graphics queue executes submits in order, so there is no need to wait on cpu
+  if(transfer!=nullptr)
+    transfer->flush();
+  data->flush();
+  }
+
+bool VDevice::isUploaded(uint64_t ticket) {
+  if(ticket&TransferTicket)
+    return transfer->isComplete(ticket & ~TransferTicket);
+  return data->isComplete(ticket);
+  }
+
+void VDevice::waitUpload(uint64_t ticket) {
+  if(ticket&TransferTicket)
+    transfer->wait(ticket & ~TransferTicket); else
+    data->wait(ticket);
+  }
+
+AbstractGraphicsApi::MemoryStats VDevice::memoryStats() {
+  return allocator.stats();
+  }
+
 const char *VDevice::renderer() const {
   return props.name;
   }
 
 void VDevice::waitIdle() {
+  waitData(); // submit batched uploads
   vkDeviceWaitIdle(device);
   }
 
 void VDevice::submit(VCommandBuffer& cmd, VFence& sync) {
+  // resources, released by transfer queue, must be acquired before use
+  if(transfer!=nullptr)
+    transfer->flush();
+
   VkSubmitInfo submitInfo = {};
   submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
@@ -363,6 +466,29 @@ void VDevice::submit(VCommandBuffer& cmd, VFence& sync) {
   graphicsQueue->submit(1,&submitInfo,sync.impl);
   }
 
+void VDevice::submit(VTransferCmd& cmd, VFence& sync) {
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount   = 1;
+  submitInfo.pCommandBuffers      = &cmd.impl;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores    = &cmd.done.impl;
+  transferQueue->submit(1,&submitInfo,VK_NULL_HANDLE);
+
+  // acquire ownership on graphics queue; later submits are ordered after it
+  VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSubmitInfo acquireInfo = {};
+  acquireInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquireInfo.waitSemaphoreCount = 1;
+  acquireInfo.pWaitSemaphores    = &cmd.done.impl;
+  acquireInfo.pWaitDstStageMask  = &stage;
+  acquireInfo.commandBufferCount = 1;
+  acquireInfo.pCommandBuffers    = &cmd.acquire.impl;
+
+  sync.reset();
+  graphicsQueue->submit(1,&acquireInfo,sync.impl);
+  }
+
 void VDevice::Queue::submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence) {
   std::lock_guard<std::mutex> guard(sync);
   vkAssert(vkQueueSubmit(impl,submitCount,pSubmits,fence));
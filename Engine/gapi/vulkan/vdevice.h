@@ -8,6 +8,7 @@
 #include "vcommandbuffer.h"
 #include "vcommandpool.h"
 #include "vfence.h"
+#include "vtransfercmd.h"
 #include "vulkanapi_impl.h"
 #include "exceptions/exception.h"
 #include "utility/spinlock.h"
@@ -145,10 +146,12 @@ class VDevice : public AbstractGraphicsApi::Device {
     VkInstance              instance           =nullptr;
     VkPhysicalDevice        physicalDevice     =nullptr;
     VkDevice                device             =nullptr;
+    VkPipelineCache         pipelineCache      =VK_NULL_HANDLE;
 
     Queue                   queues[3];
     Queue*                  graphicsQueue=nullptr;
     Queue*                  presentQueue =nullptr;
+    Queue*                  transferQueue=nullptr;
 
     std::mutex              allocSync;
     VAllocator              allocator;
@@ -161,17 +164,32 @@ class VDevice : public AbstractGraphicsApi::Device {
     VkResult                present(VSwapchain& sw,const VSemaphore *wait,size_t wSize,uint32_t imageId);
 
     void                    waitData();
+    void                    flushData();
     const char*             renderer() const override;
     void                    waitIdle() override;
+    void                    savePipelineCache(std::vector<uint8_t>& out) override;
+    bool                    loadPipelineCache(const void* data, size_t size) override;
+    bool                    isUploaded(uint64_t ticket) override;
+    void                    waitUpload(uint64_t ticket) override;
+    MemoryStats             memoryStats() override;
 
     void                    submit(VCommandBuffer& cmd,VFence& sync);
+    void                    submit(VTransferCmd&   cmd,VFence& sync);
 
     VkSurfaceKHR            createSurface(void* hwnd);
     SwapChainSupport        querySwapChainSupport(VkSurfaceKHR surface) { return querySwapChainSupport(physicalDevice,surface); }
     MemIndex                memoryTypeIndex(uint32_t typeBits, VkMemoryPropertyFlags props, VkImageTiling tiling) const;
 
-    using DataMgr = UploadEngine<VDevice,VCommandBuffer,VFence,VBuffer,VTexture>;
-    using Data    = DataMgr::Data;
+    using DataMgr      = UploadEngine<VDevice,VCommandBuffer,VFence,VBuffer,VTexture>;
+    using Data         = DataMgr::Data;
+    using TransferMgr  = UploadEngine<VDevice,VTransferCmd,VFence,VBuffer,VTexture>;
+    using TransferData = TransferMgr::Data;
+
+    // marks tickets of the transfer queue engine
+    static constexpr uint64_t TransferTicket = uint64_t(1)<<63;
+
+    // uploads on dedicated transfer queue; nullptr, if device has none
+    std::unique_ptr<TransferMgr>     transfer;
 
   private:
     VkPhysicalDeviceMemoryProperties memoryProperties;
@@ -187,6 +205,7 @@ class VDevice : public AbstractGraphicsApi::Device {
     SwapChainSupport        querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 
     void                    createLogicalDevice(VkPhysicalDevice pdev);
+    bool                    isCompatibleCache(const void* data, size_t size) const;
 
   friend class DataMgr::Data;
   };
@@ -22,6 +22,15 @@ void VFence::wait() {
   vkAssert(vkWaitForFences(device,1,&impl,VK_TRUE,std::numeric_limits<uint64_t>::max()));
   }
 
+bool VFence::wait(uint64_t timeout) {
+  const uint64_t ns = timeout>=std::numeric_limits<uint64_t>::max()/1000000 ? std::numeric_limits<uint64_t>::max() : timeout*1000000;
+  VkResult ret = vkWaitForFences(device,1,&impl,VK_TRUE,ns);
+  if(ret==VK_TIMEOUT)
+    return false;
+  vkAssert(ret);
+  return true;
+  }
+
 void VFence::reset() {  
   vkAssert(vkResetFences(device,1,&impl));
   }
@@ -20,12 +20,14 @@ VPipeline::VPipeline(){
 
 VPipeline::VPipeline(VDevice& device, const RenderState &st,
                      const Decl::ComponentType *idecl, size_t declSize, size_t stride,
+                     size_t instDeclSize, size_t instStride,
                      Topology tp, const VUniformsLay& ulay,
                      VShader& vert, VShader& frag)
-  : device(device.device), st(st), declSize(declSize), stride(stride), tp(tp), vs(&vert), fs(&frag) {
+  : device(device.device), cache(device.pipelineCache), st(st), declSize(declSize), stride(stride),
+    instDeclSize(instDeclSize), instStride(instStride), tp(tp), vs(&vert), fs(&frag) {
   try {
-    decl.reset(new Decl::ComponentType[declSize]);
-    std::memcpy(decl.get(),idecl,declSize*sizeof(Decl::ComponentType));
+    decl.reset(new Decl::ComponentType[declSize+instDeclSize]);
+    std::memcpy(decl.get(),idecl,(declSize+instDeclSize)*sizeof(Decl::ComponentType));
     pipelineLayout = initLayout(device.device,ulay,pushStageFlags);
     }
   catch(...) {
@@ -36,6 +38,7 @@ VPipeline::VPipeline(VDevice& device, const RenderState &st,
 
 VPipeline::VPipeline(VPipeline &&other) {
   std::swap(device,         other.device);
+  std::swap(cache,          other.cache);
   std::swap(inst,           other.inst);
   std::swap(pipelineLayout, other.pipelineLayout);
   }
@@ -46,22 +49,24 @@ VPipeline::~VPipeline() {
 
 void VPipeline::operator=(VPipeline &&other) {
   std::swap(device,         other.device);
+  std::swap(cache,          other.cache);
   std::swap(inst,           other.inst);
   std::swap(pipelineLayout, other.pipelineLayout);
   }
 
-VPipeline::Inst &VPipeline::instance(VFramebufferLayout &lay, uint32_t width, uint32_t height) {
+VPipeline::Inst &VPipeline::instance(VFramebufferLayout &lay) {
   std::lock_guard<SpinLock> guard(sync);
 
   for(auto& i:inst)
-    if(i.w==width && i.h==height && i.lay.handler==&lay)
+    if(i.lay.handler==&lay)
       return i;
   VkPipeline val=VK_NULL_HANDLE;
   try {
-    val = initGraphicsPipeline(device,pipelineLayout,lay,st,
-                               width,height,decl.get(),declSize,stride,
+    val = initGraphicsPipeline(device,cache,pipelineLayout,lay,st,
+                               decl.get(),declSize,stride,
+                               instDeclSize,instStride,
                                tp,*vs.handler,*fs.handler);
-    inst.emplace_back(width,height,&lay,val);
+    inst.emplace_back(&lay,val);
     }
   catch(...) {
     if(val!=VK_NULL_HANDLE)
@@ -94,6 +99,8 @@ VkPipelineLayout VPipeline::initLayout(VkDevice device, const VUniformsLay& uboL
       pushStageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
     if(uboLay.pb.stage & UniformsLayout::Fragment)
       pushStageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+    if(uboLay.pb.stage & UniformsLayout::Compute)
+      pushStageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
     push.stageFlags = pushStageFlags;
     push.offset     = 0;
     push.size       = uboLay.pb.size;
@@ -107,11 +114,10 @@ VkPipelineLayout VPipeline::initLayout(VkDevice device, const VUniformsLay& uboL
   return ret;
   }
 
-VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout layout,
+VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineCache cache, VkPipelineLayout layout,
                                            const VFramebufferLayout &lay, const RenderState &st,
-                                           uint32_t width, uint32_t height,
                                            const Decl::ComponentType *decl, size_t declSize,
-                                           size_t stride, Topology tp,
+                                           size_t stride, size_t instDeclSize, size_t instStride, Topology tp,
                                            VShader &vert, VShader &frag) {
   VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
   vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -127,10 +133,14 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
 
   VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-  VkVertexInputBindingDescription vk_vertexInputBindingDescription;
-  vk_vertexInputBindingDescription.binding   = 0;
-  vk_vertexInputBindingDescription.stride    = uint32_t(stride);
-  vk_vertexInputBindingDescription.inputRate = VkVertexInputRate::VK_VERTEX_INPUT_RATE_VERTEX;
+  VkVertexInputBindingDescription vk_vertexInputBindingDescription[2] = {};
+  vk_vertexInputBindingDescription[0].binding   = 0;
+  vk_vertexInputBindingDescription[0].stride    = uint32_t(stride);
+  vk_vertexInputBindingDescription[0].inputRate = VkVertexInputRate::VK_VERTEX_INPUT_RATE_VERTEX;
+
+  vk_vertexInputBindingDescription[1].binding   = 1;
+  vk_vertexInputBindingDescription[1].stride    = uint32_t(instStride);
+  vk_vertexInputBindingDescription[1].inputRate = VkVertexInputRate::VK_VERTEX_INPUT_RATE_INSTANCE;
 
   static const VkFormat vertFormats[]={
     VkFormat::VK_FORMAT_UNDEFINED,
@@ -146,6 +156,9 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
 
     VK_FORMAT_R16G16_SNORM,
     VK_FORMAT_R16G16B16A16_SNORM,
+
+    VK_FORMAT_R16G16_UNORM,
+    VK_FORMAT_R16G16B16A16_UNORM,
     };
 
   static const uint32_t vertSize[]={
@@ -160,6 +173,9 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
     4,
     8,
 
+    4,
+    8,
+
     4,
     8
   };
@@ -167,15 +183,17 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
   VkVertexInputAttributeDescription                  vsInputsStk[16]={};
   std::unique_ptr<VkVertexInputAttributeDescription> vsInputHeap;
   VkVertexInputAttributeDescription*                 vsInput = vsInputsStk;
-  if(declSize>16) {
-    vsInputHeap.reset(new VkVertexInputAttributeDescription[declSize]);
+  if(declSize+instDeclSize>16) {
+    vsInputHeap.reset(new VkVertexInputAttributeDescription[declSize+instDeclSize]);
     vsInput = vsInputHeap.get();
     }
   uint32_t offset=0;
-  for(size_t i=0;i<declSize;++i){
+  for(size_t i=0;i<declSize+instDeclSize;++i){
+    if(i==declSize)
+      offset = 0;
     auto& loc=vsInput[i];
     loc.location = uint32_t(i);
-    loc.binding  = 0;
+    loc.binding  = (i<declSize) ? 0 : 1;
     loc.format   = vertFormats[decl[i]];
     loc.offset   = offset;
 
@@ -186,9 +204,9 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
   vertexInputInfo.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
   vertexInputInfo.pNext = nullptr;
   vertexInputInfo.flags = 0;
-  vertexInputInfo.vertexBindingDescriptionCount   = 1;
-  vertexInputInfo.pVertexBindingDescriptions      = &vk_vertexInputBindingDescription;
-  vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(declSize);
+  vertexInputInfo.vertexBindingDescriptionCount   = instDeclSize>0 ? 2 : 1;
+  vertexInputInfo.pVertexBindingDescriptions      = vk_vertexInputBindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(declSize+instDeclSize);
   vertexInputInfo.pVertexAttributeDescriptions    = vsInput;
 
   VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -198,24 +216,13 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; else
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
 
-  VkViewport viewport = {};
-  viewport.x        = 0.0f;
-  viewport.y        = 0.0f;
-  viewport.width    = float(width);
-  viewport.height   = float(height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-
-  VkRect2D scissor = {};
-  scissor.offset = {0, 0};
-  scissor.extent = {width,height};
-
+  // viewport and scissor are dynamic state
   VkPipelineViewportStateCreateInfo viewportState = {};
   viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportState.viewportCount = 1;
-  viewportState.pViewports    = &viewport;
+  viewportState.pViewports    = nullptr;
   viewportState.scissorCount  = 1;
-  viewportState.pScissors     = &scissor;
+  viewportState.pScissors     = nullptr;
 
   static const VkCullModeFlags cullMode[]={
     VK_CULL_MODE_BACK_BIT,
@@ -302,9 +309,9 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
 
   VkPipelineDynamicStateCreateInfo dynamic = {};
   dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  const VkDynamicState dySt[1]={VK_DYNAMIC_STATE_VIEWPORT};
+  const VkDynamicState dySt[2]={VK_DYNAMIC_STATE_VIEWPORT,VK_DYNAMIC_STATE_SCISSOR};
   dynamic.pDynamicStates    = dySt;
-  dynamic.dynamicStateCount = 1;
+  dynamic.dynamicStateCount = 2;
 
   VkGraphicsPipelineCreateInfo pipelineInfo = {};
   pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -324,6 +331,32 @@ VkPipeline VPipeline::initGraphicsPipeline(VkDevice device, VkPipelineLayout lay
   pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
 
   VkPipeline graphicsPipeline=VK_NULL_HANDLE;
-  vkAssert(vkCreateGraphicsPipelines(device,VK_NULL_HANDLE,1,&pipelineInfo,nullptr,&graphicsPipeline));
+  vkAssert(vkCreateGraphicsPipelines(device,cache,1,&pipelineInfo,nullptr,&graphicsPipeline));
   return graphicsPipeline;
   }
+
+
+VCompPipeline::VCompPipeline(VDevice& dev, const VUniformsLay& ulay, VShader& comp)
+  :device(dev.device) {
+  VkShaderStageFlags pushStageFlags = 0;
+  pipelineLayout = VPipeline::initLayout(device,ulay,pushStageFlags);
+
+  VkComputePipelineCreateInfo info = {};
+  info.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  info.stage.module = comp.impl;
+  info.stage.pName  = "main";
+  info.layout       = pipelineLayout;
+
+  VkResult err = vkCreateComputePipelines(device,dev.pipelineCache,1,&info,nullptr,&impl);
+  if(err!=VK_SUCCESS) {
+    vkDestroyPipelineLayout(device,pipelineLayout,nullptr);
+    vkAssert(err);
+    }
+  }
+
+VCompPipeline::~VCompPipeline() {
+  vkDestroyPipeline(device,impl,nullptr);
+  vkDestroyPipelineLayout(device,pipelineLayout,nullptr);
+  }
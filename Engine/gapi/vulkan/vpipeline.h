@@ -2,6 +2,7 @@
 
 #include <Tempest/AbstractGraphicsApi>
 #include <Tempest/RenderState>
+#include <list>
 #include <vector>
 
 #include "../utility/dptr.h"
@@ -22,7 +23,7 @@ class VPipeline : public AbstractGraphicsApi::Pipeline {
     VPipeline();
     VPipeline(VDevice &device, const RenderState &st,
               const Decl::ComponentType *decl, size_t declSize,
-              size_t stride, Topology tp,
+              size_t stride, size_t instDeclSize, size_t instStride, Topology tp,
               const VUniformsLay& ulayImpl,
               VShader &vert, VShader &frag);
     VPipeline(VPipeline&& other);
@@ -31,12 +32,10 @@ class VPipeline : public AbstractGraphicsApi::Pipeline {
     void operator=(VPipeline&& other);
 
     struct Inst final {
-      Inst(uint32_t w,uint32_t h,VFramebufferLayout* lay,VkPipeline val):w(w),h(h),lay(lay),val(val){}
+      Inst(VFramebufferLayout* lay,VkPipeline val):lay(lay),val(val){}
       Inst(Inst&&)=default;
       Inst& operator = (Inst&&)=default;
 
-      uint32_t                                w=0;
-      uint32_t                                h=0;
       Detail::DSharedPtr<VFramebufferLayout*> lay;
       VkPipeline                              val;
       };
@@ -44,26 +43,41 @@ class VPipeline : public AbstractGraphicsApi::Pipeline {
     VkPipelineLayout   pipelineLayout = VK_NULL_HANDLE;
     VkShaderStageFlags pushStageFlags = 0;
 
-    Inst&             instance(VFramebufferLayout &lay, uint32_t width, uint32_t height);
+    Inst&             instance(VFramebufferLayout &lay);
+
+    static VkPipelineLayout initLayout(VkDevice device, const VUniformsLay& uboLay, VkShaderStageFlags& pushFlg);
 
   private:
     VkDevice                               device=nullptr;
+    VkPipelineCache                        cache =VK_NULL_HANDLE;
     Tempest::RenderState                   st;
     size_t                                 declSize=0, stride=0;
+    size_t                                 instDeclSize=0, instStride=0;
     Topology                               tp=Topology::Triangles;
     Detail::DSharedPtr<VShader*>           vs,fs;
     std::unique_ptr<Decl::ComponentType[]> decl;
-    std::vector<Inst>                      inst;
+    // stable storage: instance() references are held by encoders on other threads
+    std::list<Inst>                        inst;
     SpinLock                               sync;
 
     void cleanup();
-    static VkPipelineLayout      initLayout(VkDevice device, const VUniformsLay& uboLay, VkShaderStageFlags& pushFlg);
-    static VkPipeline            initGraphicsPipeline(VkDevice device, VkPipelineLayout layout,
+    static VkPipeline            initGraphicsPipeline(VkDevice device, VkPipelineCache cache, VkPipelineLayout layout,
                                                       const VFramebufferLayout &lay, const RenderState &st,
-                                                      uint32_t width, uint32_t height,
                                                       const Decl::ComponentType *decl, size_t declSize, size_t stride,
-                                                      Topology tp,
+                                                      size_t instDeclSize, size_t instStride, Topology tp,
                                                       VShader &vert, VShader &frag);
   };
 
+class VCompPipeline : public AbstractGraphicsApi::CompPipeline {
+  public:
+    VCompPipeline(VDevice &device, const VUniformsLay& ulay, VShader &comp);
+    ~VCompPipeline();
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline       impl           = VK_NULL_HANDLE;
+
+  private:
+    VkDevice         device         = nullptr;
+  };
+
 }}
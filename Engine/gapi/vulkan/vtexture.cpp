@@ -11,6 +11,7 @@ VTexture::VTexture(VTexture &&other) {
   std::swap(view,     other.view);
   std::swap(format,   other.format);
   std::swap(mipCount, other.mipCount);
+  std::swap(storage,  other.storage);
   std::swap(alloc,    other.alloc);
   std::swap(page,     other.page);
   std::swap(extViews, other.extViews);
@@ -71,7 +72,9 @@ void VTexture::createView(VkImageView& ret, VkDevice device, VkFormat format,
       VK_COMPONENT_SWIZZLE_R,
       VK_COMPONENT_SWIZZLE_G,
       VK_COMPONENT_SWIZZLE_B,
-      VK_COMPONENT_SWIZZLE_A
+      VK_COMPONENT_SWIZZLE_A,
+      VK_COMPONENT_SWIZZLE_ZERO,
+      VK_COMPONENT_SWIZZLE_ONE
       };
     viewInfo.components.r = sw[uint8_t(cmap->r)];
     viewInfo.components.g = sw[uint8_t(cmap->g)];
@@ -30,6 +30,7 @@ class VTexture : public AbstractGraphicsApi::Texture {
     VkImageView getView(VkDevice dev, const ComponentMapping& m);
 
     uint32_t    mipCount = 1;
+    bool        storage  = false; // created with VK_IMAGE_USAGE_STORAGE_BIT
 
     VAllocator*            alloc =nullptr;
     VAllocator::Allocation page  ={};
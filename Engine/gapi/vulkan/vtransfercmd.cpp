@@ -0,0 +1,93 @@
+#include "vtransfercmd.h"
+
+#include "vdevice.h"
+#include "vbuffer.h"
+#include "vtexture.h"
+
+using namespace Tempest;
+using namespace Tempest::Detail;
+
+VTransferCmd::VTransferCmd(VDevice& device)
+  :VCommandBuffer(device,device.props.transferFamily,VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT),
+   acquire(device), done(device),
+   srcFamily(device.props.transferFamily), dstFamily(device.props.graphicsFamily) {
+  }
+
+void VTransferCmd::reset() {
+  VCommandBuffer::reset();
+  acquire.reset();
+  }
+
+void VTransferCmd::begin() {
+  VCommandBuffer::begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  acquire.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  }
+
+void VTransferCmd::end() {
+  VCommandBuffer::end();
+  acquire.end();
+  }
+
+void VTransferCmd::release(VBuffer& dest, size_t size) {
+  VkBufferMemoryBarrier rel = {};
+  rel.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  rel.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  rel.dstAccessMask       = 0;
+  rel.srcQueueFamilyIndex = srcFamily;
+  rel.dstQueueFamilyIndex = dstFamily;
+  rel.buffer              = dest.impl;
+  rel.offset              = 0;
+  rel.size                = size;
+
+  VkBufferMemoryBarrier acq = rel;
+  acq.srcAccessMask       = 0;
+  acq.dstAccessMask       = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                            VK_ACCESS_TRANSFER_READ_BIT;
+  barrier(rel,acq);
+  }
+
+void VTransferCmd::release(AbstractGraphicsApi::Texture& t, TextureFormat frm,
+                           TextureLayout prev, TextureLayout next, uint32_t mipCnt) {
+  auto& dest = reinterpret_cast<VTexture&>(t);
+
+  VkImageMemoryBarrier rel = {};
+  rel.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  rel.oldLayout           = Detail::nativeFormat(prev);
+  rel.newLayout           = Detail::nativeFormat(next);
+  rel.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  rel.dstAccessMask       = 0;
+  rel.srcQueueFamilyIndex = srcFamily;
+  rel.dstQueueFamilyIndex = dstFamily;
+  rel.image               = dest.impl;
+
+  rel.subresourceRange.aspectMask     = Detail::nativeIsDepthFormat(Detail::nativeFormat(frm)) ?
+                                          VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+  rel.subresourceRange.baseMipLevel   = 0;
+  rel.subresourceRange.levelCount     = mipCnt;
+  rel.subresourceRange.baseArrayLayer = 0;
+  rel.subresourceRange.layerCount     = 1;
+
+  VkImageMemoryBarrier acq = rel;
+  acq.srcAccessMask       = 0;
+  acq.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  barrier(rel,acq);
+  }
+
+void VTransferCmd::barrier(VkBufferMemoryBarrier& rel, VkBufferMemoryBarrier& acq) {
+  vkCmdPipelineBarrier(impl,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0, 0, nullptr, 1, &rel, 0, nullptr);
+  vkCmdPipelineBarrier(acquire.impl,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       0, 0, nullptr, 1, &acq, 0, nullptr);
+  }
+
+void VTransferCmd::barrier(VkImageMemoryBarrier& rel, VkImageMemoryBarrier& acq) {
+  vkCmdPipelineBarrier(impl,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0, 0, nullptr, 0, nullptr, 1, &rel);
+  vkCmdPipelineBarrier(acquire.impl,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       0, 0, nullptr, 0, nullptr, 1, &acq);
+  }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+#include "vulkan_sdk.h"
+
+#include "vcommandbuffer.h"
+#include "vsemaphore.h"
+
+namespace Tempest {
+namespace Detail {
+
+class VDevice;
+class VBuffer;
+class VTexture;
+
+// command buffer of dedicated transfer queue; every written resource is released to graphics queue family,
+// matching acquire barriers are recorded into 'acquire', that is submitted to graphics queue after 'done'
+class VTransferCmd : public VCommandBuffer {
+  public:
+    VTransferCmd(VDevice& device);
+
+    void reset();
+    void begin();
+    void end();
+    // no-op: acquire barrier makes copies visible to graphics queue
+    void uploadBarrier() {}
+
+    void release(VBuffer& dest, size_t size);
+    void release(AbstractGraphicsApi::Texture& dest, TextureFormat frm, TextureLayout prev, TextureLayout next, uint32_t mipCnt);
+
+    VCommandBuffer acquire;
+    VSemaphore     done;
+
+  private:
+    void barrier(VkBufferMemoryBarrier& release, VkBufferMemoryBarrier& acquire);
+    void barrier(VkImageMemoryBarrier&  release, VkImageMemoryBarrier&  acquire);
+
+    uint32_t       srcFamily = 0;
+    uint32_t       dstFamily = 0;
+  };
+
+}}
@@ -6,6 +6,7 @@
 #include "exceptions/exception.h"
 #include "vdevice.h"
 
+#include <algorithm>
 #include <set>
 #include <thread>
 #include <cstring>
@@ -190,6 +191,24 @@ void VulkanApi::getDevicePropsShort(VkPhysicalDevice physicalDevice, Tempest::Ab
   c.anisotropy    = supportedFeatures.samplerAnisotropy;
   c.maxAnisotropy = prop.limits.maxSamplerAnisotropy;
 
+  // dispatch is recorded into graphics command buffers
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice,&queueFamilyCount,nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice,&queueFamilyCount,queueFamilies.data());
+  for(auto& i:queueFamilies) {
+    const VkQueueFlags rq = VK_QUEUE_GRAPHICS_BIT|VK_QUEUE_COMPUTE_BIT;
+    if(i.queueCount>0 && (i.queueFlags&rq)==rq)
+      c.compute.enabled = true;
+    }
+  c.compute.maxGroups      = size_t(std::min(prop.limits.maxComputeWorkGroupCount[0],
+                                    std::min(prop.limits.maxComputeWorkGroupCount[1],prop.limits.maxComputeWorkGroupCount[2])));
+  c.compute.maxInvocations = size_t(prop.limits.maxComputeWorkGroupInvocations);
+
+  c.indirect.multiDraw     = supportedFeatures.multiDrawIndirect;
+  c.indirect.maxDrawCount  = c.indirect.multiDraw ? size_t(prop.limits.maxDrawIndirectCount) : 1;
+  c.indirect.firstInstance = supportedFeatures.drawIndirectFirstInstance;
+
   switch(prop.deviceType) {
     case VK_PHYSICAL_DEVICE_TYPE_CPU:
       c.type = AbstractGraphicsApi::DeviceType::Cpu;
@@ -208,7 +227,7 @@ void VulkanApi::getDevicePropsShort(VkPhysicalDevice physicalDevice, Tempest::Ab
       break;
     }
 
-  uint64_t smpFormat=0, attFormat=0, dattFormat=0;
+  uint64_t smpFormat=0, attFormat=0, dattFormat=0, storFormat=0;
   for(uint32_t i=0;i<TextureFormat::Last;++i){
     VkFormat f = Detail::nativeFormat(TextureFormat(i));
 
@@ -229,10 +248,14 @@ void VulkanApi::getDevicePropsShort(VkPhysicalDevice physicalDevice, Tempest::Ab
     if((frm.optimalTilingFeatures & depthAttflags)==depthAttflags){
       dattFormat |= (1ull<<i);
       }
+    if(!isCompressedFormat(TextureFormat(i)) && (frm.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)){
+      storFormat |= (1ull<<i);
+      }
     }
   c.setSamplerFormats(smpFormat);
   c.setAttachFormats (attFormat);
   c.setDepthFormats  (dattFormat);
+  c.setStorageFormats(storFormat);
   }
 
 VkBool32 VulkanApi::debugReportCallback(VkDebugReportFlagsEXT      flags,
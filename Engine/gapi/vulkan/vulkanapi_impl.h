@@ -21,6 +21,7 @@ class VulkanApi {
     struct VkProp:Tempest::AbstractGraphicsApi::Props {
       uint32_t graphicsFamily=uint32_t(-1);
       uint32_t presentFamily =uint32_t(-1);
+      uint32_t transferFamily=uint32_t(-1);
 
       size_t   nonCoherentAtomSize=0;
       size_t   bufferImageGranularity=0;
@@ -4,6 +4,8 @@
 #include "vdevice.h"
 #include "gapi/shaderreflection.h"
 
+#include <algorithm>
+
 using namespace Tempest;
 using namespace Tempest::Detail;
 
@@ -12,6 +14,33 @@ VUniformsLay::VUniformsLay(VkDevice dev,
                            const std::vector<UniformsLayout::Binding>& fs)
   : dev(dev) {
   ShaderReflection::merge(lay, pb, vs,fs);
+  init();
+  }
+
+VUniformsLay::VUniformsLay(VkDevice dev, const std::vector<UniformsLayout::Binding>& comp)
+  : dev(dev) {
+  ShaderReflection::merge(lay, pb, comp);
+  init();
+  }
+
+VUniformsLay::~VUniformsLay() {
+  for(auto& i:pool)
+    vkDestroyDescriptorPool(dev,i.impl,nullptr);
+  vkDestroyDescriptorSetLayout(dev,impl,nullptr);
+  }
+
+bool VUniformsLay::isDynamic(uint32_t id) const {
+  return std::binary_search(dynamic.begin(),dynamic.end(),id);
+  }
+
+void VUniformsLay::init() {
+  for(auto& i:lay)
+    if(i.cls==UniformsLayout::Ubo)
+      dynamic.push_back(i.layout);
+  std::sort(dynamic.begin(),dynamic.end());
+  if(dynamic.size()>MAX_DYNAMIC)
+    dynamic.clear();
+
   if(lay.size()<=32) {
     VkDescriptorSetLayoutBinding bind[32]={};
     implCreate(bind);
@@ -21,16 +50,13 @@ VUniformsLay::VUniformsLay(VkDevice dev,
     }
   }
 
-VUniformsLay::~VUniformsLay() {
-  for(auto& i:pool)
-    vkDestroyDescriptorPool(dev,i.impl,nullptr);
-  vkDestroyDescriptorSetLayout(dev,impl,nullptr);
-  }
-
 void VUniformsLay::implCreate(VkDescriptorSetLayoutBinding* bind) {
   static const VkDescriptorType types[] = {
     VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, // push, not a descriptor
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
     };
 
   for(size_t i=0;i<lay.size();++i){
@@ -40,12 +66,16 @@ void VUniformsLay::implCreate(VkDescriptorSetLayoutBinding* bind) {
     b.binding         = e.layout;
     b.descriptorCount = 1;
     b.descriptorType  = types[e.cls];
+    if(isDynamic(e.layout))
+      b.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 
     b.stageFlags      = 0;
     if(e.stage&UniformsLayout::Vertex)
       b.stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
     if(e.stage&UniformsLayout::Fragment)
       b.stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+    if(e.stage&UniformsLayout::Compute)
+      b.stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
     }
 
   VkDescriptorSetLayoutCreateInfo info={};
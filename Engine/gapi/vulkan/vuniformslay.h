@@ -22,14 +22,23 @@ class VShader;
 class VUniformsLay : public AbstractGraphicsApi::UniformsLay {
   public:
     VUniformsLay(VkDevice dev, const std::vector<UniformsLayout::Binding>& vs, const std::vector<UniformsLayout::Binding>& fs);
+    VUniformsLay(VkDevice dev, const std::vector<UniformsLayout::Binding>& comp);
     ~VUniformsLay();
 
     using Binding = UniformsLayout::Binding;
 
+    enum {
+      MAX_DYNAMIC=8 // minimal maxDescriptorSetUniformBuffersDynamic
+      };
+
     VkDevice                      dev =nullptr;
     VkDescriptorSetLayout         impl=VK_NULL_HANDLE;
     std::vector<Binding>          lay;
     UniformsLayout::PushBlock     pb;
+    // uniform buffers with dynamic offset, sorted by binding
+    std::vector<uint32_t>         dynamic;
+
+    bool                          isDynamic(uint32_t id) const;
 
   private:
     enum {
@@ -44,6 +53,7 @@ class VUniformsLay : public AbstractGraphicsApi::UniformsLay {
     Detail::SpinLock sync;
     std::list<Pool>  pool;
 
+    void init();
     void implCreate(VkDescriptorSetLayoutBinding *bind);
 
   friend class VDescriptorArray;
@@ -18,6 +18,8 @@
 #include "vulkan/vuniformslay.h"
 
 #include "deviceallocator.h"
+#include "graphicsmemutils.h"
+#include "pixmapreadback.h"
 
 #include "vulkan/vulkan_sdk.h"
 
@@ -25,6 +27,8 @@
 #include <Tempest/Log>
 #include <Tempest/UniformsLayout>
 
+#include <cstring>
+
 using namespace Tempest;
 
 struct VulkanApi::Impl : public Detail::VulkanApi {
@@ -139,7 +143,7 @@ AbstractGraphicsApi::PFboLayout VulkanApi::createFboLayout(AbstractGraphicsApi::
 AbstractGraphicsApi::PPipeline VulkanApi::createPipeline(AbstractGraphicsApi::Device *d,
                                                          const RenderState &st,
                                                          const Decl::ComponentType *decl, size_t declSize,
-                                                         size_t stride,
+                                                         size_t stride, size_t instDeclSize, size_t instStride,
                                                          Topology tp,
                                                          const UniformsLay& ulayImpl,
                                                          const std::initializer_list<AbstractGraphicsApi::Shader*> &shaders) {
@@ -149,7 +153,19 @@ AbstractGraphicsApi::PPipeline VulkanApi::createPipeline(AbstractGraphicsApi::De
   auto* fs = reinterpret_cast<Detail::VShader*>(arr[1]);
   auto& ul = reinterpret_cast<const Detail::VUniformsLay&>(ulayImpl);
 
-  return PPipeline(new Detail::VPipeline(*dx,st,decl,declSize,stride,tp,ul,*vs,*fs));
+  return PPipeline(new Detail::VPipeline(*dx,st,decl,declSize,stride,instDeclSize,instStride,tp,ul,*vs,*fs));
+  }
+
+AbstractGraphicsApi::PCompPipeline VulkanApi::createComputePipeline(AbstractGraphicsApi::Device* d,
+                                                                    const UniformsLay& ulayImpl,
+                                                                    AbstractGraphicsApi::Shader* shader) {
+  auto* dx = reinterpret_cast<Detail::VDevice*>(d);
+  auto* cs = reinterpret_cast<Detail::VShader*>(shader);
+  auto& ul = reinterpret_cast<const Detail::VUniformsLay&>(ulayImpl);
+
+  if(!dx->props.compute.enabled)
+    throw std::system_error(Tempest::GraphicsErrc::UnsupportedFeature);
+  return PCompPipeline(new Detail::VCompPipeline(*dx,ul,*cs));
   }
 
 AbstractGraphicsApi::PShader VulkanApi::createShader(AbstractGraphicsApi::Device *d, const void* source, size_t src_size) {
@@ -167,6 +183,62 @@ AbstractGraphicsApi::Semaphore *VulkanApi::createSemaphore(AbstractGraphicsApi::
   return new Detail::VSemaphore(*dx);
   }
 
+template<class Data>
+static void uploadBuffer(Detail::VDevice& dx, Data& dat, Detail::DSharedPtr<Detail::VBuffer*>& pbuf,
+                         const void* mem, size_t count, size_t size, size_t alignedSz) {
+  const Detail::VBuffer* stage  = nullptr;
+  size_t                 offset = 0;
+  if(auto ptr = dat.stage(count*alignedSz,16,stage,offset)) {
+    Detail::copyUpsample(mem,ptr,count,size,alignedSz);
+    } else {
+    Detail::VBuffer s=dx.allocator.alloc(mem,count,size,alignedSz,MemUsage::TransferSrc,BufferHeap::Upload);
+    Detail::DSharedPtr<Detail::VBuffer*> pstage(new Detail::VBuffer(std::move(s)));
+    dat.flush(*pstage.handler,count*alignedSz);
+    dat.hold(pstage); // preserve stage buffer, until gpu side copy is finished
+    stage = pstage.handler;
+    }
+  dat.hold(pbuf);
+  dat.copy(*pbuf.handler,0,*stage,offset,count*alignedSz);
+  }
+
+template<class Data>
+static void uploadTexture(Detail::VDevice& dx, Data& dat, Detail::DSharedPtr<Detail::VTexture*>& pbuf,
+                          const Pixmap& p, TextureFormat frm, uint32_t mipCnt) {
+  const uint32_t         size  = uint32_t(p.dataSize());
+  const Detail::VBuffer* stage = nullptr;
+  size_t                 base  = 0;
+  // offset must be multiple of 4 and of texel (or block) size
+  const size_t           align = isCompressedFormat(frm) ? 16 : p.bpp()*4;
+  if(auto ptr = dat.stage(size,align,stage,base)) {
+    std::memcpy(ptr,p.data(),size);
+    } else {
+    Detail::VBuffer s = dx.allocator.alloc(p.data(),size,1,1,MemUsage::TransferSrc,BufferHeap::Upload);
+    Detail::DSharedPtr<Detail::VBuffer*> pstage(new Detail::VBuffer(std::move(s)));
+    dat.hold(pstage);
+    stage = pstage.handler;
+    base  = 0;
+    }
+  dat.hold(pbuf);
+
+  dat.changeLayout(*pbuf.handler, frm, TextureLayout::Undefined, TextureLayout::TransferDest,mipCnt);
+  if(isCompressedFormat(frm)){
+    size_t blocksize  = (frm==TextureFormat::DXT1) ? 8 : 16;
+    size_t bufferSize = 0;
+
+    uint32_t w = uint32_t(p.w()), h = uint32_t(p.h());
+    for(uint32_t i=0; i<mipCnt; i++){
+      size_t blockcount = ((w+3)/4)*((h+3)/4);
+      dat.copy(*pbuf.handler,w,h,i,*stage,base+bufferSize);
+
+      bufferSize += blockcount*blocksize;
+      w = std::max<uint32_t>(1,w/2);
+      h = std::max<uint32_t>(1,h/2);
+      }
+    } else {
+    dat.copy(*pbuf.handler,p.w(),p.h(),0,*stage,base);
+    }
+  }
+
 AbstractGraphicsApi::PBuffer VulkanApi::createBuffer(AbstractGraphicsApi::Device *d,
                                                      const void *mem, size_t count, size_t size, size_t alignedSz,
                                                      MemUsage usage, BufferHeap flg) {
@@ -177,75 +249,69 @@ AbstractGraphicsApi::PBuffer VulkanApi::createBuffer(AbstractGraphicsApi::Device
     return PBuffer(new Detail::VBuffer(std::move(stage)));
     }
   else {
-    Detail::VBuffer  stage=dx->allocator.alloc(mem,     count,size,alignedSz, MemUsage::TransferSrc,      BufferHeap::Upload);
     Detail::VBuffer  buf  =dx->allocator.alloc(nullptr, count,size,alignedSz, usage|MemUsage::TransferDst,BufferHeap::Static);
-
-    Detail::DSharedPtr<Detail::VBuffer*> pstage(new Detail::VBuffer(std::move(stage)));
     Detail::DSharedPtr<Detail::VBuffer*> pbuf  (new Detail::VBuffer(std::move(buf)));
 
-    Detail::VDevice::Data dat(*dx);
-    dat.flush(*pstage.handler,count*alignedSz);
-    dat.hold(pbuf);
-    dat.hold(pstage); // preserve stage buffer, until gpu side copy is finished
-    dat.copy(*pbuf.handler,*pstage.handler,count*alignedSz);
-    dat.commit();
-
+    if(dx->transfer!=nullptr) {
+      Detail::VDevice::TransferData dat(*dx->transfer);
+      uploadBuffer(*dx,dat,pbuf,mem,count,size,alignedSz);
+      dat.release(*pbuf.handler,count*alignedSz);
+      dat.commit();
+      } else {
+      Detail::VDevice::Data dat(*dx);
+      uploadBuffer(*dx,dat,pbuf,mem,count,size,alignedSz);
+      dat.commit();
+      }
     return PBuffer(pbuf.handler);
     }
   }
 
+AbstractGraphicsApi::PBuffer VulkanApi::createMappedBuffer(AbstractGraphicsApi::Device* d, size_t size,
+                                                           MemUsage usage, void*& mapped) {
+  Detail::VDevice& dx  = *reinterpret_cast<Detail::VDevice*>(d);
+  Detail::VBuffer  buf = dx.allocator.allocStaging(size,usage);
+  mapped = dx.allocator.map(buf);
+  if(mapped==nullptr)
+    throw std::system_error(Tempest::GraphicsErrc::OutOfHostMemory);
+  return PBuffer(new Detail::VBuffer(std::move(buf)));
+  }
+
 AbstractGraphicsApi::PTexture VulkanApi::createTexture(AbstractGraphicsApi::Device *d, const Pixmap &p, TextureFormat frm, uint32_t mipCnt) {
   Detail::VDevice& dx     = *reinterpret_cast<Detail::VDevice*>(d);
-  const uint32_t   size   = uint32_t(p.dataSize());
   VkFormat         format = Detail::nativeFormat(frm);
-  Detail::VBuffer  stage  = dx.allocator.alloc(p.data(),size,1,1,MemUsage::TransferSrc,BufferHeap::Upload);
   Detail::VTexture buf    = dx.allocator.alloc(p,mipCnt,format);
+  Detail::DSharedPtr<Detail::VTexture*> pbuf(new Detail::VTexture(std::move(buf)));
 
-  Detail::DSharedPtr<Detail::VBuffer*>  pstage(new Detail::VBuffer (std::move(stage)));
-  Detail::DSharedPtr<Detail::VTexture*> pbuf  (new Detail::VTexture(std::move(buf)));
-
-  Detail::VDevice::Data dat(dx);
-  dat.hold(pstage);
-  dat.hold(pbuf);
-
-  dat.changeLayout(*pbuf.handler, frm, TextureLayout::Undefined, TextureLayout::TransferDest,mipCnt);
-  if(isCompressedFormat(frm)){
-    size_t blocksize  = (frm==TextureFormat::DXT1) ? 8 : 16;
-    size_t bufferSize = 0;
-
-    uint32_t w = uint32_t(p.w()), h = uint32_t(p.h());
-    for(uint32_t i=0; i<mipCnt; i++){
-      size_t blockcount = ((w+3)/4)*((h+3)/4);
-      dat.copy(*pbuf.handler,w,h,i,*pstage.handler,bufferSize);
-
-      bufferSize += blockcount*blocksize;
-      w = std::max<uint32_t>(1,w/2);
-      h = std::max<uint32_t>(1,h/2);
-      }
-
-    dat.changeLayout(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler, mipCnt);
+  // mip generation blits on graphics queue; everything else goes to transfer queue, if there is one
+  const bool genMips = !isCompressedFormat(frm) && mipCnt>1;
+  if(dx.transfer!=nullptr && !genMips) {
+    Detail::VDevice::TransferData dat(*dx.transfer);
+    uploadTexture(dx,dat,pbuf,p,frm,mipCnt);
+    dat.release(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler, mipCnt);
+    pbuf.handler->ticket = dat.commit() | Detail::VDevice::TransferTicket;
     } else {
-    dat.copy(*pbuf.handler,p.w(),p.h(),0,*pstage.handler,0);
-    if(mipCnt>1)
+    Detail::VDevice::Data dat(dx);
+    uploadTexture(dx,dat,pbuf,p,frm,mipCnt);
+    if(genMips)
       dat.generateMipmap(*pbuf.handler,frm,p.w(),p.h(),mipCnt); else
-      dat.changeLayout(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler,mipCnt);
+      dat.changeLayout(*pbuf.handler, frm, TextureLayout::TransferDest, TextureLayout::Sampler, mipCnt);
+    pbuf.handler->ticket = dat.commit();
     }
-  dat.commit();
   return PTexture(pbuf.handler);
   }
 
-AbstractGraphicsApi::PTexture VulkanApi::createTexture(AbstractGraphicsApi::Device *d, const uint32_t w, const uint32_t h, uint32_t mipCnt, TextureFormat frm) {
+AbstractGraphicsApi::PTexture VulkanApi::createTexture(AbstractGraphicsApi::Device *d, const uint32_t w, const uint32_t h, uint32_t mipCnt, TextureFormat frm, bool storage) {
   Detail::VDevice* dx = reinterpret_cast<Detail::VDevice*>(d);
   
-  Detail::VTexture buf=dx->allocator.alloc(w,h,mipCnt,frm);
+  Detail::VTexture buf=dx->allocator.alloc(w,h,mipCnt,frm,storage);
   Detail::DSharedPtr<Detail::VTexture*> pbuf(new Detail::VTexture(std::move(buf)));
 
   return PTexture(pbuf.handler);
   }
 
-void VulkanApi::readPixels(AbstractGraphicsApi::Device *d, Pixmap& out, const PTexture t,
-                           TextureLayout lay, TextureFormat frm,
-                           const uint32_t w, const uint32_t h, uint32_t mip) {
+AbstractGraphicsApi::Readback* VulkanApi::readPixels(AbstractGraphicsApi::Device *d, const PTexture t,
+                                                    TextureLayout lay, TextureFormat frm,
+                                                    const Rect& r, uint32_t mip) {
   Detail::VDevice&  dx = *reinterpret_cast<Detail::VDevice*>(d);
   Detail::VTexture& tx = *reinterpret_cast<Detail::VTexture*>(t.handler);
 
@@ -274,19 +340,86 @@ void VulkanApi::readPixels(AbstractGraphicsApi::Device *d, Pixmap& out, const PT
     case TextureFormat::DXT5:      bpp=0; break;
     }
 
+  if(mip>=tx.mipCount)
+    throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+
+  const uint32_t  w     = uint32_t(r.w);
+  const uint32_t  h     = uint32_t(r.h);
   const size_t    size  = w*h*bpp;
   Detail::VBuffer stage = dx.allocator.alloc(nullptr,size,1,1,MemUsage::TransferDst,BufferHeap::Readback);
+  Detail::DSharedPtr<Detail::VBuffer*>  pstage(new Detail::VBuffer(std::move(stage)));
+  Detail::DSharedPtr<Detail::VTexture*> ptex(&tx);
 
   Detail::VDevice::Data dat(dx);
-  dat.changeLayout(tx, frm, lay, TextureLayout::TransferSrc, 1);
-  dat.copy(stage,w,h,mip,tx,0);
-  dat.changeLayout(tx, frm, TextureLayout::TransferSrc, lay, 1);
-  dat.commit();
+  dat.hold(pstage);
+  dat.hold(ptex);
+  dat.changeLayout(tx, frm, lay, TextureLayout::TransferSrc, tx.mipCount);
+  dat.copy(*pstage.handler,uint32_t(r.x),uint32_t(r.y),w,h,mip,tx,0);
+  dat.changeLayout(tx, frm, TextureLayout::TransferSrc, lay, tx.mipCount);
+  const uint64_t ticket = dat.commit();
+
+  return new Detail::PixmapReadback<Detail::VDevice,Detail::VBuffer>(dx,std::move(pstage),ticket,w,h,pfrm,bpp,w*bpp);
+  }
 
-  dx.waitData();
+void VulkanApi::readBytes(AbstractGraphicsApi::Device* d, AbstractGraphicsApi::Buffer* buf, void* out, size_t size) {
+  Detail::VDevice& dx = *reinterpret_cast<Detail::VDevice*>(d);
+  Detail::VBuffer& bx = *reinterpret_cast<Detail::VBuffer*>(buf);
 
-  out = Pixmap(w,h,pfrm);
-  stage.read(out.data(),0,size);
+  Detail::VBuffer stage = dx.allocator.alloc(nullptr,size,1,1,MemUsage::TransferDst,BufferHeap::Readback);
+  // order copy after every submitted frame; copy runs on graphics queue, that owns the buffer
+  dx.waitIdle();
+
+  Detail::VDevice::Data dat(dx);
+  dat.copy(stage,0,bx,0,size);
+  dx.waitUpload(dat.commit());
+
+  stage.read(out,0,size);
+  }
+
+void VulkanApi::updateTexture(AbstractGraphicsApi::Device* d, PTexture t, const Pixmap& p, TextureFormat frm,
+                              const Rect* rect, size_t count) {
+  Detail::VDevice&  dx  = *reinterpret_cast<Detail::VDevice*>(d);
+  Detail::VTexture& tx  = *reinterpret_cast<Detail::VTexture*>(t.handler);
+  // compressed formats are copied as rows of 4x4 blocks; rects are block-aligned
+  const size_t      blk = isCompressedFormat(frm) ? 4 : 1;
+  const size_t      bpp = isCompressedFormat(frm) ? (frm==TextureFormat::DXT1 ? 8 : 16) : p.bpp();
+  const size_t      pw  = (p.w()+blk-1)/blk;
+
+  // pack all regions into one staging buffer; offsets are aligned to 16 to satisfy texel/4-byte alignment
+  std::vector<size_t> offset(count);
+  size_t size = 0;
+  for(size_t i=0;i<count;++i) {
+    offset[i] = size;
+    size     += (((size_t(rect[i].w)+blk-1)/blk*((size_t(rect[i].h)+blk-1)/blk)*bpp+15)/16)*16;
+    }
+  if(size==0)
+    return;
+
+  std::vector<uint8_t> tmp(size);
+  auto src = reinterpret_cast<const uint8_t*>(p.data());
+  for(size_t i=0;i<count;++i) {
+    const Rect&  r   = rect[i];
+    const size_t row = (size_t(r.w)+blk-1)/blk*bpp;
+    const size_t h   = (size_t(r.h)+blk-1)/blk;
+    for(size_t y=0;y<h;++y)
+      std::memcpy(&tmp[offset[i]+y*row], src+((size_t(r.y)/blk+y)*pw+size_t(r.x)/blk)*bpp, row);
+    }
+
+  Detail::VBuffer stage = dx.allocator.alloc(tmp.data(),size,1,1,MemUsage::TransferSrc,BufferHeap::Upload);
+  Detail::DSharedPtr<Detail::VBuffer*>  pstage(new Detail::VBuffer(std::move(stage)));
+  Detail::DSharedPtr<Detail::VTexture*> ptex  (&tx);
+
+  // barriers order the copy after any in-flight draw, that samples this texture - no device idle required
+  Detail::VDevice::Data dat(dx);
+  dat.hold(pstage);
+  dat.hold(ptex);
+  dat.changeLayout(tx, frm, TextureLayout::Sampler, TextureLayout::TransferDest, 1);
+  for(size_t i=0;i<count;++i) {
+    const Rect& r = rect[i];
+    dat.copy(tx,uint32_t(r.x),uint32_t(r.y),uint32_t(r.w),uint32_t(r.h),0,*pstage.handler,offset[i]);
+    }
+  dat.changeLayout(tx, frm, TextureLayout::TransferDest, TextureLayout::Sampler, 1);
+  dat.commit();
   }
 
 AbstractGraphicsApi::Desc *VulkanApi::createDescriptors(AbstractGraphicsApi::Device* d, UniformsLay& ulayImpl) {
@@ -300,6 +433,10 @@ AbstractGraphicsApi::Desc *VulkanApi::createDescriptors(AbstractGraphicsApi::Dev
 AbstractGraphicsApi::PUniformsLay VulkanApi::createUboLayout(Device *d, const std::initializer_list<Shader*>& shaders) {
   Shader*const*         arr= shaders.begin();
   auto* dx = reinterpret_cast<Detail::VDevice*>(d);
+  if(shaders.size()==1) {
+    auto* cs = reinterpret_cast<Detail::VShader*>(arr[0]);
+    return PUniformsLay(new Detail::VUniformsLay(dx->device,cs->lay));
+    }
   auto* vs = reinterpret_cast<Detail::VShader*>(arr[0]);
   auto* fs = reinterpret_cast<Detail::VShader*>(arr[1]);
 
@@ -311,6 +448,13 @@ AbstractGraphicsApi::CommandBuffer* VulkanApi::createCommandBuffer(AbstractGraph
   return new Detail::VCommandBuffer(*dx);
   }
 
+AbstractGraphicsApi::CommandBuffer* VulkanApi::createCommandBundle(AbstractGraphicsApi::Device* d, FboLayout* lay,
+                                                                   uint32_t width, uint32_t height) {
+  Detail::VDevice*            dx=reinterpret_cast<Detail::VDevice*>(d);
+  Detail::VFramebufferLayout* lx=reinterpret_cast<Detail::VFramebufferLayout*>(lay);
+  return new Detail::VCommandBuffer(*dx,*lx,width,height);
+  }
+
 void VulkanApi::present(Device *d,Swapchain *sw,uint32_t imageId,const Semaphore *wait) {
   Detail::VDevice*    dx=reinterpret_cast<Detail::VDevice*>(d);
   Detail::VSwapchain* sx=reinterpret_cast<Detail::VSwapchain*>(sw);
@@ -327,7 +471,7 @@ void VulkanApi::present(Device *d,Swapchain *sw,uint32_t imageId,const Semaphore
   presentInfo.pSwapchains     = swapChains;
   presentInfo.pImageIndices   = &imageId;
 
-  dx->waitData();
+  dx->flushData();
 
   VkResult code = dx->presentQueue->present(presentInfo);
   if(code==VK_ERROR_OUT_OF_DATE_KHR || code==VK_SUBOPTIMAL_KHR) {
@@ -369,7 +513,7 @@ void VulkanApi::submit(Device *d,
   if(onReadyCpu!=nullptr)
     onReadyCpu->reset();
 
-  dx->waitData();
+  dx->flushData();
   dx->graphicsQueue->submit(1,&submitInfo,rc==nullptr ? VK_NULL_HANDLE : rc->impl);
   }
 
@@ -419,7 +563,7 @@ void VulkanApi::submit(AbstractGraphicsApi::Device *d,
     doneCpu->reset();
   auto* rc=reinterpret_cast<Detail::VFence*>(doneCpu);
 
-  dx->waitData();
+  dx->flushData();
   dx->graphicsQueue->submit(1,&submitInfo,rc==nullptr ? VK_NULL_HANDLE : rc->impl);
   }
 
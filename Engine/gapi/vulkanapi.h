@@ -33,9 +33,10 @@ class VulkanApi : public AbstractGraphicsApi {
 
     PPipeline      createPipeline(Device* d, const RenderState &st,
                                   const Tempest::Decl::ComponentType *decl, size_t declSize,
-                                  size_t stride, Topology tp,
+                                  size_t stride, size_t instDeclSize, size_t instStride, Topology tp,
                                   const UniformsLay& ulayImpl,
                                   const std::initializer_list<Shader*>& shaders) override;
+    PCompPipeline  createComputePipeline(Device* d, const UniformsLay& ulayImpl, Shader* shader) override;
 
     PShader        createShader(AbstractGraphicsApi::Device *d, const void* source, size_t src_size) override;
 
@@ -47,14 +48,19 @@ class VulkanApi : public AbstractGraphicsApi {
     Semaphore*     createSemaphore(Device *d) override;
 
     PBuffer        createBuffer(Device* d, const void *mem, size_t count, size_t size, size_t alignedSz, MemUsage usage, BufferHeap flg) override;
+    PBuffer        createMappedBuffer(Device* d, size_t size, MemUsage usage, void*& mapped) override;
     PTexture       createTexture(Device* d,const Pixmap& p,TextureFormat frm,uint32_t mips) override;
-    PTexture       createTexture(Device* d,const uint32_t w,const uint32_t h,uint32_t mips, TextureFormat frm) override;
+    PTexture       createTexture(Device* d,const uint32_t w,const uint32_t h,uint32_t mips, TextureFormat frm, bool storage) override;
 
-    void           readPixels(AbstractGraphicsApi::Device *d, Pixmap &out, const PTexture t,
+    Readback*      readPixels(AbstractGraphicsApi::Device *d, const PTexture t,
                               TextureLayout lay, TextureFormat frm,
-                              const uint32_t w, const uint32_t h, uint32_t mip) override;
+                              const Rect& r, uint32_t mip) override;
+    void           readBytes(Device* d, Buffer* buf, void* out, size_t size) override;
+    void           updateTexture(AbstractGraphicsApi::Device *d, PTexture t, const Pixmap& p, TextureFormat frm,
+                                 const Rect* rect, size_t count) override;
 
     CommandBuffer* createCommandBuffer(Device* d) override;
+    CommandBuffer* createCommandBundle(Device* d, FboLayout* lay, uint32_t width, uint32_t height) override;
 
     void           present  (Device *d,Swapchain* sw,uint32_t imageId, const Semaphore *wait) override;
 
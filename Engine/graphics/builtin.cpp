@@ -22,32 +22,57 @@ Builtin::Builtin(Device& owner)
 
   vsT2 = owner.shader(tex_brush_vert_sprv,sizeof(tex_brush_vert_sprv));
   fsT2 = owner.shader(tex_brush_frag_sprv,sizeof(tex_brush_frag_sprv));
+
+  vsEP  = owner.shader(empty_packed_vert_sprv,sizeof(empty_packed_vert_sprv));
+  vsT2P = owner.shader(tex_brush_packed_vert_sprv,sizeof(tex_brush_packed_vert_sprv));
+
+  fsSdf = owner.shader(sdf_brush_frag_sprv,sizeof(sdf_brush_frag_sprv));
   }
 
-const Builtin::Item &Builtin::texture2d() const {
-  if(brushT2.brush.isEmpty()) {
-    brushT2.pen    = owner.pipeline<PaintDevice::Point>(Lines,    stNormal,vsT2,fsT2);
-    brushT2.brush  = owner.pipeline<PaintDevice::Point>(Triangles,stNormal,vsT2,fsT2);
+template<class Vertex>
+void Builtin::initItem(Item& it, const Shader& vs, const Shader& fs) const {
+  it.pen    = owner.pipeline<Vertex>(Lines,    stNormal,vs,fs);
+  it.brush  = owner.pipeline<Vertex>(Triangles,stNormal,vs,fs);
 
-    brushT2.penB   = owner.pipeline<PaintDevice::Point>(Lines,    stBlend,vsT2,fsT2);
-    brushT2.brushB = owner.pipeline<PaintDevice::Point>(Triangles,stBlend,vsT2,fsT2);
+  it.penB   = owner.pipeline<Vertex>(Lines,    stBlend,vs,fs);
+  it.brushB = owner.pipeline<Vertex>(Triangles,stBlend,vs,fs);
 
-    brushT2.penA   = owner.pipeline<PaintDevice::Point>(Lines,    stAlpha,vsT2,fsT2);
-    brushT2.brushA = owner.pipeline<PaintDevice::Point>(Triangles,stAlpha,vsT2,fsT2);
-    }
+  it.penA   = owner.pipeline<Vertex>(Lines,    stAlpha,vs,fs);
+  it.brushA = owner.pipeline<Vertex>(Triangles,stAlpha,vs,fs);
+  }
+
+const Builtin::Item &Builtin::texture2d() const {
+  if(brushT2.brush.isEmpty())
+    initItem<PaintDevice::Point>(brushT2,vsT2,fsT2);
   return brushT2;
   }
 
 const Builtin::Item &Builtin::empty() const {
-  if(brushE.brush.isEmpty()) {
-    brushE.pen   = owner.pipeline<PaintDevice::Point>(Lines,    stNormal,vsE,fsE);
-    brushE.brush = owner.pipeline<PaintDevice::Point>(Triangles,stNormal,vsE,fsE);
+  if(brushE.brush.isEmpty())
+    initItem<PaintDevice::Point>(brushE,vsE,fsE);
+  return brushE;
+  }
 
-    brushE.penB   = owner.pipeline<PaintDevice::Point>(Lines,    stBlend,vsE,fsE);
-    brushE.brushB = owner.pipeline<PaintDevice::Point>(Triangles,stBlend,vsE,fsE);
+const Builtin::Item &Builtin::texture2dPacked() const {
+  if(brushT2P.brush.isEmpty())
+    initItem<PaintDevice::PointPacked>(brushT2P,vsT2P,fsT2);
+  return brushT2P;
+  }
 
-    brushE.penA   = owner.pipeline<PaintDevice::Point>(Lines,    stAlpha,vsE,fsE);
-    brushE.brushA = owner.pipeline<PaintDevice::Point>(Triangles,stAlpha,vsE,fsE);
-    }
-  return brushE;
+const Builtin::Item &Builtin::emptyPacked() const {
+  if(brushEP.brush.isEmpty())
+    initItem<PaintDevice::PointPacked>(brushEP,vsEP,fsE);
+  return brushEP;
+  }
+
+const Builtin::Item &Builtin::sdf() const {
+  if(brushSdf.brush.isEmpty())
+    initItem<PaintDevice::Point>(brushSdf,vsT2,fsSdf);
+  return brushSdf;
+  }
+
+const Builtin::Item &Builtin::sdfPacked() const {
+  if(brushSdfP.brush.isEmpty())
+    initItem<PaintDevice::PointPacked>(brushSdfP,vsT2P,fsSdf);
+  return brushSdfP;
   }
@@ -29,13 +29,30 @@ class Builtin final {
     const Item& texture2d() const;
     const Item& empty    () const;
 
+    // pipelines for PaintDevice::PointPacked vertices
+    const Item& texture2dPacked() const;
+    const Item& emptyPacked    () const;
+
+    // distance field glyphs
+    const Item& sdf      () const;
+    const Item& sdfPacked() const;
+
   private:
     mutable Item            brushT2;
     mutable Item            brushE;
+    mutable Item            brushT2P;
+    mutable Item            brushEP;
+    mutable Item            brushSdf;
+    mutable Item            brushSdfP;
 
     RenderState             stNormal, stBlend, stAlpha;
     Device&                 owner;
     Tempest::Shader         vsT2,fsT2,vsE,fsE;
+    Tempest::Shader         vsT2P,vsEP;
+    Tempest::Shader         fsSdf;
+
+    template<class Vertex>
+    void initItem(Item& it, const Shader& vs, const Shader& fs) const;
 
   friend class Device;
   };
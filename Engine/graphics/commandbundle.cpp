@@ -0,0 +1,26 @@
+#include "commandbundle.h"
+
+#include <Tempest/Device>
+#include <Tempest/Encoder>
+#include <Tempest/Except>
+
+using namespace Tempest;
+
+CommandBundle::CommandBundle(Device& dev, AbstractGraphicsApi::CommandBuffer* impl,
+                             const FrameBufferLayout& lay, uint32_t w, uint32_t h)
+  :dev(&dev),impl(impl),lay(lay),w(w),h(h) {
+  }
+
+CommandBundle::~CommandBundle() {
+  delete impl.handler;
+  }
+
+Encoder<CommandBundle> CommandBundle::startEncoding(Device& device) {
+  if(impl.handler!=nullptr && impl.handler->isRecording())
+    throw ConcurentRecordingException();
+  if(impl.handler==nullptr)
+    throw IncompatibleBundleException();
+  if(dev!=&device)
+    *this = device.commandBundle(lay,w,h);
+  return Encoder<CommandBundle>(this);
+  }
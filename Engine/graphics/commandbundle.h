@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+#include <Tempest/Encoder>
+#include <Tempest/FrameBuffer>
+#include "../utility/dptr.h"
+
+namespace Tempest {
+
+class Device;
+
+template<class T>
+class Encoder;
+
+// secondary command buffer, executed inside of render pass by Encoder<CommandBuffer>::execute;
+// each bundle has own command pool, so bundles can be recorded on worker threads in parallel
+class CommandBundle final {
+  public:
+    CommandBundle()=default;
+    CommandBundle(CommandBundle&& f)=default;
+    ~CommandBundle();
+    CommandBundle& operator = (CommandBundle&& other)=default;
+
+    auto startEncoding(Tempest::Device& dev) -> Encoder<CommandBundle>;
+    auto layout() const -> const FrameBufferLayout& { return lay; }
+
+  private:
+    CommandBundle(Tempest::Device& dev, AbstractGraphicsApi::CommandBuffer* impl,
+                  const FrameBufferLayout& lay, uint32_t w, uint32_t h);
+
+    Tempest::Device*                                    dev=nullptr;
+    Detail::DPtr<AbstractGraphicsApi::CommandBuffer*>   impl;
+    FrameBufferLayout                                   lay;
+    uint32_t                                            w=0, h=0;
+
+  friend class Tempest::Device;
+  friend class Tempest::Encoder<CommandBuffer>;
+  friend class Tempest::Encoder<CommandBundle>;
+  };
+
+}
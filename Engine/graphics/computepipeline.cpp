@@ -0,0 +1,21 @@
+#include "computepipeline.h"
+
+#include <Tempest/Device>
+
+using namespace Tempest;
+
+ComputePipeline::ComputePipeline(Device& dev,
+                                 Detail::DSharedPtr<AbstractGraphicsApi::CompPipeline*>&& p,
+                                 Detail::DSharedPtr<AbstractGraphicsApi::UniformsLay*>&&  ulay)
+  :dev(&dev), ulay(std::move(ulay)), impl(std::move(p)) {
+  }
+
+ComputePipeline::~ComputePipeline() {
+  }
+
+ComputePipeline& ComputePipeline::operator =(ComputePipeline&& other) {
+  ulay = std::move(other.ulay);
+  impl = std::move(other.impl);
+  std::swap(dev,other.dev);
+  return *this;
+  }
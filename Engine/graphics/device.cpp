@@ -5,9 +5,12 @@
 #include <Tempest/UniformsLayout>
 #include <Tempest/UniformBuffer>
 #include <Tempest/File>
+#include <Tempest/IDevice>
+#include <Tempest/ODevice>
 #include <Tempest/Pixmap>
 #include <Tempest/Except>
 
+#include <algorithm>
 #include <mutex>
 
 using namespace Tempest;
@@ -169,18 +172,24 @@ const Device::Props& Device::properties() const {
   return devProps;
   }
 
-Attachment Device::attachment(TextureFormat frm, const uint32_t w, const uint32_t h, const bool mips) {
+Device::MemoryStats Device::memoryStats() {
+  return dev->memoryStats();
+  }
+
+Attachment Device::attachment(TextureFormat frm, const uint32_t w, const uint32_t h, const bool mips, const bool storage) {
   if(!devProps.hasSamplerFormat(frm) && !devProps.hasAttachFormat(frm))
     throw std::system_error(Tempest::GraphicsErrc::UnsupportedTextureFormat);
+  if(storage && !devProps.hasStorageFormat(frm))
+    throw std::system_error(Tempest::GraphicsErrc::UnsupportedTextureFormat);
   uint32_t mipCnt = mips ? mipCount(w,h) : 1;
-  Texture2d t(*this,api.createTexture(dev,w,h,mipCnt,frm),w,h,frm);
+  Texture2d t(*this,api.createTexture(dev,w,h,mipCnt,frm,storage),w,h,frm);
   return Attachment(std::move(t));
   }
 
 ZBuffer Device::zbuffer(TextureFormat frm, const uint32_t w, const uint32_t h) {
   if(!devProps.hasDepthFormat(frm))
     throw std::system_error(Tempest::GraphicsErrc::UnsupportedTextureFormat);
-  Texture2d t(*this,api.createTexture(dev,w,h,1,frm),w,h,frm);
+  Texture2d t(*this,api.createTexture(dev,w,h,1,frm,false),w,h,frm);
   return ZBuffer(std::move(t),devProps.hasSamplerFormat(frm));
   }
 
@@ -210,17 +219,62 @@ Texture2d Device::loadTexture(const Pixmap &pm, bool mips) {
   return t;
   }
 
+Texture2d Device::loadTexture(const Pixmap& pm, UploadToken& ready, bool mips) {
+  Texture2d t = loadTexture(pm,mips);
+  ready = UploadToken(dev,t.impl.handler->ticket);
+  return t;
+  }
+
+void Device::updateTexture(Texture2d& t, const Pixmap& pm, const Rect* rect, size_t count) {
+  if(count==0)
+    return;
+  if(t.isEmpty() || toTextureFormat(pm.format())!=t.format())
+    throw std::system_error(Tempest::GraphicsErrc::UnsupportedTextureFormat);
+  if(int(pm.w())!=t.w() || int(pm.h())!=t.h())
+    throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+  // compressed textures are updated by whole 4x4 blocks
+  const int blk = isCompressedFormat(t.format()) ? 3 : 0;
+  for(size_t i=0;i<count;++i) {
+    const Rect& r = rect[i];
+    if(r.x<0 || r.y<0 || r.w<0 || r.h<0 || r.x+r.w>t.w() || r.y+r.h>t.h())
+      throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+    if((r.x&blk)!=0 || (r.y&blk)!=0 || ((r.w&blk)!=0 && r.x+r.w!=t.w()) || ((r.h&blk)!=0 && r.y+r.h!=t.h()))
+      throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+    }
+  api.updateTexture(dev,t.impl,pm,t.format(),rect,count);
+  }
+
 Pixmap Device::readPixels(const Texture2d &t) {
-  Pixmap pm;
-  api.readPixels(dev,pm,t.impl,TextureLayout::Sampler,t.format(),uint32_t(t.w()),uint32_t(t.h()),0);
-  return pm;
+  return implReadPixels(t,nullptr,0).get();
   }
 
 Pixmap Device::readPixels(const Attachment& t) {
-  Pixmap pm;
-  auto& tx = textureCast(t);
-  api.readPixels(dev,pm,tx.impl,TextureLayout::Sampler,tx.format(),uint32_t(t.w()),uint32_t(t.h()),0);
-  return pm;
+  return implReadPixels(textureCast(t),nullptr,0).get();
+  }
+
+Readback Device::readPixelsAsync(const Texture2d& t, uint32_t mip) {
+  return implReadPixels(t,nullptr,mip);
+  }
+
+Readback Device::readPixelsAsync(const Texture2d& t, const Rect& r, uint32_t mip) {
+  return implReadPixels(t,&r,mip);
+  }
+
+Readback Device::readPixelsAsync(const Attachment& t, uint32_t mip) {
+  return implReadPixels(textureCast(t),nullptr,mip);
+  }
+
+Readback Device::readPixelsAsync(const Attachment& t, const Rect& r, uint32_t mip) {
+  return implReadPixels(textureCast(t),&r,mip);
+  }
+
+Readback Device::implReadPixels(const Texture2d& t, const Rect* r, uint32_t mip) {
+  const int w = std::max(1,t.w()>>mip);
+  const int h = std::max(1,t.h()>>mip);
+  Rect      rect = r!=nullptr ? *r : Rect(0,0,w,h);
+  if(rect.x<0 || rect.y<0 || rect.w<=0 || rect.h<=0 || rect.x+rect.w>w || rect.y+rect.h>h)
+    throw std::system_error(Tempest::GraphicsErrc::InvalidTexture);
+  return Readback(api.readPixels(dev,t.impl,TextureLayout::Sampler,t.format(),rect,mip));
   }
 
 TextureFormat Device::formatOf(const Attachment& a) {
@@ -298,25 +352,70 @@ RenderPipeline Device::implPipeline(const RenderState &st,
                                     const Decl::ComponentType *decl, size_t declSize,
                                     size_t   stride,
                                     Topology tp) {
+  return implPipeline(st,vs,fs,decl,declSize,stride,nullptr,0,0,tp);
+  }
+
+RenderPipeline Device::implPipeline(const RenderState& st,
+                                    const Shader& vs, const Shader& fs,
+                                    const Decl::ComponentType* decl, size_t declSize, size_t stride,
+                                    const Decl::ComponentType* inst, size_t instSize, size_t instStride,
+                                    Topology tp) {
   if(!vs.impl || !fs.impl)
     return RenderPipeline();
 
+  std::vector<Decl::ComponentType> all(declSize+instSize);
+  std::copy(decl,decl+declSize,all.begin());
+  if(instSize>0)
+    std::copy(inst,inst+instSize,all.begin()+std::ptrdiff_t(declSize));
+
   std::initializer_list<AbstractGraphicsApi::Shader*> sh = {vs.impl.handler,fs.impl.handler};
   auto ulay = api.createUboLayout(dev,sh);
-  auto pipe = api.createPipeline(dev,st,decl,declSize,stride,tp,*ulay.handler,sh);
+  auto pipe = api.createPipeline(dev,st,all.data(),declSize,stride,instSize,instStride,tp,*ulay.handler,sh);
   RenderPipeline f(*this,std::move(pipe),std::move(ulay));
   return f;
   }
 
+ComputePipeline Device::computePipeline(const Shader& comp) {
+  if(!comp.impl)
+    return ComputePipeline();
+
+  std::initializer_list<AbstractGraphicsApi::Shader*> sh = {comp.impl.handler};
+  auto ulay = api.createUboLayout(dev,sh);
+  auto pipe = api.createComputePipeline(dev,*ulay.handler,comp.impl.handler);
+  ComputePipeline f(*this,std::move(pipe),std::move(ulay));
+  return f;
+  }
+
 CommandBuffer Device::commandBuffer() {
   CommandBuffer buf(*this,api.createCommandBuffer(dev));
   return buf;
   }
 
+CommandBundle Device::commandBundle(const FrameBufferLayout& lay, uint32_t w, uint32_t h) {
+  CommandBundle buf(*this,api.createCommandBundle(dev,lay.impl.handler,w,h),lay,w,h);
+  return buf;
+  }
+
+CommandBundle Device::commandBundle(const FrameBuffer& fbo) {
+  return commandBundle(fbo.layout(),fbo.w(),fbo.h());
+  }
+
 const Builtin& Device::builtin() const {
   return builtins;
   }
 
+void Device::savePipelineCache(ODevice& out) {
+  std::vector<uint8_t> data;
+  dev->savePipelineCache(data);
+  out.write(data.data(),data.size());
+  }
+
+bool Device::loadPipelineCache(IDevice& in) {
+  std::vector<uint8_t> data(in.size());
+  data.resize(in.read(data.data(),data.size()));
+  return dev->loadPipelineCache(data.data(),data.size());
+  }
+
 const char* Device::renderer() const {
   return dev->renderer();
   }
@@ -326,6 +425,21 @@ VideoBuffer Device::createVideoBuffer(const void *data, size_t count, size_t siz
   return  buf;
   }
 
+VideoBuffer Device::createMappedBuffer(size_t size, MemUsage usage, void*& mapped) {
+  VideoBuffer buf(*this,api.createMappedBuffer(dev,size,usage,mapped),size);
+  return  buf;
+  }
+
+TransientBuffer Device::transientBuffer(size_t frameSize) {
+  return TransientBuffer(*this,frameSize,impl.maxFramesInFlight);
+  }
+
+void Device::implReadBytes(const VideoBuffer& buf, void* out, size_t size) {
+  if(size==0)
+    return;
+  api.readBytes(dev,buf.impl.handler,out,size);
+  }
+
 Uniforms Device::uniforms(const UniformsLayout &ulay) {
   Uniforms ubo(*this,api.createDescriptors(dev,*ulay.impl.handler));
   return ubo;
@@ -2,9 +2,11 @@
 
 #include <Tempest/AbstractGraphicsApi>
 #include <Tempest/CommandBuffer>
+#include <Tempest/CommandBundle>
 #include <Tempest/RenderPass>
 #include <Tempest/FrameBuffer>
 #include <Tempest/RenderPipeline>
+#include <Tempest/ComputePipeline>
 #include <Tempest/Shader>
 #include <Tempest/Attachment>
 #include <Tempest/ZBuffer>
@@ -15,11 +17,17 @@
 #include <Tempest/Builtin>
 #include <Tempest/Swapchain>
 #include <Tempest/UniformBuffer>
+#include <Tempest/StorageBuffer>
+#include <Tempest/IndirectBuffer>
+#include <Tempest/TransientBuffer>
+#include <Tempest/UploadToken>
+#include <Tempest/Readback>
 #include <Tempest/Except>
 
 #include "videobuffer.h"
 
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace Tempest {
@@ -29,6 +37,8 @@ class Semaphore;
 
 class CommandPool;
 class RFile;
+class IDevice;
+class ODevice;
 
 class VideoBuffer;
 class Pixmap;
@@ -42,6 +52,7 @@ class RenderState;
 class Device {
   public:
     using Props=AbstractGraphicsApi::Props;
+    using MemoryStats=AbstractGraphicsApi::MemoryStats;
 
     Device(AbstractGraphicsApi& api, uint8_t maxFramesInFlight=2);
     Device(AbstractGraphicsApi& api, const char* name, uint8_t maxFramesInFlight=2);
@@ -68,6 +79,9 @@ class Device {
     Shader               shader    (const void* source, const size_t length);
 
     const Props&         properties() const;
+    // per-heap totals and live allocations; see MemoryStats::toJson
+    // allocations, that are still alive, when device is destroyed, are reported to Log::e as leaks
+    MemoryStats          memoryStats();
 
     template<class T>
     VertexBuffer<T>      vbo(const T* arr,size_t arrSize);
@@ -99,13 +113,43 @@ class Device {
     template<class T>
     UniformBuffer<T>     ubo(const T& data);
 
+    template<class T>
+    StorageBuffer<T>     ssbo(const T* data, size_t size);
+
+    template<class T>
+    StorageBuffer<T>     ssbo(const std::vector<T>& arr){
+      return ssbo(arr.data(),arr.size());
+      }
+
+    // T is DrawIndirectCommand or DrawIndexedIndirectCommand
+    template<class T>
+    IndirectBuffer<T>    indirectBuffer(const T* data, size_t size);
+
+    template<class T>
+    IndirectBuffer<T>    indirectBuffer(const std::vector<T>& arr){
+      return indirectBuffer(arr.data(),arr.size());
+      }
+
+    // blocking; waits for device idle first, so every submitted write to the buffer is visible
+    template<class T>
+    std::vector<T>       readBytes(const StorageBuffer<T>& ssbo);
+
     Uniforms             uniforms(const UniformsLayout &owner);
+    // per-frame vertex, index and uniform data; frameSize is initial size of each frame in bytes
+    TransientBuffer      transientBuffer(size_t frameSize);
 
-    Attachment           attachment (TextureFormat frm, const uint32_t w, const uint32_t h, const bool mips = false);
+    // storage: attachment can be bound as image2D in compute shader; may disable framebuffer compression
+    Attachment           attachment (TextureFormat frm, const uint32_t w, const uint32_t h, const bool mips = false, const bool storage = false);
     ZBuffer              zbuffer    (TextureFormat frm, const uint32_t w, const uint32_t h);
     Texture2d            loadTexture(const Pixmap& pm,bool mips=true);
+    Texture2d            loadTexture(const Pixmap& pm,UploadToken& ready,bool mips=true);
+    void                 updateTexture(Texture2d& t, const Pixmap& pm, const Rect* rect, size_t count);
     Pixmap               readPixels (const Texture2d&  t);
     Pixmap               readPixels (const Attachment& t);
+    Readback             readPixelsAsync(const Texture2d&  t, uint32_t mip=0);
+    Readback             readPixelsAsync(const Texture2d&  t, const Rect& r, uint32_t mip=0);
+    Readback             readPixelsAsync(const Attachment& t, uint32_t mip=0);
+    Readback             readPixelsAsync(const Attachment& t, const Rect& r, uint32_t mip=0);
 
     FrameBuffer          frameBuffer(Attachment& out);
     FrameBuffer          frameBuffer(Attachment& out, ZBuffer& zbuf);
@@ -115,15 +159,26 @@ class Device {
 
     template<class Vertex>
     RenderPipeline       pipeline(Topology tp,const RenderState& st, const Shader &vs,const Shader &fs);
+    // Instance attributes follow Vertex attributes in shader locations and advance once per instance
+    template<class Vertex,class Instance>
+    RenderPipeline       pipeline(Topology tp,const RenderState& st, const Shader &vs,const Shader &fs);
+    ComputePipeline      computePipeline(const Shader& comp);
 
     Fence                fence();
     Semaphore            semaphore();
 
     CommandBuffer        commandBuffer();
+    // secondary commands for render pass with layout lay; w and h are dimensions of viewport
+    // throws GraphicsErrc::UnsupportedFeature on DirectX12
+    CommandBundle        commandBundle(const FrameBufferLayout& lay, uint32_t w, uint32_t h);
+    CommandBundle        commandBundle(const FrameBuffer& fbo);
 
     const Builtin&       builtin() const;
     const char*          renderer() const;
 
+    void                 savePipelineCache(ODevice& out);
+    bool                 loadPipelineCache(IDevice& in);
+
   private:
     struct Impl {
       Impl(AbstractGraphicsApi& api, const char* name, uint8_t maxFramesInFlight);
@@ -141,16 +196,26 @@ class Device {
     Tempest::Builtin                builtins;
 
     VideoBuffer createVideoBuffer(const void* data, size_t count, size_t size, size_t alignedSz, MemUsage usage, BufferHeap flg);
+    VideoBuffer createMappedBuffer(size_t size, MemUsage usage, void*& mapped);
     RenderPipeline
                 implPipeline(const RenderState &st,
                              const Shader &vs, const Shader &fs,
                              const Decl::ComponentType *decl, size_t declSize,
                              size_t stride, Topology tp);
+    RenderPipeline
+                implPipeline(const RenderState &st,
+                             const Shader &vs, const Shader &fs,
+                             const Decl::ComponentType *decl, size_t declSize, size_t stride,
+                             const Decl::ComponentType *inst, size_t instSize, size_t instStride,
+                             Topology tp);
     void        implSubmit(const Tempest::CommandBuffer *cmd[], AbstractGraphicsApi::CommandBuffer* hcmd[],  size_t count,
                            const Semaphore* wait[], AbstractGraphicsApi::Semaphore*     hwait[], size_t waitCnt,
                            Semaphore*       done[], AbstractGraphicsApi::Semaphore*     hdone[], size_t doneCnt,
                            AbstractGraphicsApi::Fence*         fdone);
 
+    Readback    implReadPixels(const Texture2d& t, const Rect* r, uint32_t mip);
+    void        implReadBytes (const VideoBuffer& buf, void* out, size_t size);
+
     static TextureFormat formatOf(const Attachment& a);
 
   friend class RenderPipeline;
@@ -162,6 +227,7 @@ class Device {
   friend class CommandBuffer;
   friend class VideoBuffer;
   friend class Uniforms;
+  friend class TransientBuffer;
 
   template<class T>
   friend class VertexBuffer;
@@ -217,11 +283,48 @@ inline UniformBuffer<T> Device::ubo(const T& mem) {
   return ubo(&mem,1);
   }
 
+template<class T>
+inline StorageBuffer<T> Device::ssbo(const T* arr, size_t arrSize) {
+  if(arrSize==0)
+    return StorageBuffer<T>();
+  VideoBuffer      data=createVideoBuffer(arr,arrSize,sizeof(T),sizeof(T),MemUsage::StorageBuffer|MemUsage::TransferSrc,BufferHeap::Static);
+  StorageBuffer<T> ssbo(std::move(data),arrSize);
+  return ssbo;
+  }
+
+template<class T>
+inline IndirectBuffer<T> Device::indirectBuffer(const T* arr, size_t arrSize) {
+  static_assert(std::is_same<T,DrawIndirectCommand>::value || std::is_same<T,DrawIndexedIndirectCommand>::value,
+                "T must be DrawIndirectCommand or DrawIndexedIndirectCommand");
+  if(arrSize==0)
+    return IndirectBuffer<T>();
+  VideoBuffer       data=createVideoBuffer(arr,arrSize,sizeof(T),sizeof(T),MemUsage::Indirect|MemUsage::StorageBuffer|MemUsage::TransferSrc,BufferHeap::Static);
+  IndirectBuffer<T> ind(std::move(data),arrSize);
+  return ind;
+  }
+
+template<class T>
+inline std::vector<T> Device::readBytes(const StorageBuffer<T>& ssbo) {
+  std::vector<T> ret(ssbo.size());
+  implReadBytes(ssbo.impl,ret.data(),ret.size()*sizeof(T));
+  return ret;
+  }
+
 template<class Vertex>
 RenderPipeline Device::pipeline(Topology tp, const RenderState &st, const Shader &vs, const Shader &fs) {
   static const auto decl=Tempest::vertexBufferDecl<Vertex>();
   return implPipeline(st,vs,fs,decl.data.data(),decl.data.size(),sizeof(Vertex),tp);
   }
 
+template<class Vertex,class Instance>
+RenderPipeline Device::pipeline(Topology tp, const RenderState &st, const Shader &vs, const Shader &fs) {
+  static const auto decl=Tempest::vertexBufferDecl<Vertex>();
+  static const auto inst=Tempest::vertexBufferDecl<Instance>();
+  return implPipeline(st,vs,fs,
+                      decl.data.data(),decl.data.size(),sizeof(Vertex),
+                      inst.data.data(),inst.data.size(),sizeof(Instance),
+                      tp);
+  }
+
 }
 
@@ -4,6 +4,8 @@
 #include <Tempest/FrameBuffer>
 #include <Tempest/RenderPass>
 #include <Tempest/Texture2d>
+#include <Tempest/CommandBundle>
+#include <Tempest/Except>
 
 using namespace Tempest;
 
@@ -15,16 +17,28 @@ Encoder<Tempest::CommandBuffer>::Encoder(Tempest::CommandBuffer* ow)
   impl->begin();
   }
 
+Encoder<Tempest::CommandBuffer>::Encoder(Tempest::CommandBundle* ow)
+  :impl(ow->impl.handler) {
+  state.vp.width  = ow->w;
+  state.vp.height = ow->h;
+  // bundle is recorded inside of render pass, that is started by primary buffer
+  curPass.mode    = Inline;
+
+  impl->begin();
+  }
+
 Encoder<CommandBuffer>::Encoder(Encoder<CommandBuffer> &&e)
-  :owner(e.owner),impl(e.impl),state(std::move(e.state)) {
+  :owner(e.owner),impl(e.impl),state(std::move(e.state)),curPass(e.curPass),bindStats(e.bindStats) {
   e.owner = nullptr;
   e.impl  = nullptr;
   }
 
 Encoder<CommandBuffer> &Encoder<CommandBuffer>::operator =(Encoder<CommandBuffer> &&e) {
-  owner = e.owner;
-  impl  = e.impl;
-  state = std::move(e.state);
+  owner   = e.owner;
+  impl    = e.impl;
+  state   = std::move(e.state);
+  curPass   = e.curPass;
+  bindStats = e.bindStats;
 
   e.owner = nullptr;
   e.impl  = nullptr;
@@ -35,17 +49,34 @@ Encoder<CommandBuffer> &Encoder<CommandBuffer>::operator =(Encoder<CommandBuffer
 Encoder<Tempest::CommandBuffer>::~Encoder() noexcept(false) {
   if(impl==nullptr)
     return;
+  implEndRenderPass();
   impl->end();
   }
 
+const Encoder<Tempest::CommandBuffer>::Stats& Encoder<Tempest::CommandBuffer>::stats() const {
+  return bindStats;
+  }
+
 void Encoder<Tempest::CommandBuffer>::setViewport(int x, int y, int w, int h) {
+  implBeginRenderPass(Inline);
   impl->setViewport(Rect(x,y,w,h));
   }
 
 void Encoder<Tempest::CommandBuffer>::setViewport(const Rect &vp) {
+  implBeginRenderPass(Inline);
   impl->setViewport(vp);
   }
 
+void Encoder<Tempest::CommandBuffer>::setScissor(int x, int y, int w, int h) {
+  implBeginRenderPass(Inline);
+  impl->setScissor(Rect(x,y,w,h));
+  }
+
+void Encoder<Tempest::CommandBuffer>::setScissor(const Rect &vp) {
+  implBeginRenderPass(Inline);
+  impl->setScissor(vp);
+  }
+
 void Tempest::Encoder<Tempest::CommandBuffer>::setUniforms(const Tempest::RenderPipeline& p, const void* data, size_t sz) {
   setUniforms(p);
   impl->setBytes(*p.impl.handler,data,sz);
@@ -53,55 +84,169 @@ void Tempest::Encoder<Tempest::CommandBuffer>::setUniforms(const Tempest::Render
 
 void Encoder<Tempest::CommandBuffer>::setUniforms(const Tempest::RenderPipeline& p,const Uniforms &ubo) {
   setUniforms(p);
-  impl->setUniforms(*p.impl.handler,*ubo.desc.handler);
+  implSetUniforms(*p.impl.handler,*ubo.desc.handler,0);
+  }
+
+void Encoder<Tempest::CommandBuffer>::setUniforms(const RenderPipeline& p, const Uniforms& ubo, uint32_t offset) {
+  setUniforms(p);
+  implSetUniforms(*p.impl.handler,*ubo.desc.handler,offset);
   }
 
 void Encoder<Tempest::CommandBuffer>::setUniforms(const Detail::ResourcePtr<RenderPipeline> &p, const Uniforms &ubo) {
   setUniforms(p);
-  impl->setUniforms(*p.impl.handler,*ubo.desc.handler);
+  implSetUniforms(*p.impl.handler,*ubo.desc.handler,0);
   }
 
 void Encoder<Tempest::CommandBuffer>::setUniforms(const Detail::ResourcePtr<RenderPipeline> &p) {
-  if(state.curPipeline!=p.impl.handler) {
-    impl->setPipeline(*p.impl.handler,state.vp.width,state.vp.height);
-    state.curPipeline=p.impl.handler;
-    }
+  implSetPipeline(*p.impl.handler);
   }
+
 void Encoder<Tempest::CommandBuffer>::setUniforms(const RenderPipeline &p) {
-  if(state.curPipeline!=p.impl.handler) {
-    impl->setPipeline(*p.impl.handler,state.vp.width,state.vp.height);
-    state.curPipeline=p.impl.handler;
+  implSetPipeline(*p.impl.handler);
+  }
+
+void Encoder<Tempest::CommandBuffer>::setUniforms(const ComputePipeline& p) {
+  // compute state is bound outside of render pass; pending pass is started by draw or ended by dispatch
+  if(state.curCompute==p.impl.handler) {
+    bindStats.redundantBinds++;
+    return;
+    }
+  impl->setComputePipeline(*p.impl.handler);
+  state.curCompute      = p.impl.handler;
+  state.curCompUniforms = nullptr;
+  bindStats.pipelineBinds++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::setUniforms(const ComputePipeline& p, const void* data, size_t sz) {
+  setUniforms(p);
+  impl->setBytes(*p.impl.handler,data,sz);
+  }
+
+void Encoder<Tempest::CommandBuffer>::setUniforms(const ComputePipeline& p, const Uniforms& ubo) {
+  setUniforms(p);
+  if(state.curCompUniforms==ubo.desc.handler) {
+    bindStats.redundantBinds++;
+    return;
+    }
+  impl->setUniforms(*p.impl.handler,*ubo.desc.handler);
+  state.curCompUniforms = ubo.desc.handler;
+  bindStats.uniformBinds++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::implSetPipeline(AbstractGraphicsApi::Pipeline& p) {
+  implBeginRenderPass(Inline);
+  if(state.curPipeline==&p) {
+    bindStats.redundantBinds++;
+    return;
     }
+  impl->setPipeline(p);
+  state.curPipeline = &p;
+  // layout of new pipeline can be incompatible with bound descriptor set
+  state.curUniforms = nullptr;
+  bindStats.pipelineBinds++;
   }
 
-void Encoder<Tempest::CommandBuffer>::implDraw(const VideoBuffer& vbo, size_t offset, size_t size) {
-  if(!vbo.impl)
+void Encoder<Tempest::CommandBuffer>::implSetUniforms(AbstractGraphicsApi::Pipeline& p, AbstractGraphicsApi::Desc& u, uint32_t offset) {
+  if(state.curUniforms==&u && state.curOffset==offset) {
+    bindStats.redundantBinds++;
     return;
-  if(state.curVbo!=&vbo) {
-    impl->setVbo(*vbo.impl.handler);
-    state.curVbo=&vbo;
     }
+  impl->setUniforms(p,u,&offset,1);
+  state.curUniforms = &u;
+  state.curOffset   = offset;
+  bindStats.uniformBinds++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::dispatch(size_t x, size_t y, size_t z) {
+  if(state.curCompute==nullptr)
+    throw NoComputePipelineException();
+  implEndRenderPass();
+  impl->dispatch(x,y,z);
+  }
+
+void Encoder<Tempest::CommandBuffer>::implDraw(const VideoBuffer& vbo, size_t offset, size_t size,
+                                               const VideoBuffer* inst, size_t firstInstance, size_t instanceCount) {
+  if(!vbo.impl || instanceCount==0)
+    return;
+  if(inst!=nullptr && !inst->impl)
+    return;
+  implBeginDraw();
+  implBindInstance(inst);
+  implBindVbo(vbo);
   /*
    // no need to clear vbo
   if(state.curIbo!=nullptr) {
     impl->setIbo(nullptr,Detail::IndexClass::i16);
     state.curIbo=nullptr;
     }*/
-  impl->draw(offset,size);
+  impl->draw(offset,size,firstInstance,instanceCount);
+  bindStats.drawCalls++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::implDraw(const VideoBuffer &vbo, const VideoBuffer &ibo, Detail::IndexClass index,
+                                              size_t offset, size_t size, size_t voffset,
+                                              const VideoBuffer* inst, size_t firstInstance, size_t instanceCount) {
+  if(!vbo.impl || !ibo.impl || instanceCount==0)
+    return;
+  if(inst!=nullptr && !inst->impl)
+    return;
+  implBeginDraw();
+  implBindInstance(inst);
+  implBindVbo(vbo);
+  implBindIbo(ibo,index);
+  impl->drawIndexed(offset,size,voffset,firstInstance,instanceCount);
+  bindStats.drawCalls++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::implDrawIndirect(const VideoBuffer& vbo, const VideoBuffer* ibo, Detail::IndexClass index,
+                                                      const VideoBuffer& ind, size_t first, size_t count, size_t stride) {
+  if(!vbo.impl || !ind.impl || count==0)
+    return;
+  if(ibo!=nullptr && !ibo->impl)
+    return;
+  if(first+count<first || (first+count)*stride>ind.size())
+    throw std::system_error(Tempest::GraphicsErrc::InvalidIndirectRange);
+  implBeginDraw();
+  implBindVbo(vbo);
+  bindStats.drawCalls++;
+  if(ibo==nullptr) {
+    impl->drawIndirect(*ind.impl.handler,first*stride,count,stride);
+    return;
+    }
+  implBindIbo(*ibo,index);
+  impl->drawIndexedIndirect(*ind.impl.handler,first*stride,count,stride);
+  }
+
+void Encoder<Tempest::CommandBuffer>::implBindVbo(const VideoBuffer& vbo) {
+  if(state.curVbo==&vbo) {
+    bindStats.redundantBinds++;
+    return;
+    }
+  impl->setVbo(*vbo.impl.handler);
+  state.curVbo=&vbo;
+  bindStats.bufferBinds++;
   }
 
-void Encoder<Tempest::CommandBuffer>::implDraw(const VideoBuffer &vbo, const VideoBuffer &ibo, Detail::IndexClass index, size_t offset, size_t size) {
-  if(!vbo.impl || !ibo.impl)
+void Encoder<Tempest::CommandBuffer>::implBindIbo(const VideoBuffer& ibo, Detail::IndexClass index) {
+  if(state.curIbo==&ibo) {
+    bindStats.redundantBinds++;
     return;
-  if(state.curVbo!=&vbo) {
-    impl->setVbo(*vbo.impl.handler);
-    state.curVbo=&vbo;
     }
-  if(state.curIbo!=&ibo) {
-    impl->setIbo(*ibo.impl.handler,index);
-    state.curIbo=&ibo;
+  impl->setIbo(*ibo.impl.handler,index);
+  state.curIbo=&ibo;
+  bindStats.bufferBinds++;
+  }
+
+void Encoder<Tempest::CommandBuffer>::implBindInstance(const VideoBuffer* inst) {
+  if(inst==nullptr)
+    return;
+  if(state.curInst==inst) {
+    bindStats.redundantBinds++;
+    return;
     }
-  impl->drawIndexed(offset,size,0);
+  impl->setInstanceVbo(*inst->impl.handler);
+  state.curInst=inst;
+  bindStats.bufferBinds++;
   }
 
 void Encoder<CommandBuffer>::setFramebuffer(const FrameBuffer &fbo, const RenderPass &p) {
@@ -110,14 +255,50 @@ void Encoder<CommandBuffer>::setFramebuffer(const FrameBuffer &fbo, const Render
   state.vp.width  = fbo.w();
   state.vp.height = fbo.h();
 
-  reinterpret_cast<AbstractGraphicsApi::CommandBuffer*>(impl)->beginRenderPass(fbo.impl.handler,p.impl.handler,
-                                                                               state.vp.width,state.vp.height);
   curPass.fbo  = &fbo;
   curPass.pass = &p;
+  curPass.mode = Pending;
+  }
+
+void Encoder<CommandBuffer>::execute(const CommandBundle& b) {
+  if(b.impl.handler==nullptr || curPass.fbo==nullptr || b.lay!=curPass.fbo->layout())
+    throw IncompatibleBundleException();
+  if(b.impl.handler->isRecording())
+    throw ConcurentRecordingException();
+  implBeginRenderPass(Bundles);
+  impl->execute(*b.impl.handler);
+
+  // bindings are undefined after secondary commands
+  state.curPipeline = nullptr;
+  state.curCompute  = nullptr;
+  state.curUniforms = nullptr;
+  state.curCompUniforms = nullptr;
+  state.curVbo      = nullptr;
+  state.curIbo      = nullptr;
+  state.curInst     = nullptr;
+  }
+
+void Encoder<CommandBuffer>::implBeginRenderPass(PassMode mode) {
+  if(curPass.mode==mode || curPass.mode==NoPass)
+    return;
+  if(curPass.mode!=Pending)
+    throw MixedPassContentException();
+  impl->beginRenderPass(curPass.fbo->impl.handler,curPass.pass->impl.handler,
+                        state.vp.width,state.vp.height,mode==Bundles);
+  curPass.mode = mode;
+  }
+
+void Encoder<CommandBuffer>::implBeginDraw() {
+  if(curPass.mode==NoPass)
+    throw NoRenderPassException();
+  implBeginRenderPass(Inline);
   }
 
 void Encoder<CommandBuffer>::implEndRenderPass() {
   if(curPass.pass!=nullptr) {
+    // empty pass still has to load and store attachments
+    if(curPass.mode==Pending)
+      implBeginRenderPass(Inline);
     state.curPipeline = nullptr;
     curPass           = Pass();
     reinterpret_cast<AbstractGraphicsApi::CommandBuffer*>(impl)->endRenderPass();
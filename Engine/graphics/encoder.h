@@ -2,7 +2,10 @@
 
 #include <Tempest/CommandBuffer>
 #include <Tempest/RenderPipeline>
+#include <Tempest/ComputePipeline>
 #include <Tempest/Uniforms>
+#include <Tempest/TransientBuffer>
+#include <Tempest/IndirectBuffer>
 
 #include "videobuffer.h"
 
@@ -17,6 +20,7 @@ template<class T>
 class IndexBuffer;
 
 class CommandBuffer;
+class CommandBundle;
 
 class RenderPass;
 class FrameBuffer;
@@ -31,18 +35,44 @@ class Encoder<Tempest::CommandBuffer> {
     Encoder& operator = (Encoder&& e);
     virtual ~Encoder() noexcept(false);
 
+    struct Stats {
+      size_t pipelineBinds  = 0;
+      size_t uniformBinds   = 0;
+      size_t bufferBinds    = 0; // vertex, instance and index buffers
+      size_t redundantBinds = 0; // skipped, since same state is already bound
+      size_t drawCalls      = 0;
+      };
+    auto stats() const -> const Stats&;
+
     void setFramebuffer(const FrameBuffer& fbo, const RenderPass& p);
+    // executes secondary commands in current render pass; pass can contain either bundles or inline commands
+    void execute(const CommandBundle& bundle);
 
     void setUniforms(const RenderPipeline &p);
     void setUniforms(const Tempest::RenderPipeline& p, const void* data, size_t sz);
     void setUniforms(const Tempest::RenderPipeline& p, const Uniforms &ubo);
+    // offset is index of element in first uniform buffer of ubo, bound with range of one element
+    // throws GraphicsErrc::InvalidUniformBuffer for non-zero offset, if buffer is bound with larger range
+    // or if element is out of buffer. On Vulkan every ubo binding of a layout (up to 8) is UNIFORM_BUFFER_DYNAMIC
+    void setUniforms(const Tempest::RenderPipeline& p, const Uniforms &ubo, uint32_t offset);
 
     void setUniforms(const Detail::ResourcePtr<RenderPipeline> &p, const Uniforms &ubo);
     void setUniforms(const Detail::ResourcePtr<RenderPipeline> &p);
 
+    void setUniforms(const ComputePipeline& p);
+    void setUniforms(const ComputePipeline& p, const void* data, size_t sz);
+    void setUniforms(const ComputePipeline& p, const Uniforms &ubo);
+
+    // ends current render pass; writes are visible to following draws and dispatches
+    // draws after dispatch need setFramebuffer again
+    void dispatch(size_t x, size_t y, size_t z);
+
     void setViewport(int x,int y,int w,int h);
     void setViewport(const Rect& vp);
 
+    void setScissor (int x,int y,int w,int h);
+    void setScissor (const Rect& vp);
+
     template<class T>
     void draw(const VertexBuffer<T>& vbo){ implDraw(vbo.impl,0,vbo.size()); }
 
@@ -51,14 +81,73 @@ class Encoder<Tempest::CommandBuffer> {
 
     template<class T,class I>
     void draw(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo)
-         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),0,ibo.size()); }
+         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),0,ibo.size(),0); }
 
     template<class T,class I>
     void draw(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,size_t offset,size_t count)
-         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),offset,count); }
+         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),offset,count,0); }
+
+    template<class T,class N>
+    void draw(const VertexBuffer<T>& vbo,const VertexBuffer<N>& inst,size_t instanceCount)
+         { implDraw(vbo.impl,0,vbo.size(),&inst.impl,0,instanceCount); }
+
+    template<class T,class I,class N>
+    void draw(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,const VertexBuffer<N>& inst,size_t instanceCount)
+         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),0,ibo.size(),0,&inst.impl,0,instanceCount); }
+
+    template<class T,class I,class N>
+    void draw(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,const VertexBuffer<N>& inst,size_t firstInstance,size_t instanceCount)
+         { implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),0,ibo.size(),0,&inst.impl,firstInstance,instanceCount); }
+
+    template<class T,class I,class N>
+    void draw(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,const TransientRange<N>& inst)
+         { if(inst.buf!=nullptr)
+             implDraw(vbo.impl,ibo.impl,Detail::indexCls<I>(),0,ibo.size(),0,inst.buf,inst.offset/sizeof(N),inst.size()); }
+
+    template<class T>
+    void draw(const TransientRange<T>& vbo){ draw(vbo,0,vbo.size()); }
+
+    template<class T>
+    void draw(const TransientRange<T>& vbo,size_t offset,size_t count)
+         { if(vbo.buf!=nullptr) implDraw(*vbo.buf,vbo.offset/sizeof(T)+offset,count); }
+
+    template<class T,class I>
+    void draw(const TransientRange<T>& vbo,const TransientRange<I>& ibo){ draw(vbo,ibo,0,ibo.size()); }
+
+    template<class T,class I>
+    void draw(const TransientRange<T>& vbo,const TransientRange<I>& ibo,size_t offset,size_t count)
+         { if(vbo.buf!=nullptr && ibo.buf!=nullptr)
+             implDraw(*vbo.buf,*ibo.buf,Detail::indexCls<I>(),ibo.offset/sizeof(I)+offset,count,vbo.offset/sizeof(T)); }
+
+    // one multi-draw, if supported by device; otherwise series of indirect draws
+    // [first, first+count) must be within ind, or InvalidIndirectRange is thrown;
+    // firstInstance of each command must be 0, unless Props::indirect.firstInstance
+    template<class T>
+    void drawIndirect(const VertexBuffer<T>& vbo,const IndirectBuffer<DrawIndirectCommand>& ind)
+         { implDrawIndirect(vbo.impl,nullptr,Detail::IndexClass::i16,ind.impl,0,ind.size(),sizeof(DrawIndirectCommand)); }
+
+    template<class T>
+    void drawIndirect(const VertexBuffer<T>& vbo,const IndirectBuffer<DrawIndirectCommand>& ind,size_t first,size_t count)
+         { implDrawIndirect(vbo.impl,nullptr,Detail::IndexClass::i16,ind.impl,first,count,sizeof(DrawIndirectCommand)); }
+
+    template<class T,class I>
+    void drawIndexedIndirect(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,const IndirectBuffer<DrawIndexedIndirectCommand>& ind)
+         { implDrawIndirect(vbo.impl,&ibo.impl,Detail::indexCls<I>(),ind.impl,0,ind.size(),sizeof(DrawIndexedIndirectCommand)); }
+
+    template<class T,class I>
+    void drawIndexedIndirect(const VertexBuffer<T>& vbo,const IndexBuffer<I>& ibo,const IndirectBuffer<DrawIndexedIndirectCommand>& ind,size_t first,size_t count)
+         { implDrawIndirect(vbo.impl,&ibo.impl,Detail::indexCls<I>(),ind.impl,first,count,sizeof(DrawIndexedIndirectCommand)); }
 
   private:
     Encoder(CommandBuffer* ow);
+    Encoder(CommandBundle* ow);
+
+    enum PassMode : uint8_t {
+      NoPass,
+      Pending, // render pass is started by first command
+      Inline,
+      Bundles,
+      };
 
     struct Viewport {
       uint32_t width =0;
@@ -67,27 +156,68 @@ class Encoder<Tempest::CommandBuffer> {
 
     struct State {
       const AbstractGraphicsApi::Pipeline* curPipeline=nullptr;
+      const AbstractGraphicsApi::CompPipeline* curCompute=nullptr;
       const VideoBuffer*                   curVbo     =nullptr;
       const VideoBuffer*                   curIbo     =nullptr;
+      const VideoBuffer*                   curInst    =nullptr;
+      const AbstractGraphicsApi::Desc*     curUniforms=nullptr;
+      uint32_t                             curOffset  =0;
+      const AbstractGraphicsApi::Desc*     curCompUniforms=nullptr;
       Viewport                             vp;
       };
 
     struct Pass {
       const FrameBuffer* fbo  = nullptr;
       const RenderPass*  pass = nullptr;
+      PassMode           mode = NoPass;
       };
 
     Tempest::CommandBuffer*             owner=nullptr;
     AbstractGraphicsApi::CommandBuffer* impl =nullptr;
     State                               state;
     Pass                                curPass;
+    Stats                               bindStats;
 
+    void         implSetPipeline(AbstractGraphicsApi::Pipeline& p);
+    void         implSetUniforms(AbstractGraphicsApi::Pipeline& p, AbstractGraphicsApi::Desc& u, uint32_t offset);
+    void         implBeginRenderPass(PassMode mode);
+    void         implBeginDraw();
     void         implEndRenderPass();
-    void         implDraw(const VideoBuffer& vbo, size_t offset, size_t size);
+    void         implDraw(const VideoBuffer& vbo, size_t offset, size_t size,
+                          const VideoBuffer* inst=nullptr, size_t firstInstance=0, size_t instanceCount=1);
     void         implDraw(const VideoBuffer &vbo, const VideoBuffer &ibo, Detail::IndexClass index,
-                          size_t offset, size_t size);
+                          size_t offset, size_t size, size_t voffset,
+                          const VideoBuffer* inst=nullptr, size_t firstInstance=0, size_t instanceCount=1);
+    void         implDrawIndirect(const VideoBuffer& vbo, const VideoBuffer* ibo, Detail::IndexClass index,
+                                  const VideoBuffer& ind, size_t first, size_t count, size_t stride);
+    void         implBindVbo(const VideoBuffer& vbo);
+    void         implBindIbo(const VideoBuffer& ibo, Detail::IndexClass index);
+    void         implBindInstance(const VideoBuffer* inst);
 
   friend class CommandBuffer;
+  friend class Encoder<Tempest::CommandBundle>;
+  };
+
+// records draw commands of CommandBundle; render pass state is inherited from executing encoder
+template<>
+class Encoder<Tempest::CommandBundle> : private Encoder<Tempest::CommandBuffer> {
+  public:
+    Encoder(Encoder&& e)=default;
+    Encoder& operator = (Encoder&& e)=default;
+
+    using Encoder<Tempest::CommandBuffer>::setUniforms;
+    using Encoder<Tempest::CommandBuffer>::setViewport;
+    using Encoder<Tempest::CommandBuffer>::setScissor;
+    using Encoder<Tempest::CommandBuffer>::draw;
+    using Encoder<Tempest::CommandBuffer>::drawIndirect;
+    using Encoder<Tempest::CommandBuffer>::drawIndexedIndirect;
+    using Encoder<Tempest::CommandBuffer>::Stats;
+    using Encoder<Tempest::CommandBuffer>::stats;
+
+  private:
+    Encoder(CommandBundle* ow):Encoder<Tempest::CommandBuffer>(ow){}
+
+  friend class CommandBundle;
   };
 }
 
@@ -7,6 +7,7 @@ namespace Tempest {
 
 class Device;
 class CommandBuffer;
+class CommandBundle;
 class Frame;
 class FrameBuffer;
 class Texture2d;
@@ -25,6 +26,7 @@ class FrameBufferLayout final {
   friend class Tempest::Device;
   friend class Tempest::FrameBuffer;
   friend class Tempest::CommandBuffer;
+  friend class Tempest::CommandBundle;
   };
 
 class FrameBuffer final {
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "videobuffer.h"
+
+#include <cstdint>
+
+namespace Tempest {
+
+// layout matches VkDrawIndirectCommand and D3D12_DRAW_ARGUMENTS
+struct DrawIndirectCommand {
+  uint32_t vertexCount   = 0;
+  uint32_t instanceCount = 1;
+  uint32_t firstVertex   = 0;
+  uint32_t firstInstance = 0;
+  };
+
+// layout matches VkDrawIndexedIndirectCommand and D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawIndexedIndirectCommand {
+  uint32_t indexCount    = 0;
+  uint32_t instanceCount = 1;
+  uint32_t firstIndex    = 0;
+  int32_t  vertexOffset  = 0;
+  uint32_t firstInstance = 0;
+  };
+
+// device-local draw arguments; can be written from compute shaders
+template<class T>
+class IndirectBuffer final {
+  public:
+    IndirectBuffer()=default;
+    IndirectBuffer(IndirectBuffer&&)=default;
+    IndirectBuffer& operator=(IndirectBuffer&&)=default;
+
+    size_t size() const { return sz; }
+
+  private:
+    IndirectBuffer(Tempest::VideoBuffer&& impl, size_t size)
+      :impl(std::move(impl)), sz(size) {
+      }
+
+    Tempest::VideoBuffer impl;
+    size_t               sz=0;
+
+  friend class Tempest::Device;
+  friend class Tempest::Uniforms;
+  friend class Tempest::Encoder<Tempest::CommandBuffer>;
+  };
+
+}
@@ -0,0 +1,29 @@
+#include "readback.h"
+
+using namespace Tempest;
+
+Readback::Readback(AbstractGraphicsApi::Readback* r)
+  :impl(r) {
+  }
+
+Readback::~Readback() {
+  delete impl.handler;
+  }
+
+bool Readback::isReady() const {
+  if(!impl)
+    return true;
+  return impl.handler->isReady();
+  }
+
+void Readback::wait() {
+  if(impl)
+    impl.handler->wait();
+  }
+
+Pixmap Readback::get() {
+  Pixmap pm;
+  if(impl)
+    impl.handler->read(pm);
+  return pm;
+  }
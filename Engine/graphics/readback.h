@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+#include <Tempest/Pixmap>
+#include "../utility/dptr.h"
+
+namespace Tempest {
+
+class Device;
+
+// pending gpu-to-cpu copy, issued by Device::readPixelsAsync
+class Readback final {
+  public:
+    Readback()=default;
+    Readback(Readback&& r)=default;
+    ~Readback();
+    Readback& operator = (Readback&& r)=default;
+
+    bool   isEmpty() const { return !impl; }
+    bool   isReady() const;
+    void   wait();
+    // waits for gpu, if needed
+    Pixmap get();
+
+  private:
+    Readback(AbstractGraphicsApi::Readback* r);
+
+    Detail::DPtr<AbstractGraphicsApi::Readback*> impl;
+
+  friend class Tempest::Device;
+  };
+
+}
@@ -2,8 +2,12 @@
 
 #include <Tempest/Device>
 
+#include <algorithm>
+
 using namespace Tempest;
 
+static const size_t MaxDirtyRects = 64;
+
 Sprite::Sprite() {
   }
 
@@ -18,10 +22,29 @@ const Texture2d &Sprite::pageRawData(Device& dev) const {
     }
 
   auto& mem=alloc.memory();
-  if( mem.changed ){
-    dev.waitIdle(); //FIXME: track usage of mem.gpu
+  if(mem.owner!=nullptr)
+    mem.owner->waitJob(mem.job);
+  // taken before upload: rects, added concurrently, stay for next upload
+  auto dirty = mem.takeDirty();
+  if(mem.gpu.isEmpty()) {
     mem.gpu=dev.loadTexture(mem.cpu,false);
-    mem.changed=false;
+    }
+  else if(!dirty.empty()) {
+    if(dirty.size()>MaxDirtyRects) {
+      // too many small copies - upload bounding box instead
+      Rect bbox = dirty[0];
+      for(auto& r:dirty) {
+        int x1 = std::max(bbox.x+bbox.w, r.x+r.w);
+        int y1 = std::max(bbox.y+bbox.h, r.y+r.h);
+        bbox.x = std::min(bbox.x,r.x);
+        bbox.y = std::min(bbox.y,r.y);
+        bbox.w = x1-bbox.x;
+        bbox.h = y1-bbox.y;
+        }
+      dirty.resize(1);
+      dirty[0] = bbox;
+      }
+    dev.updateTexture(mem.gpu,mem.cpu,dirty.data(),dirty.size());
     }
   return mem.gpu;
   }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "videobuffer.h"
+
+namespace Tempest {
+
+// device-local array, writable from compute shaders
+template<class T>
+class StorageBuffer final {
+  public:
+    StorageBuffer()=default;
+    StorageBuffer(StorageBuffer&&)=default;
+    StorageBuffer& operator=(StorageBuffer&&)=default;
+
+    size_t size() const { return sz; }
+
+  private:
+    StorageBuffer(Tempest::VideoBuffer&& impl, size_t size)
+      :impl(std::move(impl)), sz(size) {
+      }
+
+    Tempest::VideoBuffer impl;
+    size_t               sz=0;
+
+  friend class Tempest::Device;
+  friend class Tempest::Uniforms;
+  friend class Tempest::Encoder<Tempest::CommandBuffer>;
+  };
+
+}
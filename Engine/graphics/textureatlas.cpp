@@ -1,17 +1,136 @@
 #include "textureatlas.h"
 
 #include <Tempest/Sprite>
-#include <Tempest/Log>
+#include <Tempest/Device>
 #include <cstring>
+#include <algorithm>
+#include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <condition_variable>
 #include <squish.h>
 
 using namespace Tempest;
 
+struct TextureAtlas::Compressor {
+  Compressor() {
+    th = std::thread([this](){ run(); });
+    }
+
+  ~Compressor() {
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    exit = true;
+    }
+    cvQueue.notify_one();
+    th.join();
+    }
+
+  uint64_t push(std::function<void()> fn) {
+    std::lock_guard<std::mutex> guard(sync);
+    queue.emplace_back(std::move(fn));
+    ++queued;
+    cvQueue.notify_one();
+    return queued;
+    }
+
+  void wait(uint64_t id) {
+    std::unique_lock<std::mutex> guard(sync);
+    cvDone.wait(guard,[this,id](){ return done>=id; });
+    }
+
+  void run() {
+    std::unique_lock<std::mutex> guard(sync);
+    while(true) {
+      cvQueue.wait(guard,[this](){ return exit || !queue.empty(); });
+      // pending jobs are finished even on exit: pages are still alive
+      if(queue.empty())
+        return;
+      auto fn = std::move(queue.front());
+      queue.pop_front();
+      guard.unlock();
+      fn();
+      guard.lock();
+      ++done;
+      cvDone.notify_all();
+      }
+    }
+
+  std::mutex                        sync;
+  std::condition_variable           cvQueue, cvDone;
+  std::deque<std::function<void()>> queue;
+  uint64_t                          queued=0, done=0;
+  bool                              exit=false;
+  std::thread                       th;
+  };
+
+TextureAtlas::Pool::Pool(TextureAtlas& owner, Pixmap::Format frm, size_t bitsPerTexel)
+  :alloc(provider),bits(bitsPerTexel) {
+  provider.owner = &owner;
+  provider.frm   = frm;
+  }
+
+void TextureAtlas::Memory::addDirty(const Rect& r) const {
+  std::lock_guard<std::mutex> guard(*sync);
+  dirty.push_back(r);
+  }
+
+std::vector<Rect> TextureAtlas::Memory::takeDirty() const {
+  std::vector<Rect> ret;
+  std::lock_guard<std::mutex> guard(*sync);
+  std::swap(ret,dirty);
+  return ret;
+  }
+
+static uint64_t nextAtlasId() {
+  static std::atomic<uint64_t> id{0};
+  return id.fetch_add(1,std::memory_order_relaxed)+1;
+  }
+
 TextureAtlas::TextureAtlas(Device& device)
-  :device(device),alloc(provider) {
+  :device(device), uid(nextAtlasId()) {
+  pool[PF_RGBA].reset(new Pool(*this,Pixmap::Format::RGBA,32));
+  pool[PF_R   ].reset(new Pool(*this,Pixmap::Format::R,   8));
+  pool[PF_DXT1].reset(new Pool(*this,Pixmap::Format::DXT1,4));
+  pool[PF_DXT3].reset(new Pool(*this,Pixmap::Format::DXT3,8));
+  pool[PF_DXT5].reset(new Pool(*this,Pixmap::Format::DXT5,8));
   }
 
 TextureAtlas::~TextureAtlas() {
+  std::vector<Cache*> c;
+  {
+  std::lock_guard<std::mutex> guard(syncCache);
+  c = std::move(caches);
+  }
+  for(auto i:c)
+    i->detached(*this);
+  compressor.reset();
+  // pages are retiring into this atlas: destroy them, while it's complete
+  for(auto& p:pool)
+    p.reset();
+  }
+
+void TextureAtlas::retire(Memory& m) {
+  if(m.gpu.isEmpty())
+    return;
+  Retired r;
+  r.tex   = std::move(m.gpu);
+  r.frame = frame();
+  std::lock_guard<std::mutex> guard(syncRetired);
+  retired.push_back(std::move(r));
+  }
+
+bool TextureAtlas::Cache::isStale(const TextureAtlas& atlas, const Sprite& s, uint32_t frame) {
+  return atlas.isStale(s,frame);
+  }
+
+void TextureAtlas::Cache::hit(const TextureAtlas& atlas) {
+  atlas.hits.fetch_add(1,std::memory_order_relaxed);
+  }
+
+void TextureAtlas::Cache::miss(const TextureAtlas& atlas) {
+  atlas.misses.fetch_add(1,std::memory_order_relaxed);
   }
 
 Sprite TextureAtlas::load(const Pixmap &pm) {
@@ -19,22 +138,306 @@ Sprite TextureAtlas::load(const Pixmap &pm) {
   }
 
 Sprite TextureAtlas::load(const void *data, uint32_t w, uint32_t h, Pixmap::Format format) {
-  auto a = alloc.alloc(w,h);
+  switch(format) {
+    case Pixmap::Format::R:
+    case Pixmap::Format::R16:
+      return implLoad(PF_R,data,w,h,format);
+    case Pixmap::Format::DXT1:
+      if(hasFormat(PF_DXT1))
+        return implLoad(PF_DXT1,data,w,h,format);
+      break;
+    case Pixmap::Format::DXT3:
+      if(hasFormat(PF_DXT3))
+        return implLoad(PF_DXT3,data,w,h,format);
+      break;
+    case Pixmap::Format::DXT5:
+      if(hasFormat(PF_DXT5))
+        return implLoad(PF_DXT5,data,w,h,format);
+      break;
+    case Pixmap::Format::RGB:
+    case Pixmap::Format::RGBA:
+      if(compress && hasFormat(PF_DXT1) && hasFormat(PF_DXT5))
+        return loadCompressed(data,w,h,format);
+      break;
+    default:
+      break;
+    }
+  return implLoad(PF_RGBA,data,w,h,format);
+  }
+
+Sprite TextureAtlas::implLoad(PageFormat pf, const void* data, uint32_t w, uint32_t h, Pixmap::Format format) {
+  const bool bc = (pf==PF_DXT1 || pf==PF_DXT3 || pf==PF_DXT5);
+  // compressed pages are allocated in whole blocks; page size is a multiple of 4, so are positions
+  auto a = bc ? pool[pf]->alloc.alloc((w+3)&~3u,(h+3)&~3u) : pool[pf]->alloc.alloc(w,h);
   auto p = a.pos();
   emplace(a,data,w,h,format,uint32_t(p.x),uint32_t(p.y));
+  a.touch(frame());
+  Sprite ret(std::move(a),w,h);
+  return ret;
+  }
+
+Sprite TextureAtlas::loadCompressed(const void* data, uint32_t w, uint32_t h, Pixmap::Format format) {
+  const uint32_t bw = (w+3)/4, bh = (h+3)/4;
+  const uint32_t pw = bw*4,    ph = bh*4;
+
+  // padded copy of the source, edges are replicated to keep block endpoints clean
+  std::vector<uint8_t> rgba(size_t(pw)*ph*4);
+  toRgba(rgba.data(),pw*4,data,w,h,format);
+  for(uint32_t y=0;y<ph;++y) {
+    uint8_t* row = rgba.data()+size_t(y)*pw*4;
+    if(y>=h)
+      std::memcpy(row,rgba.data()+size_t(h-1)*pw*4,w*4);
+    for(uint32_t x=w;x<pw;++x)
+      std::memcpy(row+x*4,row+(w-1)*4,4);
+    }
+
+  bool opaque = true;
+  for(size_t i=3;i<rgba.size() && opaque;i+=4)
+    opaque = (rgba[i]==255);
+
+  const PageFormat pf    = opaque ? PF_DXT1 : PF_DXT5;
+  const int        flags = opaque ? squish::kDxt1 : squish::kDxt5;
+  const uint32_t   bsz   = opaque ? 8 : 16;
+
+  auto  a   = pool[pf]->alloc.alloc(pw,ph);
+  auto  p   = a.pos();
+  auto& mem = a.memory();
+
+  const uint32_t stride = ((mem.cpu.w()+3)/4)*bsz;
+  uint8_t*       dest   = reinterpret_cast<uint8_t*>(mem.cpu.data()) + (uint32_t(p.y)/4)*stride + (uint32_t(p.x)/4)*bsz;
+  if(compressor==nullptr)
+    compressor.reset(new Compressor());
+  mem.job = compressor->push([rgba=std::move(rgba),dest,stride,bw,bh,pw,bsz,flags](){
+    squish::u8 px[4*4*4];
+    for(uint32_t by=0;by<bh;++by)
+      for(uint32_t bx=0;bx<bw;++bx) {
+        for(uint32_t y=0;y<4;++y)
+          std::memcpy(px+y*16,rgba.data()+(size_t(by*4+y)*pw+bx*4)*4,16);
+        squish::Compress(px,dest+by*stride+bx*bsz,flags);
+        }
+    });
+  mem.addDirty(Rect(p.x,p.y,int(pw),int(ph)));
+
+  a.touch(frame());
   Sprite ret(std::move(a),w,h);
   return ret;
   }
 
+bool TextureAtlas::hasFormat(PageFormat pf) const {
+  static const TextureFormat frm[] = {TextureFormat::RGBA8, TextureFormat::R8,
+                                      TextureFormat::DXT1,  TextureFormat::DXT3, TextureFormat::DXT5};
+  return device.properties().hasSamplerFormat(frm[pf]);
+  }
+
+TextureAtlas::Pool* TextureAtlas::poolOf(const Allocation& a) const {
+  for(auto& i:pool)
+    if(a.owner==&i->alloc)
+      return i.get();
+  return nullptr;
+  }
+
+void TextureAtlas::setBlockCompression(bool c) {
+  compress = c;
+  }
+
+void TextureAtlas::waitJob(uint64_t id) const {
+  if(id!=0 && compressor!=nullptr)
+    compressor->wait(id);
+  }
+
+void TextureAtlas::setBudget(size_t bytes) {
+  memBudget = bytes;
+  }
+
+size_t TextureAtlas::memoryUsage() const {
+  size_t ret = 0;
+  for(auto& i:pool)
+    ret += i->alloc.area()*i->bits/8;
+  return ret;
+  }
+
+TextureAtlas::Stats TextureAtlas::stats() const {
+  Stats s;
+  s.hits      = hits.load(std::memory_order_relaxed);
+  s.misses    = misses.load(std::memory_order_relaxed);
+  s.evictions = evictions;
+  for(auto& i:pool)
+    s.pages += i->alloc.pageCount();
+  s.memory    = memoryUsage();
+  return s;
+  }
+
+void TextureAtlas::touch(const Sprite& s) const {
+  if(poolOf(s.alloc)!=nullptr)
+    s.alloc.touch(frame());
+  }
+
+bool TextureAtlas::isStale(const Sprite& s, uint32_t frame) const {
+  return poolOf(s.alloc)!=nullptr && s.alloc.lastUse()<frame;
+  }
+
+void TextureAtlas::attach(Cache& c) {
+  std::lock_guard<std::mutex> guard(syncCache);
+  if(std::find(caches.begin(),caches.end(),&c)==caches.end())
+    caches.push_back(&c);
+  }
+
+void TextureAtlas::detach(Cache& c) {
+  std::lock_guard<std::mutex> guard(syncCache);
+  caches.erase(std::remove(caches.begin(),caches.end(),&c),caches.end());
+  }
+
+bool TextureAtlas::fitsBudget(size_t liveBytes) const {
+  // assume ~80% packing efficiency after compaction
+  return liveBytes*5/4 <= memBudget;
+  }
+
+void TextureAtlas::nextFrame() {
+  const uint32_t frame = frameId.fetch_add(1,std::memory_order_relaxed)+1;
+  {
+  // frames, recorded before page was retired, are complete by now
+  const uint32_t inFlight = device.maxFramesInFlight();
+  std::lock_guard<std::mutex> guard(syncRetired);
+  retired.erase(std::remove_if(retired.begin(),retired.end(),[&](const Retired& r){
+    return r.frame+inFlight<=frame;
+    }),retired.end());
+  }
+  if(memBudget==0 || memoryUsage()<=memBudget)
+    return;
+
+  std::map<uint32_t,size_t> byAge;
+  size_t                    live = 0;
+  for(auto& p:pool) {
+    const size_t bits = p->bits;
+    p->alloc.forEachLive([&](uint32_t w,uint32_t h,uint32_t lastUse) {
+      const size_t sz = size_t(w)*size_t(h)*bits/8;
+      byAge[lastUse] += sz;
+      live           += sz;
+      });
+    }
+
+  std::vector<Cache*> c;
+  {
+  std::lock_guard<std::mutex> guard(syncCache);
+  c = caches;
+  }
+
+  // least recently used first; whatever was used in previous frame stays
+  size_t released = 0;
+  for(auto& i:byAge) {
+    if(fitsBudget(live) || i.first+1>=frame)
+      break;
+    size_t n = 0;
+    for(auto cache:c)
+      n += cache->evict(*this,i.first+1);
+    if(n==0)
+      continue;
+    released += n;
+    // sprites may be referenced from elsewhere: measure again
+    live = 0;
+    for(auto& p:pool) {
+      const size_t bits = p->bits;
+      p->alloc.forEachLive([&](uint32_t w,uint32_t h,uint32_t){ live += size_t(w)*size_t(h)*bits/8; });
+      }
+    }
+
+  if(released==0)
+    return;
+  evictions += released;
+  gen.fetch_add(1,std::memory_order_release);
+  compact();
+  }
+
+std::vector<TextureAtlas::Move> TextureAtlas::compact() {
+  if(compressor!=nullptr)
+    compressor->wait(compressor->push([](){}));
+
+  std::vector<Move> ret;
+  for(auto& p:pool) {
+    auto mv = p->alloc.compact([](const Memory& src, Memory& dst, const Allocator::Move& m){
+      blit(src,dst,m.src,m.dst);
+      });
+    for(auto& m:mv) {
+      Move r;
+      r.srcPage = m.srcId;
+      r.src     = m.src;
+      r.dstPage = m.dstId;
+      r.dst     = Rect(m.dst.x,m.dst.y,m.src.w,m.src.h);
+      ret.push_back(r);
+      }
+    }
+  if(!ret.empty())
+    gen.fetch_add(1,std::memory_order_release);
+  return ret;
+  }
+
+void TextureAtlas::blit(const Memory& src, Memory& dest, const Rect& r, const Point& at) {
+  const Pixmap::Format frm = src.cpu.format();
+  uint32_t bsz=0, blk=1;
+  switch(frm) {
+    case Pixmap::Format::DXT1: bsz = 8;  blk = 4; break;
+    case Pixmap::Format::DXT3:
+    case Pixmap::Format::DXT5: bsz = 16; blk = 4; break;
+    default:
+      bsz = uint32_t(Pixmap::bppForFormat(frm));
+      break;
+    }
+
+  auto     s   = reinterpret_cast<const uint8_t*>(src.cpu.data());
+  auto     d   = reinterpret_cast<uint8_t*>(dest.cpu.data());
+  uint32_t sw  = ((src.cpu.w() +blk-1)/blk)*bsz;
+  uint32_t dw  = ((dest.cpu.w()+blk-1)/blk)*bsz;
+  uint32_t row = (uint32_t(r.w)/blk)*bsz;
+  for(uint32_t iy=0;iy<uint32_t(r.h)/blk;++iy)
+    std::memcpy(d+(uint32_t(at.y)/blk+iy)*dw+(uint32_t(at.x)/blk)*bsz,
+                s+(uint32_t(r.y)/blk+iy)*sw+(uint32_t(r.x)/blk)*bsz, row);
+  }
+
 void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
                            uint32_t pw, uint32_t ph, Pixmap::Format format,
                            uint32_t x, uint32_t y) {
-  dest.memory().changed=true;
   Pixmap&  cpu  = dest.memory().cpu;
   auto     data = reinterpret_cast<uint8_t*>(cpu.data());
-  uint32_t dx   = x*4;
-  uint32_t dw   = cpu.w()*4;
+  auto     src  = reinterpret_cast<const uint8_t*>(img);
 
+  switch(cpu.format()) {
+    case Pixmap::Format::DXT1:
+    case Pixmap::Format::DXT3:
+    case Pixmap::Format::DXT5: {
+      // same format as source: copy whole 4x4 blocks
+      const uint32_t bsz = (cpu.format()==Pixmap::Format::DXT1) ? 8 : 16;
+      const uint32_t bw  = (pw+3)/4;
+      const uint32_t dw  = ((cpu.w()+3)/4)*bsz;
+      for(uint32_t iy=0;iy<(ph+3)/4;++iy)
+        std::memcpy(data+(y/4+iy)*dw+(x/4)*bsz,src+iy*bw*bsz,bw*bsz);
+      dest.memory().addDirty(Rect(int(x),int(y),int(bw*4),int(((ph+3)/4)*4)));
+      return;
+      }
+    case Pixmap::Format::R: {
+      const uint32_t dw = cpu.w();
+      for(uint32_t iy=0;iy<ph;++iy) {
+        auto data0 = data+(y+iy)*dw+x;
+        if(format==Pixmap::Format::R16) {
+          auto src0 = reinterpret_cast<const uint16_t*>(src)+iy*pw;
+          for(uint32_t ix=0;ix<pw;++ix)
+            data0[ix] = uint8_t(src0[ix]/256);
+          } else {
+          std::memcpy(data0,src+iy*pw,pw);
+          }
+        }
+      break;
+      }
+    default: {
+      const uint32_t dw = cpu.w()*4;
+      toRgba(data+y*dw+x*4,dw,img,pw,ph,format);
+      break;
+      }
+    }
+  dest.memory().addDirty(Rect(int(x),int(y),int(pw),int(ph)));
+  }
+
+void TextureAtlas::toRgba(uint8_t* data, uint32_t dw, const void* img,
+                          uint32_t pw, uint32_t ph, Pixmap::Format format) {
   auto     src  = reinterpret_cast<const uint8_t*>(img);
   uint32_t sbpp = uint32_t(Pixmap::bppForFormat(format));
   uint32_t sw   = pw*sbpp;
@@ -43,13 +446,25 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
   switch(format) {
     case Pixmap::Format::DXT1:
     case Pixmap::Format::DXT3:
-    case Pixmap::Format::DXT5:{
-      Log::d("compressed sprites are not implemented");
+    case Pixmap::Format::DXT5: {
+      // device can't sample this format: decompress
+      const int      frm = format==Pixmap::Format::DXT1 ? squish::kDxt1 :
+                           format==Pixmap::Format::DXT3 ? squish::kDxt3 : squish::kDxt5;
+      const uint32_t bsz = (format==Pixmap::Format::DXT1) ? 8 : 16;
+      const uint32_t bw  = (pw+3)/4;
+      squish::u8     px[4][4][4];
+      for(uint32_t by=0;by<(ph+3)/4;++by)
+        for(uint32_t bx=0;bx<bw;++bx) {
+          squish::Decompress(&px[0][0][0],src+(by*bw+bx)*bsz,frm);
+          for(uint32_t iy=0;iy<4 && by*4+iy<ph;++iy)
+            for(uint32_t ix=0;ix<4 && bx*4+ix<pw;++ix)
+              std::memcpy(data+(by*4+iy)*dw+(bx*4+ix)*4,px[iy][ix],4);
+          }
       break;
       }
     case Pixmap::Format::RGBA16: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =reinterpret_cast<const uint16_t*>(src+iy*sw);
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix+=4){
           data0[dx  ]=src0[ix  ]/256;
@@ -62,7 +477,7 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::RGB16: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =reinterpret_cast<const uint16_t*>(src+iy*sw);
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix+=3){
           data0[dx  ]=src0[ix  ]/256;
@@ -75,7 +490,7 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::RG16: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =reinterpret_cast<const uint16_t*>(src+iy*sw);
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix+=3){
           data0[dx  ]=src0[ix  ]/256;
@@ -88,7 +503,7 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::R16: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =reinterpret_cast<const uint16_t*>(src+iy*sw);
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix++){
           data0[dx  ]=255;
@@ -101,12 +516,12 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::RGBA: {
       for(uint32_t iy=0;iy<sh;++iy)
-        std::memcpy(data+((y+iy)*dw+dx),src+iy*sw,sw);
+        std::memcpy(data+iy*dw,src+iy*sw,sw);
       break;
       }
     case Pixmap::Format::RGB: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =src+iy*sw;
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix+=3){
           data0[dx  ]=src0[ix  ];
@@ -119,7 +534,7 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::RG: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =src+iy*sw;
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix+=2){
           data0[dx  ]=src0[ix  ];
@@ -132,7 +547,7 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       }
     case Pixmap::Format::R: {
       for(uint32_t iy=0;iy<sh;++iy){
-        auto data0=data+((y+iy)*dw+dx);
+        auto data0=data+iy*dw;
         auto src0 =src+iy*sw;
         for(uint32_t ix=0,dx=0;ix<sw;dx+=4,ix++){
           data0[dx  ]=255;
@@ -144,6 +559,4 @@ void TextureAtlas::emplace(TextureAtlas::Allocation &dest, const void* img,
       break;
       }
     }
-
-  //cpu.save("dbg.png");
   }
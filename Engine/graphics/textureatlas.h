@@ -6,6 +6,7 @@
 #include "../gapi/rectallocator.h"
 
 #include <vector>
+#include <memory>
 #include <mutex>
 #include <atomic>
 
@@ -20,45 +21,174 @@ class TextureAtlas {
     TextureAtlas(const TextureAtlas&)=delete;
     virtual ~TextureAtlas();
 
-    Sprite load(const Pixmap& pm);
-    Sprite load(const void* data,uint32_t w,uint32_t h,Pixmap::Format format);
+    struct Stats {
+      uint64_t hits      = 0; // lookups served by caches from resident sprites
+      uint64_t misses    = 0; // sprites generated by caches and uploaded to atlas
+      uint64_t evictions = 0; // sprites released by caches to fit into budget
+      size_t   pages     = 0;
+      size_t   memory    = 0; // bytes
+      };
+
+    // owner of sprites, that can be regenerated on demand, like glyph cache of a font
+    class Cache {
+      public:
+        virtual ~Cache()=default;
+        // drop references to sprites of atlas, that are not used since frame; returns number of released sprites
+        virtual size_t evict(const TextureAtlas& atlas, uint32_t frame) = 0;
+        // atlas is about to be destroyed
+        virtual void   detached(TextureAtlas& atlas) = 0;
+
+      protected:
+        static bool isStale(const TextureAtlas& atlas, const Sprite& s, uint32_t frame);
+        static void hit (const TextureAtlas& atlas);
+        static void miss(const TextureAtlas& atlas);
+      };
+
+    // sprite, relocated by compact; page ids are Sprite::pageId() values
+    struct Move {
+      const void* srcPage=nullptr; // no longer valid, use only as a key
+      Rect        src;
+      const void* dstPage=nullptr;
+      Rect        dst;
+      };
+
+    Sprite   load(const Pixmap& pm);
+    Sprite   load(const void* data,uint32_t w,uint32_t h,Pixmap::Format format);
+
+    // repack live sprites into fewer pages; returns old and new rects of moved sprites
+    // repacked pages are uploaded again on next use; textures of old pages are kept alive
+    // until Device::maxFramesInFlight() calls of nextFrame, as frames in flight may sample them
+    std::vector<Move> compact();
+
+    // 0 - no limit
+    void     setBudget(size_t bytes);
+    size_t   budget() const { return memBudget; }
+    size_t   memoryUsage() const;
+    Stats    stats() const;
+
+    // Frame boundary: when over budget, attached caches release least recently used sprites
+    // and atlas is compacted. Must not run concurrently with painting.
+    void     nextFrame();
+    uint32_t frame() const { return frameId.load(std::memory_order_relaxed); }
+    // unique per atlas instance, never reused
+    uint64_t id() const { return uid; }
+    // changes whenever sprites are evicted or moved to another place: geometry, recorded before
+    // generation has changed, refers to stale uv's and must be painted again. Widgets of Window
+    // do so automatically, user-owned VectorImage has to check generation by itself
+    uint32_t generation() const { return gen.load(std::memory_order_acquire); }
+    void     touch(const Sprite& s) const;
+
+    void     attach(Cache& c);
+    void     detach(Cache& c);
+
+    // RGB and RGBA sprites are compressed to BC1/BC3 pages on background thread, if device can sample them
+    void     setBlockCompression(bool c);
+    bool     isBlockCompression() const { return compress; }
 
   private:
+    // page format: R8 for glyph masks, BC pages for compressed sprites, RGBA8 for everything else
+    enum PageFormat : uint8_t {
+      PF_RGBA,
+      PF_R,
+      PF_DXT1,
+      PF_DXT3,
+      PF_DXT5,
+      PF_Count
+      };
+
     struct Memory {
       Memory()=default;
-      Memory(uint32_t w,uint32_t h):cpu(w,h,Pixmap::Format::RGBA){}
+      Memory(uint32_t w,uint32_t h,Pixmap::Format frm,TextureAtlas* owner)
+        :cpu(w,h,frm),owner(owner),sync(new std::mutex()){}
       Memory(Memory&&)=default;
 
       Memory& operator=(Memory&&)=default;
 
-      Pixmap            cpu;
-      mutable Texture2d gpu;
-      mutable bool      changed=true;
+      // dirty rects are added by loading threads and taken by render thread
+      void              addDirty(const Rect& r) const;
+      std::vector<Rect> takeDirty() const;
+
+      Pixmap                    cpu;
+      mutable Texture2d         gpu;
+      mutable std::vector<Rect> dirty;
+      TextureAtlas*             owner=nullptr;
+      std::unique_ptr<std::mutex> sync;
+      uint64_t                  job  =0; // last background job, that writes to this page
       };
 
     struct MemoryProvider {
       using DeviceMemory=Memory;
 
+      TextureAtlas*  owner=nullptr;
+      Pixmap::Format frm  =Pixmap::Format::RGBA;
+
       DeviceMemory alloc(uint32_t w,uint32_t h){
-        DeviceMemory ret(w,h);
+        DeviceMemory ret(w,h,frm,owner);
         return ret;
         }
 
       void free(DeviceMemory& m){
-        // nop
+        if(owner!=nullptr)
+          owner->retire(m);
         m=DeviceMemory();
         }
       };
 
-    using Allocation = typename Tempest::RectAllocator<MemoryProvider>::Allocation;
+    using Allocator  = Tempest::RectAllocator<MemoryProvider>;
+    using Allocation = typename Allocator::Allocation;
+
+    struct Pool {
+      Pool(TextureAtlas& owner,Pixmap::Format frm,size_t bitsPerTexel);
+
+      MemoryProvider provider;
+      Allocator      alloc;
+      size_t         bits=32;
+      };
+
+    struct Compressor;
+
+    // page texture, that may be still in use by frames in flight
+    struct Retired {
+      Texture2d tex;
+      uint32_t  frame=0;
+      };
+
+    Sprite implLoad(PageFormat pf, const void* data, uint32_t w, uint32_t h, Pixmap::Format format);
+    Sprite loadCompressed(const void* data, uint32_t w, uint32_t h, Pixmap::Format format);
+    bool   hasFormat(PageFormat pf) const;
+    Pool*  poolOf(const Allocation& a) const;
 
-    void emplace(Allocation& dest, const void *img,
-                 uint32_t w, uint32_t h, Pixmap::Format frm,
-                 uint32_t x, uint32_t y);
+    static void emplace(Allocation& dest, const void *img,
+                        uint32_t w, uint32_t h, Pixmap::Format frm,
+                        uint32_t x, uint32_t y);
+    static void toRgba (uint8_t* dest, uint32_t stride, const void *img,
+                        uint32_t w, uint32_t h, Pixmap::Format frm);
+    static void blit   (const Memory& src, Memory& dest, const Rect& r, const Point& at);
+
+    void   retire(Memory& m);
+    void   waitJob(uint64_t id) const;
+    bool   fitsBudget(size_t liveBytes) const;
+    bool   isStale(const Sprite& s, uint32_t frame) const;
 
     Device&                                 device;
-    MemoryProvider                          provider;
-    Tempest::RectAllocator<MemoryProvider> alloc;
+    std::unique_ptr<Pool>                   pool[PF_Count];
+    bool                                    compress=false;
+
+    size_t                                  memBudget=0;
+    const uint64_t                          uid;
+    std::atomic<uint32_t>                   frameId{1};
+    std::atomic<uint32_t>                   gen{0};
+    mutable std::atomic<uint64_t>           hits{0}, misses{0};
+    uint64_t                                evictions=0;
+
+    std::mutex                              syncCache;
+    std::vector<Cache*>                     caches;
+
+    std::mutex                              syncRetired;
+    std::vector<Retired>                    retired;
+
+    // destroyed before pages, that it writes to
+    std::unique_ptr<Compressor>             compressor;
 
   friend class Sprite;
   };
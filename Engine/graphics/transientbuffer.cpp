@@ -0,0 +1,71 @@
+#include "transientbuffer.h"
+
+#include <Tempest/Device>
+#include <Tempest/Except>
+
+#include "gapi/graphicsmemutils.h"
+
+#include <algorithm>
+
+using namespace Tempest;
+
+TransientBuffer::TransientBuffer(Device& dev, size_t frameSize, uint8_t frameCount)
+  :dev(&dev), frames(new Frame[std::max<uint8_t>(frameCount,1)]), frameCount(std::max<uint8_t>(frameCount,1)) {
+  auto& prop  = dev.properties();
+  uboAlign    = prop.ubo.offsetAlign;
+  uboMaxRange = prop.ubo.maxRange;
+  for(uint8_t i=0;i<this->frameCount;++i)
+    frames[i].pages.emplace_back(implPage(frameSize));
+  }
+
+TransientBuffer::~TransientBuffer() {
+  }
+
+void TransientBuffer::reset(uint8_t frameId) {
+  if(frames==nullptr)
+    return;
+  current = uint8_t(frameId%frameCount);
+  // keep only the biggest page, so frame doesn't overflow again
+  auto& f = frames[current];
+  while(f.pages.size()>1)
+    f.pages.pop_front();
+  f.at = 0;
+  }
+
+size_t TransientBuffer::used() const {
+  return frames==nullptr ? 0 : frames[current].at;
+  }
+
+size_t TransientBuffer::uboStride(size_t eltSize) const {
+  if(eltSize>uboMaxRange)
+    throw std::system_error(Tempest::GraphicsErrc::TooLardgeUbo);
+  return ((eltSize+uboAlign-1)/uboAlign)*uboAlign;
+  }
+
+const VideoBuffer* TransientBuffer::implAlloc(const void* data, size_t count, size_t eltSize,
+                                              size_t stride, size_t align, size_t& offset) {
+  if(frames==nullptr)
+    throw std::system_error(Tempest::GraphicsErrc::InvalidBufferUpdate);
+
+  auto&        f    = frames[current];
+  const size_t size = count*stride;
+  Page*        pg   = &f.pages.back();
+  offset = ((f.at+align-1)/align)*align;
+  if(offset+size>pg->buf.size()) {
+    // previous pages are still in use by this frame: keep them until reset
+    f.pages.emplace_back(implPage(std::max(pg->buf.size()*2,size)));
+    pg     = &f.pages.back();
+    offset = 0;
+    }
+  Detail::copyUpsample(data,pg->mapped+offset,count,eltSize,stride);
+  f.at = offset+size;
+  return &pg->buf;
+  }
+
+TransientBuffer::Page TransientBuffer::implPage(size_t size) {
+  Page p;
+  void* mapped = nullptr;
+  p.buf    = dev->createMappedBuffer(std::max<size_t>(size,1),MemUsage::VertexBuffer|MemUsage::IndexBuffer|MemUsage::UniformBuffer,mapped);
+  p.mapped = reinterpret_cast<uint8_t*>(mapped);
+  return p;
+  }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+#include "videobuffer.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace Tempest {
+
+class Device;
+class CommandBuffer;
+class Uniforms;
+class TransientBuffer;
+
+template<class T>
+class Encoder;
+
+template<class T>
+class TransientRange final {
+  public:
+    TransientRange()=default;
+
+    size_t size() const { return count; }
+    bool   isEmpty() const { return count==0; }
+
+  private:
+    TransientRange(const VideoBuffer* buf, size_t offset, size_t count, size_t stride)
+      :buf(buf), offset(offset), count(count), stride(stride) {
+      }
+
+    const VideoBuffer* buf   =nullptr;
+    size_t             offset=0; // in bytes
+    size_t             count =0;
+    size_t             stride=sizeof(T);
+
+  friend class Tempest::TransientBuffer;
+  friend class Tempest::Uniforms;
+  friend class Tempest::Encoder<Tempest::CommandBuffer>;
+  };
+
+// bump allocator over persistently mapped memory, one region per frame in flight
+class TransientBuffer final {
+  public:
+    TransientBuffer()=default;
+    TransientBuffer(TransientBuffer&&)=default;
+    ~TransientBuffer();
+    TransientBuffer& operator=(TransientBuffer&&)=default;
+
+    // discards ranges of frame; wait for fence of this frame, before reset
+    void   reset(uint8_t frameId);
+    size_t used() const;
+
+    template<class T>
+    TransientRange<T> vbo(const T* data, size_t count) { return implAlloc<T>(data,count,sizeof(T),sizeof(T)); }
+    template<class T>
+    TransientRange<T> vbo(const std::vector<T>& v)     { return vbo(v.data(),v.size()); }
+
+    template<class T>
+    TransientRange<T> ibo(const T* data, size_t count) { return implAlloc<T>(data,count,sizeof(T),sizeof(T)); }
+    template<class T>
+    TransientRange<T> ibo(const std::vector<T>& v)     { return ibo(v.data(),v.size()); }
+
+    template<class T>
+    TransientRange<T> ubo(const T* data, size_t count) { return implAlloc<T>(data,count,uboStride(sizeof(T)),uboAlign); }
+    template<class T>
+    TransientRange<T> ubo(const T& data)               { return ubo(&data,1); }
+
+  private:
+    TransientBuffer(Device& dev, size_t frameSize, uint8_t frameCount);
+
+    struct Page {
+      VideoBuffer buf;
+      uint8_t*    mapped=nullptr;
+      };
+
+    struct Frame {
+      std::list<Page> pages;
+      size_t          at=0;
+      };
+
+    Device*                  dev=nullptr;
+    std::unique_ptr<Frame[]> frames;
+    uint8_t                  frameCount=0;
+    uint8_t                  current=0;
+    size_t                   uboAlign=1;
+    size_t                   uboMaxRange=0;
+
+    size_t             uboStride(size_t eltSize) const;
+    const VideoBuffer* implAlloc(const void* data, size_t count, size_t eltSize, size_t stride, size_t align, size_t& offset);
+    Page               implPage(size_t size);
+
+    template<class T>
+    TransientRange<T> implAlloc(const T* data, size_t count, size_t stride, size_t align) {
+      if(count==0)
+        return TransientRange<T>();
+      size_t offset = 0;
+      auto*  buf    = implAlloc(data,count,sizeof(T),stride,align,offset);
+      return TransientRange<T>(buf,offset,count,stride);
+      }
+
+  friend class Tempest::Device;
+  };
+
+}
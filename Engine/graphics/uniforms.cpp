@@ -47,3 +47,9 @@ void Uniforms::implBindUbo(size_t layoutBind, const VideoBuffer& vbuf, size_t of
     desc.handler->set(layoutBind,vbuf.impl.handler,offset*size,count*size,size); else
     throw std::system_error(Tempest::GraphicsErrc::InvalidUniformBuffer);
   }
+
+void Uniforms::implBindUbo(size_t layoutBind, const VideoBuffer* vbuf, size_t byteOffset, size_t byteSize, size_t align) {
+  if(vbuf!=nullptr && vbuf->impl.handler)
+    desc.handler->set(layoutBind,vbuf->impl.handler,byteOffset,byteSize,align); else
+    throw std::system_error(Tempest::GraphicsErrc::InvalidUniformBuffer);
+  }
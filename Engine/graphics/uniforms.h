@@ -2,6 +2,9 @@
 
 #include <Tempest/AbstractGraphicsApi>
 #include <Tempest/UniformBuffer>
+#include <Tempest/StorageBuffer>
+#include <Tempest/IndirectBuffer>
+#include <Tempest/TransientBuffer>
 
 namespace Tempest {
 
@@ -27,13 +30,22 @@ class Uniforms final {
     void set(size_t layoutBind,const UniformBuffer<T>& vbuf);
     template<class T>
     void set(size_t layoutBind,const UniformBuffer<T>& vbuf,size_t offset,size_t size);
+    template<class T>
+    void set(size_t layoutBind,const TransientRange<T>& range);
+    template<class T>
+    void set(size_t layoutBind,const StorageBuffer<T>& vbuf);
+    // as storage buffer, to generate draw arguments in compute shader
+    template<class T>
+    void set(size_t layoutBind,const IndirectBuffer<T>& vbuf);
     void set(size_t layoutBind,const Texture2d&  tex, const Sampler2d& smp = Sampler2d::anisotrophy());
+    // storage image, if layoutBind is image2D in shader
     void set(size_t layoutBind,const Attachment& tex, const Sampler2d& smp = Sampler2d::anisotrophy());
     void set(size_t layoutBind,const Detail::ResourcePtr<Texture2d>& tex, const Sampler2d& smp = Sampler2d::anisotrophy());
 
   private:
     Uniforms(Tempest::Device& dev,AbstractGraphicsApi::Desc* desc);
     void implBindUbo(size_t layoutBind, const VideoBuffer& vbuf, size_t offset, size_t count, size_t size);
+    void implBindUbo(size_t layoutBind, const VideoBuffer* vbuf, size_t byteOffset, size_t byteSize, size_t align);
 
     Tempest::Device*                         dev=nullptr;
     Detail::DPtr<AbstractGraphicsApi::Desc*> desc;
@@ -51,4 +63,19 @@ template<class T>
 inline void Uniforms::set(size_t layoutBind, const UniformBuffer<T>& vbuf, size_t offset, size_t size) {
   implBindUbo(layoutBind,vbuf.impl,offset,size,vbuf.alignedTSZ);
   }
+
+template<class T>
+inline void Uniforms::set(size_t layoutBind, const TransientRange<T>& range) {
+  implBindUbo(layoutBind,range.buf,range.offset,range.count*range.stride,range.stride);
+  }
+
+template<class T>
+inline void Uniforms::set(size_t layoutBind, const StorageBuffer<T>& vbuf) {
+  implBindUbo(layoutBind,vbuf.impl,0,vbuf.size(),sizeof(T));
+  }
+
+template<class T>
+inline void Uniforms::set(size_t layoutBind, const IndirectBuffer<T>& vbuf) {
+  implBindUbo(layoutBind,vbuf.impl,0,vbuf.size(),sizeof(T));
+  }
 }
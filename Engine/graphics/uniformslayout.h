@@ -18,10 +18,13 @@ class UniformsLayout final {
       Ubo    =0,
       Texture=1,
       Push   =2,
+      Ssbo   =3,
+      Image  =4, // storage image
       };
     enum Stage : uint8_t {
       Vertex  =1<<0,
       Fragment=1<<1,
+      Compute =1<<2,
       };
     struct Binding {
       uint32_t layout=0;
@@ -44,6 +47,7 @@ class UniformsLayout final {
 
   friend class Device;
   friend class RenderPipeline;
+  friend class ComputePipeline;
   };
 
 }
@@ -0,0 +1,18 @@
+#include "uploadtoken.h"
+
+using namespace Tempest;
+
+UploadToken::UploadToken(AbstractGraphicsApi::Device* dev, uint64_t ticket)
+  :dev(dev), ticket(ticket) {
+  }
+
+bool UploadToken::isReady() const {
+  if(dev==nullptr)
+    return true;
+  return dev->isUploaded(ticket);
+  }
+
+void UploadToken::wait() const {
+  if(dev!=nullptr)
+    dev->waitUpload(ticket);
+  }
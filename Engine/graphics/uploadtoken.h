@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Tempest/AbstractGraphicsApi>
+
+namespace Tempest {
+
+class Device;
+
+// completion of asynchronous upload, issued by Device::loadTexture
+class UploadToken final {
+  public:
+    UploadToken()=default;
+
+    bool isReady() const;
+    void wait() const;
+
+  private:
+    UploadToken(AbstractGraphicsApi::Device* dev, uint64_t ticket);
+
+    AbstractGraphicsApi::Device* dev    = nullptr;
+    uint64_t                     ticket = 0;
+
+  friend class Tempest::Device;
+  };
+
+}
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) out vec4 outColor;
+
+layout(location = 0) in  vec2 inUV;
+layout(location = 1) in  vec4 inColor;
+
+void main() {
+  // glyph edge is at 0.5, see FontElement::Impl::allocSdfLetter
+  float dist  = texture(texSampler,inUV).a;
+  float w     = fwidth(dist);
+  float alpha = smoothstep(0.5-w,0.5+w,dist);
+  outColor = vec4(inColor.rgb,inColor.a*alpha);
+  }
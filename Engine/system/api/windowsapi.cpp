@@ -201,6 +201,10 @@ void WindowsApi::implExit() {
   PostQuitMessage(0);
   }
 
+void WindowsApi::implWakeup() {
+  // message loop is not blocking
+  }
+
 bool WindowsApi::implIsRunning() {
   return !isExit.load();
   }
@@ -15,6 +15,7 @@ class WindowsApi final : SystemApi {
     Window*  implCreateWindow(Tempest::Window *owner, ShowMode sm) override;
     void     implDestroyWindow(Window* w) override;
     void     implExit() override;
+    void     implWakeup() override;
 
     Rect     implWindowClientRect(SystemApi::Window *w) override;
     bool     implSetAsFullscreen(SystemApi::Window *w, bool fullScreen) override;
@@ -13,11 +13,17 @@
 #include <Tempest/TextCodec>
 #include <Tempest/Window>
 
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include <atomic>
+#include <limits>
 #include <stdexcept>
 #include <cstring>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 struct HWND final {
   ::Window wnd;
@@ -47,8 +53,10 @@ static Display*         dpy  = nullptr;
 static ::Window         root = {};
 static std::atomic_bool isExit{0};
 static int              activeCursorChange = 0;
+static int              wakeFd = -1;
 
 static std::unordered_map<SystemApi::Window*,Tempest::Window*> windows;
+static std::unordered_set<SystemApi::Window*>                  unmapped;
 
 static Atom& wmDeleteMessage(){
   static Atom w  = XInternAtom( dpy, "WM_DELETE_WINDOW", 0);
@@ -106,6 +114,9 @@ X11Api::X11Api() {
 
   root = DefaultRootWindow(dpy);
 
+  // cross-thread wakeup for blocking event loop
+  wakeFd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+
   static const TranslateKeyPair k[] = {
     { XK_Control_L, Event::K_LControl },
     { XK_Control_R, Event::K_RControl },
@@ -142,6 +153,12 @@ X11Api::X11Api() {
   setupKeyTranslate(k,24);
   }
 
+X11Api::~X11Api() {
+  if(wakeFd>=0)
+    close(wakeFd);
+  wakeFd = -1;
+  }
+
 void *X11Api::display() {
   return dpy;
   }
@@ -169,7 +186,7 @@ SystemApi::Window *X11Api::implCreateWindow(Tempest::Window *owner, uint32_t w,
 
   XSetWindowAttributes swa={};
   swa.colormap   = cmap;
-  swa.event_mask = PointerMotionMask | ExposureMask |
+  swa.event_mask = PointerMotionMask | ExposureMask | StructureNotifyMask |
                    ButtonPressMask | ButtonReleaseMask |
                    KeyPressMask | KeyReleaseMask;
 
@@ -222,6 +239,7 @@ SystemApi::Window *X11Api::implCreateWindow(Tempest::Window *owner, SystemApi::S
 
 void X11Api::implDestroyWindow(SystemApi::Window *w) {
   windows.erase(w); //NOTE: X11 can send events to ded window
+  unmapped.erase(w);
   XDestroyWindow(dpy, HWND(w));
   }
 
@@ -309,6 +327,15 @@ Rect X11Api::implWindowClientRect(SystemApi::Window *w) {
 
 void X11Api::implExit() {
   isExit.store(true);
+  implWakeup();
+  }
+
+void X11Api::implWakeup() {
+  if(wakeFd<0)
+    return;
+  uint64_t v = 1;
+  ssize_t  r = write(wakeFd,&v,sizeof(v));
+  (void)r;
   }
 
 bool X11Api::implIsRunning() {
@@ -318,13 +345,39 @@ bool X11Api::implIsRunning() {
 int X11Api::implExec(SystemApi::AppCallBack &cb) {
   // main message loop
   while (!isExit.load()) {
-    implProcessEvents(cb);
+    if(!dispatchEvent(cb))
+      waitEvents(cb.nextTimer());
     }
   return 0;
   }
 
 void X11Api::implProcessEvents(SystemApi::AppCallBack &cb) {
-  // main message loop
+  dispatchEvent(cb);
+  }
+
+void X11Api::waitEvents(uint64_t timeout) {
+  XFlush(dpy);
+  if(XPending(dpy)>0 || isExit.load())
+    return;
+
+  pollfd fd[2] = {};
+  fd[0].fd     = ConnectionNumber(dpy);
+  fd[0].events = POLLIN;
+  fd[1].fd     = wakeFd;
+  fd[1].events = POLLIN;
+
+  int ms = -1;
+  if(timeout<uint64_t(std::numeric_limits<int>::max()))
+    ms = int(timeout);
+
+  if(poll(fd,(wakeFd<0 ? 1 : 2),ms)>0 && (fd[1].revents & POLLIN)) {
+    uint64_t v = 0;
+    ssize_t  r = read(wakeFd,&v,sizeof(v));
+    (void)r;
+    }
+  }
+
+bool X11Api::dispatchEvent(SystemApi::AppCallBack &cb) {
   if(XPending(dpy)>0) {
     XEvent xev={};
     XNextEvent(dpy, &xev);
@@ -332,9 +385,28 @@ void X11Api::implProcessEvents(SystemApi::AppCallBack &cb) {
     HWND hWnd = xev.xclient.window;
     auto it = windows.find(hWnd.ptr());
     if(it==windows.end() || it->second==nullptr)
-      return;
+      return true;
     Tempest::Window& cb = *it->second; //TODO: validation
     switch( xev.type ) {
+      case ConfigureNotify: {
+        // also sent on move; only size matters
+        if(xev.xconfigure.width==cb.w() && xev.xconfigure.height==cb.h())
+          break;
+        Tempest::SizeEvent e(xev.xconfigure.width, xev.xconfigure.height);
+        SystemApi::dispatchResize(cb,e);
+        cb.update();
+        break;
+        }
+      case Expose:
+        cb.update();
+        break;
+      case MapNotify:
+        unmapped.erase(it->first);
+        cb.update();
+        break;
+      case UnmapNotify:
+        unmapped.insert(it->first);
+        break;
       case ClientMessage: {
         if( xev.xclient.data.l[0] == long(wmDeleteMessage()) ){
           SystemApi::exit();
@@ -417,18 +489,26 @@ void X11Api::implProcessEvents(SystemApi::AppCallBack &cb) {
         }
       }
 
-    std::this_thread::yield();
-    } else {
-    if(cb.onTimer()==0)
-      std::this_thread::yield();
-    for(auto& i:windows) {
-      if(i.second==nullptr)
+    return true;
+    }
+
+  bool busy = (cb.onTimer()>0);
+  for(auto& i:windows) {
+    if(i.second==nullptr || unmapped.find(i.first)!=unmapped.end())
+      continue;
+    Tempest::Window& w = *i.second;
+    if(w.renderMode()==Tempest::Window::OnDemand) {
+      if(!w.needToUpdate())
         continue;
-      // artificial move/resize event
-      alignGeometry(i.first,*i.second);
-      SystemApi::dispatchRender(*i.second);
+      SystemApi::dispatchRender(w);
+      // window, that requests update from render, keeps loop running
+      busy |= w.needToUpdate();
+      continue;
       }
+    SystemApi::dispatchRender(w);
+    busy = true;
     }
+  return busy;
   }
 
 #endif
@@ -7,6 +7,7 @@ namespace Tempest {
 class X11Api : public SystemApi {
   public:
     X11Api();
+    ~X11Api() override;
 
     static void* display();
 
@@ -15,6 +16,7 @@ class X11Api : public SystemApi {
     Window*  implCreateWindow(Tempest::Window *owner, ShowMode sm) override;
     void     implDestroyWindow(Window* w) override;
     void     implExit() override;
+    void     implWakeup() override;
 
     Rect     implWindowClientRect(SystemApi::Window *w) override;
 
@@ -30,6 +32,8 @@ class X11Api : public SystemApi {
 
   private:
     void     alignGeometry(Window *w, Tempest::Window& owner);
+    bool     dispatchEvent(AppCallBack& cb);
+    void     waitEvents(uint64_t timeout);
 };
 
 }
@@ -5,6 +5,7 @@
 #include <Tempest/Style>
 #include <Tempest/Font>
 
+#include <algorithm>
 #include <vector>
 #include <thread>
 
@@ -42,6 +43,18 @@ struct Application::Impl : SystemApi::AppCallBack {
     return uint32_t(count);
     }
 
+  uint64_t nextTimer() override {
+    auto     now = Application::tickCount();
+    uint64_t ret = uint64_t(-1);
+    for(auto t:timer) {
+      uint64_t at = t->nextEmit();
+      if(at<=now)
+        return 0;
+      ret = std::min(ret,at-now);
+      }
+    return ret;
+    }
+
   void setStyle(const Style* s) {
     if(style!=nullptr)
       style->implDecRef();
@@ -153,6 +153,10 @@ void EventDispatcher::dispatchClose(Widget& wnd, CloseEvent& e) {
   wnd.closeEvent(e);
   }
 
+void EventDispatcher::dispatchPaint(Widget& wnd, PaintEvent& e) {
+  wnd.dispatchPaintEvent(e);
+  }
+
 void EventDispatcher::dispatchRender(Window& wnd) {
   if(wnd.w()>0 && wnd.h()>0)
     wnd.render();
@@ -22,6 +22,7 @@ class EventDispatcher final {
 
     void dispatchResize    (Widget& wnd, Tempest::SizeEvent&  event);
     void dispatchClose     (Widget& wnd, Tempest::CloseEvent& event);
+    void dispatchPaint     (Widget& wnd, Tempest::PaintEvent& event);
 
     void dispatchRender    (Window& wnd);
     void dispatchOverlayRender(Window& wnd,Tempest::PaintEvent& e);
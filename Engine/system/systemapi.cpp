@@ -160,6 +160,10 @@ void SystemApi::exit() {
   return inst().implExit();
   }
 
+void SystemApi::wakeup() {
+  return inst().implWakeup();
+  }
+
 int SystemApi::exec(AppCallBack& cb) {
   return inst().implExec(cb);
   }
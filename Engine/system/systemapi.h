@@ -42,6 +42,7 @@ class SystemApi {
     static Window*  createWindow(Tempest::Window* owner, ShowMode sm);
     static void     destroyWindow(Window* w);
     static void     exit();
+    static void     wakeup();
 
     static Rect     windowClientRect(SystemApi::Window *w);
 
@@ -61,6 +62,8 @@ class SystemApi {
     struct AppCallBack {
       virtual ~AppCallBack()=default;
       virtual uint32_t onTimer()=0;
+      // milliseconds until nearest timer deadline, uint64_t(-1) if there are no timers
+      virtual uint64_t nextTimer()=0;
       };
 
     SystemApi();
@@ -68,6 +71,7 @@ class SystemApi {
     virtual Window*  implCreateWindow (Tempest::Window *owner,ShowMode sm) = 0;
     virtual void     implDestroyWindow(Window* w) = 0;
     virtual void     implExit() = 0;
+    virtual void     implWakeup() = 0;
 
     virtual Rect     implWindowClientRect(SystemApi::Window *w) = 0;
 
@@ -21,6 +21,7 @@ class Timer final {
   private:
     void     setRunning(bool b);
     bool     process(uint64_t now);
+    uint64_t nextEmit() const { return m.lastEmit+m.interval; }
 
     struct {
       uint64_t interval=0;
@@ -190,12 +190,13 @@ class PaintEvent: public Event {
       setType( Paint );
       }
 
-    PaintDevice& device()  { return dev;  }
-    uint32_t     w() const { return outW; }
-    uint32_t     h() const { return outH; }
+    PaintDevice&  device()  { return dev;  }
+    TextureAtlas& atlas()   { return ta;   }
+    uint32_t      w() const { return outW; }
+    uint32_t      h() const { return outH; }
 
-    const Point& orign()    const { return dp; }
-    const Rect&  viewPort() const { return vp; }
+    const Point&  orign()    const { return dp; }
+    const Rect&   viewPort() const { return vp; }
 
   private:
     PaintDevice&  dev;
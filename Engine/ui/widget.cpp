@@ -3,11 +3,20 @@
 #include <Tempest/Layout>
 #include <Tempest/Application>
 #include <Tempest/UiOverlay>
+#include <Tempest/PaintDevice>
+#include <Tempest/TextureAtlas>
+
+#include <atomic>
 
 using namespace Tempest;
 
 std::recursive_mutex Widget::syncSCuts;
 
+static uint64_t nextCacheId() {
+  static std::atomic<uint64_t> id{0};
+  return ++id;
+  }
+
 Widget::Iterator::Iterator(Widget* owner)
   :owner(owner),nodes(&owner->wx){
   owner->iterator=this;
@@ -55,7 +64,8 @@ Widget::Ref::~Ref() {
   }
 
 
-Widget::Widget() {
+Widget::Widget()
+  :cacheId(nextCacheId()) {
   lay = new(layBuf) Layout();
   lay->bind(this);
   }
@@ -124,8 +134,23 @@ void Widget::implDisableSum(Widget *root,int diff) noexcept {
   }
 
 void Widget::dispatchPaintEvent(PaintEvent& e) {
+  PaintDevice&          dev = e.device();
+  PaintDevice::CacheKey key;
+  key.id       = cacheId;
+  key.dx       = e.orign().x;
+  key.dy       = e.orign().y;
+  key.vp       = e.viewPort();
+  key.w        = e.w();
+  key.h        = e.h();
+  key.atlas    = e.atlas().id();
+  key.atlasGen = e.atlas().generation();
+
+  // nothing changed in this subtree - replay geometry from previous paint
+  if(!astate.needToUpdate && dev.restoreCache(key))
+    return;
   astate.needToUpdate = false;
 
+  const size_t cache = dev.beginCache();
   paintEvent(e);
   Widget::Iterator it(this);
   for(;it.hasNext();it.next()) {
@@ -138,12 +163,16 @@ void Widget::dispatchPaintEvent(PaintEvent& e) {
     r.y -= wx.y();
     Rect sc = r.intersected(Rect(0,0,wx.w(),wx.h()));
 
-    if(sc.isEmpty())
+    if(sc.isEmpty()) {
+      // not painted, so any later update() must reach the owner
+      wx.astate.needToUpdate = false;
       continue;
+      }
 
     PaintEvent ex(e,wx.x(),wx.y(),sc.x,sc.y,sc.w,sc.h);
     wx.dispatchPaintEvent(ex);
     }
+  dev.endCache(cache,key);
   }
 
 void Widget::dispatchPolishEvent(PolishEvent& e) {
@@ -411,8 +440,8 @@ void Widget::setVisible(bool v) {
   if(v==wstate.visible)
     return;
   wstate.visible = v;
-  if( !wstate.visible )
-    astate.needToUpdate = false;
+  // hidden widget is not painted, so cached geometry of it can be outdated
+  astate.needToUpdate = wstate.visible;
 
   if( auto w = owner() ){
     w->update();
@@ -191,6 +191,7 @@ class Widget {
     char                    layBuf[sizeof(void*)*3]={};
 
     const Style*            stl = nullptr;
+    const uint64_t          cacheId;
 
     void                    implRegisterSCut(Shortcut* s);
     void                    implUnregisterSCut(Shortcut* s);
@@ -17,10 +17,18 @@ class Window : public Widget {
       FullScreen,
       };
 
+    enum RenderMode : uint8_t {
+      Continuous, // render is called on every pass of event loop
+      OnDemand,   // render is called only when needToUpdate(); event loop sleeps otherwise (X11)
+      };
+
     Window();
     Window( ShowMode sm );
     ~Window() override;
 
+    void       setRenderMode(RenderMode m) { rmode = m; }
+    RenderMode renderMode() const { return rmode; }
+
   protected:
     virtual void render();
     void         dispatchPaintEvent(VectorImage &e,TextureAtlas &ta);
@@ -30,6 +38,7 @@ class Window : public Widget {
 
   private:
     SystemApi::Window* id=nullptr;
+    RenderMode         rmode=Continuous;
 
   friend class UiOverlay;
   friend class EventDispatcher;
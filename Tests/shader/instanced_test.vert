@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex {
+  vec4 gl_Position;
+  };
+
+layout(location = 0) in  vec2 inPos;
+layout(location = 1) in  vec4 inInst; // xy - offset, zw - scale
+layout(location = 0) out vec2 outPos;
+
+void main() {
+  outPos      = inPos;
+  gl_Position = vec4(inPos.xy*inInst.zw+inInst.xy, 1.0, 1.0);
+  }
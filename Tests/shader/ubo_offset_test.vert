@@ -0,0 +1,18 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex {
+  vec4 gl_Position;
+  };
+
+layout(binding = 0) uniform Ubo {
+  vec4 inst; // xy - offset, zw - scale
+  } ubo;
+
+layout(location = 0) in  vec2 inPos;
+layout(location = 0) out vec2 outPos;
+
+void main() {
+  outPos      = inPos;
+  gl_Position = vec4(inPos.xy*ubo.inst.zw+ubo.inst.xy, 1.0, 1.0);
+  }
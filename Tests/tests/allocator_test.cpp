@@ -1,8 +1,13 @@
 #include "../gapi/deviceallocator.h"
 
+#include <Tempest/Log>
+
 #include <gtest/gtest.h>
 #include <gmock/gmock-matchers.h>
 
+#include <chrono>
+#include <random>
+
 using namespace testing;
 using namespace Tempest::Detail;
 
@@ -91,3 +96,51 @@ TEST(main, DeviceAllocatorAlign1) {
   memory.free(p1);
   memory.free(p3);
   }
+
+TEST(main, DeviceAllocatorStress) {
+  using Allocator = DeviceAllocator<TestDevice>;
+  TestDevice device;
+  Allocator  memory(device);
+
+  std::mt19937 rnd(42);
+  std::vector<Allocator::Allocation> live;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for(int i=0; i<100000; ++i) {
+    if(live.size()>0 && rnd()%3==0) {
+      size_t id = rnd()%live.size();
+      memory.free(live[id]);
+      live[id] = live.back();
+      live.pop_back();
+      continue;
+      }
+    size_t size  = 1+rnd()%(4*1024);
+    size_t align = size_t(1)<<(rnd()%9);
+    auto   a     = memory.alloc(size,align,rnd()%2,0);
+    ASSERT_NE(a.page,nullptr);
+    EXPECT_EQ(a.offset%align,0u);
+    live.push_back(a);
+    }
+  auto time = std::chrono::high_resolution_clock::now()-start;
+
+  std::sort(live.begin(),live.end(),[](const Allocator::Allocation& l, const Allocator::Allocation& r){
+    if(l.page!=r.page)
+      return std::less<const void*>()(l.page,r.page);
+    return l.offset<r.offset;
+    });
+  for(size_t i=1; i<live.size(); ++i) {
+    if(live[i-1].page==live[i].page) {
+      EXPECT_LE(live[i-1].offset+live[i-1].size,live[i].offset);
+      }
+    }
+
+  auto st = memory.stats();
+  EXPECT_EQ(st.allocations,live.size());
+  Tempest::Log::i("DeviceAllocator: ",int(std::chrono::duration_cast<std::chrono::milliseconds>(time).count())," ms, pages=",
+                  st.pages,", allocated=",st.allocated,"/",st.reserved,
+                  ", free blocks=",st.freeBlocks,", fragmentation=",st.fragmentation());
+
+  for(auto& i:live)
+    memory.free(i);
+  EXPECT_EQ(memory.stats().pages,0u);
+  }
@@ -44,6 +44,91 @@ TEST(main, AtlasAlloator1) {
   s1=Allocation();
   }
 
+static bool overlaps(const std::vector<Allocation>& al) {
+  for(size_t i=0;i<al.size();++i)
+    for(size_t r=i+1;r<al.size();++r) {
+      if(al[i].pageId()!=al[r].pageId())
+        continue;
+      auto a = al[i].pageRect();
+      auto b = al[r].pageRect();
+      auto p = al[i].node, q = al[r].node;
+      if(a.x<b.x+int(q->w) && b.x<a.x+int(p->w) && a.y<b.y+int(q->h) && b.y<a.y+int(p->h))
+        return true;
+      }
+  return false;
+  }
+
+TEST(main, AtlasShelfAlloator) {
+  TestDevice device;
+  Allocator  allocator(device);
+  allocator.setPacking(Allocator::P_Shelf);
+  allocator.setPageSize(128);
+
+  std::vector<Allocation> al;
+  for(int i=0;i<64;++i)
+    al.push_back(allocator.alloc(16,14+uint32_t(i%3)));
+  EXPECT_EQ(allocator.pageCount(),1u);
+  EXPECT_FALSE(overlaps(al));
+
+  // empty shelves are recycled
+  al.clear();
+  for(int i=0;i<64;++i)
+    al.push_back(allocator.alloc(16,16));
+  EXPECT_EQ(allocator.pageCount(),1u);
+  EXPECT_FALSE(overlaps(al));
+  }
+
+TEST(main, AtlasCompact) {
+  for(auto pk:{Allocator::P_Tree,Allocator::P_Shelf}) {
+    TestDevice device;
+    Allocator  allocator(device);
+    allocator.setPacking(pk);
+    allocator.setPageSize(128);
+
+    std::vector<Allocation> al;
+    for(int i=0;i<64;++i)
+      al.push_back(allocator.alloc(64,64));
+    EXPECT_EQ(allocator.pageCount(),16u);
+
+    std::vector<Allocation> keep;
+    for(size_t i=0;i<al.size();i+=4)
+      keep.push_back(al[i]);
+    al.clear();
+
+    size_t copied = 0;
+    auto   mv     = allocator.compact([&](void*, void*, const Allocator::Move&){ ++copied; });
+    EXPECT_EQ(mv.size(),keep.size());
+    EXPECT_EQ(copied,   keep.size());
+    EXPECT_EQ(allocator.pageCount(),4u);
+    EXPECT_FALSE(overlaps(keep));
+    for(auto& k:keep) {
+      auto it = std::find_if(mv.begin(),mv.end(),[&](const Allocator::Move& m){
+        return m.dstId==k.pageId() && m.dst==k.pos();
+        });
+      EXPECT_TRUE(it!=mv.end());
+      }
+
+    // compacted pages keep working
+    al.push_back(allocator.alloc(32,32));
+    EXPECT_EQ(allocator.pageCount(),5u);
+    }
+  }
+
+TEST(main, AtlasCoalesce) {
+  TestDevice device;
+  Allocator  allocator(device);
+
+  auto s1 = allocator.alloc(100,100);
+  auto s2 = allocator.alloc(100,100);
+  EXPECT_EQ(allocator.pageCount(),1u);
+  s1 = Allocation();
+  s2 = Allocation();
+
+  // released space is merged back, so whole page fits again
+  auto s3 = allocator.alloc(512,512);
+  EXPECT_EQ(allocator.pageCount(),1u);
+  }
+
 TEST(main, AtlasBlockAlloator0) {
   /*
   Allocator::Block<int> b;
@@ -1,18 +1,110 @@
 #include <Tempest/VulkanApi>
 #include <Tempest/Device>
+#include <Tempest/Fence>
 #include <Tempest/Painter>
 #include <Tempest/TextureAtlas>
 #include <Tempest/VectorImage>
 #include <Tempest/Event>
 #include <Tempest/Log>
 #include <Tempest/Except>
+#include <Tempest/Widget>
+#include <Tempest/EventDispatcher>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock-matchers.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 using namespace testing;
 using namespace Tempest;
 
+namespace {
+// counts emitted vertices; optionally reports hardware scissor support
+class BenchDevice : public PaintDevice {
+  public:
+    BenchDevice(bool hwScissor):hwScissor(hwScissor){}
+    size_t count=0;
+    size_t calls=0;
+    std::vector<Point> head; // first quad
+
+  protected:
+    void   clear() override { count=0; calls=0; head.clear(); }
+    void   addPoint(const Point& p) override { addPoints(&p,1); }
+    void   addPoints(const Point* p, size_t n) override {
+      for(size_t i=0; i<n && head.size()<6; ++i)
+        head.push_back(p[i]);
+      count+=n;
+      calls++;
+      }
+    void   commitPoints() override {}
+
+    void   beginPaint(bool,uint32_t,uint32_t) override {}
+    void   endPaint() override {}
+    size_t pushState() override { return 0; }
+    void   popState(size_t) override {}
+
+    void   setState(const TexPtr&, const Color&, TextureFormat) override {}
+    void   setState(const Sprite&, const Color&) override {}
+    void   setTopology(Topology) override {}
+    void   setBlend(const Blend) override {}
+    bool   setScissor(const Rect&) override { return hwScissor; }
+
+  private:
+    bool   hwScissor=false;
+  };
+
+struct PaintCounter : Widget {
+  explicit PaintCounter(const Color& cl):cl(cl){}
+  Color cl;
+  int   paints=0;
+
+  void paintEvent(PaintEvent& e) override {
+    paints++;
+    Painter p(e);
+    p.setBrush(Brush(cl,PaintDevice::NoBlend));
+    p.drawRect(0,0,w(),h());
+    }
+  };
+
+uint64_t drawClippedQuads(BenchDevice& dev, TextureAtlas& atlas, size_t& vertexCount) {
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    PaintEvent ev(dev,atlas,1024,1024);
+    Painter    p(ev);
+    p.setScissor(3,5,1000,1000);
+    for(int i=0;i<100000;++i) {
+      // 8x12 glyph quads, most of them are crossing scissor edges
+      int x = (i*7)%1024-4;
+      int y = (i/128)%1024-6;
+      p.drawRect(x,y,8,12, 0.f,0.f,1.f,1.f);
+      }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  vertexCount = dev.count;
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count());
+  }
+
+uint64_t drawGlyphs(PaintDevice& dev, TextureAtlas& atlas, const std::vector<Sprite>& glyphs, size_t count) {
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    PaintEvent ev(dev,atlas,1024,1024);
+    Painter    p(ev);
+    for(size_t i=0;i<count;++i) {
+      // same pattern as Painter::drawText: brush per glyph, all glyphs are on one atlas page
+      auto& g = glyphs[i%glyphs.size()];
+      int   x = int(i*7)%1024;
+      int   y = int(i/128)%1024;
+      p.setBrush(Brush(g,Color(1.f),PaintDevice::Alpha));
+      p.drawRect(x,y,g.w(),g.h());
+      }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count());
+  }
+}
+
 TEST(main,Draw2d) {
   try {
     VulkanApi    api;
@@ -32,3 +124,466 @@ TEST(main,Draw2d) {
       throw;
     }
   }
+
+TEST(main,Draw2dPacked) {
+  static_assert(sizeof(PaintDevice::PointPacked)==16,"unexpected packed vertex size");
+  static_assert(sizeof(PaintDevice::PointPacked)*2<=sizeof(PaintDevice::Point),"packed vertex should be at least 2x smaller");
+
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    VectorImage  img(VectorImage::VF_Packed), ref;
+    EXPECT_EQ(img.format(),VectorImage::VF_Packed);
+
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+    auto render = [&](VectorImage& vimg) {
+      {
+        PaintEvent ev(vimg,atlas,64,64);
+        Painter    p(ev);
+        p.setBrush(Brush(Color(1.f,0.f,0.f,1.f),PaintDevice::NoBlend));
+        p.drawRect(0,0,32,32);
+      }
+      auto tex = device.attachment(TextureFormat::RGBA8,64,64);
+      auto fbo = device.frameBuffer(tex);
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        vimg.draw(device,0,64,64,enc);
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      return device.readPixels(tex);
+      };
+
+    auto pm = render(img);
+    auto pr = render(ref);
+    ASSERT_EQ(pm.dataSize(),pr.dataSize());
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+
+    auto px = reinterpret_cast<const uint32_t*>(pm.data());
+    EXPECT_EQ(px[16*64+16],0xFF0000FF);
+    EXPECT_EQ(px[48*64+48],0xFFFF0000);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,Draw2dScissorScale) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    VectorImage img;
+    {
+      PaintEvent ev(img,atlas,64,64);
+      Painter    p(ev);
+      p.setBrush(Brush(Color(1.f,0.f,0.f,1.f),PaintDevice::NoBlend));
+      p.setScissor(0,0,32,32);
+      p.drawRect(0,0,64,64);
+    }
+
+    // image is stretched to 2x target: so is the scissor
+    auto tex  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto fbo  = device.frameBuffer(tex);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto cmd  = device.commandBuffer();
+    {
+      auto enc = cmd.startEncoding(device);
+      enc.setFramebuffer(fbo,rp);
+      img.draw(device,0,128,128,enc);
+    }
+    auto sync = device.fence();
+    device.submit(cmd,sync);
+    sync.wait();
+
+    auto pm = device.readPixels(tex);
+    auto px = reinterpret_cast<const uint32_t*>(pm.data());
+    EXPECT_EQ(px[48*128+48],0xFF0000FF);
+    EXPECT_EQ(px[80*128+80],0xFFFF0000);
+    EXPECT_EQ(px[16*128+80],0xFFFF0000);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,WidgetCache) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Widget root;
+    root.resize(64,64);
+    root.setLayout(Vertical);
+    auto& w0 = root.addWidget(new PaintCounter(Color(1.f,0.f,0.f,1.f)));
+    auto& w1 = root.addWidget(new PaintCounter(Color(0.f,1.f,0.f,1.f)));
+    EventDispatcher dis(root);
+
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+    auto paint = [&](VectorImage& img) {
+      img.clear();
+      PaintEvent ev(img,atlas,64,64);
+      dis.dispatchPaint(root,ev);
+      };
+    auto render = [&](VectorImage& img) {
+      auto tex = device.attachment(TextureFormat::RGBA8,64,64);
+      auto fbo = device.frameBuffer(tex);
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        img.draw(device,0,64,64,enc);
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      return device.readPixels(tex);
+      };
+
+    VectorImage img;
+    paint(img);
+    EXPECT_EQ(w0.paints,1);
+    EXPECT_EQ(w1.paints,1);
+    auto ref = render(img);
+
+    // nothing changed: whole tree is replayed
+    paint(img);
+    EXPECT_EQ(w0.paints,1);
+    EXPECT_EQ(w1.paints,1);
+    auto pm = render(img);
+    ASSERT_EQ(pm.dataSize(),ref.dataSize());
+    EXPECT_EQ(std::memcmp(pm.data(),ref.data(),pm.dataSize()),0);
+
+    // only updated widget is painted again
+    w1.cl = Color(1.f,1.f,0.f,1.f);
+    w1.update();
+    paint(img);
+    EXPECT_EQ(w0.paints,1);
+    EXPECT_EQ(w1.paints,2);
+
+    VectorImage fresh;
+    paint(fresh);
+    EXPECT_EQ(w0.paints,2);
+    auto pu = render(fresh);
+    pm = render(img);
+    EXPECT_EQ(std::memcmp(pm.data(),pu.data(),pm.dataSize()),0);
+    EXPECT_NE(std::memcmp(pm.data(),ref.data(),pm.dataSize()),0);
+
+    // cached geometry is dropped, when atlas sprites are moved
+    auto spr = atlas.load(Pixmap(16,16,Pixmap::Format::RGBA));
+    const uint32_t gen = atlas.generation();
+    atlas.compact();
+    ASSERT_NE(atlas.generation(),gen);
+    paint(img);
+    EXPECT_EQ(w0.paints,3);
+    EXPECT_EQ(w1.paints,4);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,Draw2dScissorBenchmark) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    BenchDevice  cpu(false), hw(true);
+    size_t       cpuCount=0, hwCount=0;
+
+    auto tCpu = drawClippedQuads(cpu,atlas,cpuCount);
+    auto tHw  = drawClippedQuads(hw, atlas,hwCount);
+    Log::i("100k clipped quads: cpu clipper = ",tCpu,"us, hw scissor = ",tHw,"us");
+
+    // same quads are rejected by both paths
+    EXPECT_EQ(cpuCount,hwCount);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,Draw2dGlyphBenchmark) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    std::vector<Sprite> glyphs;
+    for(uint32_t i=0;i<64;++i)
+      glyphs.push_back(atlas.load(Pixmap(8+i%4,12,Pixmap::Format::R)));
+
+    const size_t count = 100000;
+    BenchDevice  dev(true);
+    VectorImage  img;
+
+    auto tDev = drawGlyphs(dev,atlas,glyphs,count);
+    auto tImg = drawGlyphs(img,atlas,glyphs,count);
+    Log::i("100k glyphs: painter = ",tDev,"us, painter+VectorImage = ",tImg,"us, device calls = ",dev.calls);
+
+    EXPECT_EQ(dev.count,count*6);
+    // points are submitted in batches, not one by one
+    EXPECT_LT(dev.calls*100,dev.count);
+
+    // batching keeps geometry: first glyph covers [0,0]x[w,h] of 1024x1024 target
+    ASSERT_EQ(dev.head.size(),6u);
+    float x0=1, y0=1, x1=-1, y1=-1;
+    for(auto& p:dev.head) {
+      x0 = std::min(x0,p.x); x1 = std::max(x1,p.x);
+      y0 = std::min(y0,p.y); y1 = std::max(y1,p.y);
+      }
+    EXPECT_FLOAT_EQ(x0,-1.f);
+    EXPECT_FLOAT_EQ(y0,-1.f);
+    EXPECT_FLOAT_EQ(x1,-1.f+float(glyphs[0].w())*2.f/1024.f);
+    EXPECT_FLOAT_EQ(y1,-1.f+float(glyphs[0].h())*2.f/1024.f);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,TextLayout) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Font fnt("data/data/font/Roboto.ttf");
+    fnt.setPixelSize(16);
+
+    auto l0 = fnt.layout("Hello, World",atlas);
+    auto l1 = fnt.layout("Hello, World",atlas);
+    EXPECT_EQ(l0.glyphCount(),11u);
+    EXPECT_EQ(l0.glyphCount(),l1.glyphCount());
+    EXPECT_EQ(l0.size().w,fnt.textSize("Hello, World").w);
+
+    VectorImage img;
+    PaintEvent  ev(img,atlas,256,64);
+    Painter     p(ev);
+    p.setFont(fnt);
+    p.drawText(0,32,l0);
+    p.drawText(0,0,256,64,"Hello, World",AlignHCenter|AlignVCenter);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,TextLayoutCache) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Font fnt("data/data/font/Roboto.ttf");
+    fnt.setPixelSize(16);
+
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f)));
+    auto sync = device.fence();
+    auto render = [&](bool cached) {
+      VectorImage img;
+      {
+        PaintEvent ev(img,atlas,256,64);
+        Painter    p(ev);
+        p.setFont(fnt);
+        p.setBrush(Color(1.f));
+        if(cached)
+          p.drawText(0,32,"Hello, World"); else
+          p.drawText(0,32,u"Hello, World");
+      }
+      auto tex = device.attachment(TextureFormat::RGBA8,256,64);
+      auto fbo = device.frameBuffer(tex);
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        img.draw(device,0,256,64,enc);
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      return device.readPixels(tex);
+      };
+
+    // glyphs are placed after a large sprite, that is released later
+    auto tmp = atlas.load(Pixmap(300,300,Pixmap::Format::R));
+    auto l0  = fnt.layout("Hello, World",atlas);
+    // cached layout and per-letter path produce same image
+    auto pc  = render(true);
+    auto pu  = render(false);
+    ASSERT_EQ(pc.dataSize(),pu.dataSize());
+    EXPECT_EQ(std::memcmp(pc.data(),pu.data(),pc.dataSize()),0);
+
+    // layouts of moved glyphs are not served from cache
+    const uint32_t gen = atlas.generation();
+    tmp = Sprite();
+    auto mv = atlas.compact();
+    EXPECT_EQ(atlas.generation()!=gen,!mv.empty());
+    EXPECT_EQ(fnt.layout("Hello, World",atlas).glyphCount(),l0.glyphCount());
+    auto pm = render(true);
+    EXPECT_EQ(std::memcmp(pm.data(),pu.data(),pm.dataSize()),0);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,FontSdf) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Font fnt("data/data/font/Roboto.ttf");
+    fnt.setSdf(true);
+
+    fnt.setPixelSize(16);
+    auto small = fnt.letter(U'A',atlas);
+    fnt.setPixelSize(128);
+    auto large = fnt.letter(U'A',atlas);
+
+    // one distance field sprite for all sizes
+    EXPECT_EQ(small.view.pageId(),  large.view.pageId());
+    EXPECT_EQ(small.view.pageRect(),large.view.pageRect());
+    EXPECT_LT(small.size.w,large.size.w);
+
+    VectorImage img;
+    PaintEvent  ev(img,atlas,256,64);
+    Painter     p(ev);
+    p.setFont(fnt);
+    p.drawText(0,32,"Hello, World");
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,AtlasIncrementalUpload) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Pixmap red(4,4,Pixmap::Format::RGBA), green(4,4,Pixmap::Format::RGBA);
+    for(uint32_t i=0;i<4*4;++i) {
+      reinterpret_cast<uint32_t*>(red.data())  [i] = 0xFF0000FF;
+      reinterpret_cast<uint32_t*>(green.data())[i] = 0xFF00FF00;
+      }
+
+    auto s0 = atlas.load(red);
+    s0.pageRawData(device);
+    // second sprite is copied into already existing page texture
+    auto s1 = atlas.load(green);
+    ASSERT_EQ(s0.pageId(),s1.pageId());
+
+    auto     pm = device.readPixels(s1.pageRawData(device));
+    auto     r  = s1.pageRect();
+    auto     px = reinterpret_cast<const uint32_t*>(pm.data());
+    EXPECT_EQ(px[r.y*int(pm.w())+r.x],0xFF00FF00);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,AtlasBudget) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Font fnt("data/data/font/Roboto.ttf");
+    for(float sz:{96.f,128.f,160.f,192.f}) {
+      fnt.setPixelSize(sz);
+      for(char32_t c=U'A'; c<=U'Z'; ++c)
+        fnt.letter(c,atlas);
+      }
+    const size_t usage = atlas.memoryUsage();
+    ASSERT_GT(atlas.stats().pages,2u);
+
+    // glyph masks are stored in R8 pages
+    atlas.setBudget(2*512*512);
+    atlas.nextFrame();
+    // glyphs of previous frame are never evicted
+    EXPECT_EQ(atlas.memoryUsage(),usage);
+
+    auto& recent = fnt.letter(U'A',atlas);
+    atlas.touch(recent.view);
+    atlas.nextFrame();
+
+    auto st = atlas.stats();
+    EXPECT_GT(st.evictions,0u);
+    EXPECT_LE(st.memory,atlas.budget());
+    EXPECT_FALSE(fnt.letter(U'A',atlas).view.isEmpty());
+
+    // evicted glyph is generated again
+    fnt.setPixelSize(96);
+    EXPECT_FALSE(fnt.letter(U'B',atlas).view.isEmpty());
+    EXPECT_GT(atlas.stats().misses,st.misses);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(main,AtlasFormats) {
+  try {
+    VulkanApi    api;
+    Device       device(api);
+    TextureAtlas atlas(device);
+
+    Pixmap mask(64,64,Pixmap::Format::R);
+    auto   glyph = atlas.load(mask);
+    EXPECT_EQ(glyph.pageRawData(device).format(),TextureFormat::R8);
+    EXPECT_EQ(atlas.memoryUsage(),512u*512u);
+
+    Pixmap dxt(30,30,Pixmap::Format::DXT5);
+    auto   sprite = atlas.load(dxt);
+    EXPECT_EQ(sprite.w(),30);
+    if(device.properties().hasSamplerFormat(TextureFormat::DXT5)) {
+      EXPECT_EQ(sprite.pageRawData(device).format(),TextureFormat::DXT5);
+      EXPECT_EQ(atlas.memoryUsage(),2u*512u*512u);
+      } else {
+      EXPECT_EQ(sprite.pageRawData(device).format(),TextureFormat::RGBA8);
+      }
+
+    atlas.setBlockCompression(true);
+    Pixmap rgb(33,17,Pixmap::Format::RGB);
+    auto   packed = atlas.load(rgb);
+    if(device.properties().hasSamplerFormat(TextureFormat::DXT1))
+      EXPECT_EQ(packed.pageRawData(device).format(),TextureFormat::DXT1);
+    EXPECT_EQ(atlas.compact().size(),3u);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
@@ -0,0 +1,61 @@
+#include <Tempest/Font>
+#include <Tempest/Log>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock-matchers.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace testing;
+using namespace Tempest;
+
+static const char* benchText = "The quick brown fox jumps over the lazy dog 0123456789";
+
+static uint64_t measureTextSize(const Font& fnt, size_t threads, size_t iterations, std::vector<Size>& ret) {
+  std::vector<std::thread> th;
+  ret.assign(threads*iterations,Size());
+  auto t0 = std::chrono::steady_clock::now();
+  for(size_t i=0;i<threads;++i) {
+    th.emplace_back([&,i](){
+      for(size_t r=0;r<iterations;++r)
+        ret[i*iterations+r] = fnt.textSize(benchText);
+      });
+    }
+  for(auto& i:th)
+    i.join();
+  auto t1 = std::chrono::steady_clock::now();
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count());
+  }
+
+TEST(main,FontContentionBenchmark) {
+  Font fnt("data/data/font/Roboto.ttf");
+  fnt.setPixelSize(16);
+  // warmup: fill letter table
+  const Size ref = fnt.textSize(benchText);
+  ASSERT_GT(ref.w,0);
+
+  const size_t      iterations = 20000;
+  const size_t      maxThreads = std::max(1u,std::thread::hardware_concurrency());
+  std::vector<Size> ret;
+  auto mismatch = [&](){
+    size_t n = 0;
+    for(auto& i:ret)
+      if(i.w!=ref.w || i.h!=ref.h)
+        ++n;
+    return n;
+    };
+
+  // cold font: letters are inserted, while other threads read them
+  Font cold("data/data/font/Roboto.ttf");
+  cold.setPixelSize(16);
+  measureTextSize(cold,maxThreads,100,ret);
+  EXPECT_EQ(mismatch(),0u);
+
+  for(size_t t=1; t<=maxThreads; t*=2) {
+    auto time = measureTextSize(fnt,t,iterations,ret);
+    // same work per thread: with lock-free lookup time should stay flat
+    Log::i("textSize x",iterations,", threads = ",t,": ",time,"us");
+    EXPECT_EQ(mismatch(),0u) << "threads = " << t;
+    }
+  }
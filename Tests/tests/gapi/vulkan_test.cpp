@@ -3,11 +3,21 @@
 #include <Tempest/Device>
 #include <Tempest/Fence>
 #include <Tempest/Pixmap>
+#include <Tempest/UploadToken>
+#include <Tempest/Readback>
+#include <Tempest/TransientBuffer>
 #include <Tempest/Log>
+#include <Tempest/MemReader>
+#include <Tempest/MemWriter>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock-matchers.h>
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
 using namespace testing;
 using namespace Tempest;
 
@@ -15,11 +25,20 @@ struct Vertex {
   float x,y;
   };
 
+struct Instance {
+  float x,y,w,h;
+  };
+
 namespace Tempest {
 template<>
 inline VertexBufferDecl vertexBufferDecl<::Vertex>() {
   return {Decl::float2};
   }
+
+template<>
+inline VertexBufferDecl vertexBufferDecl<::Instance>() {
+  return {Decl::float4};
+  }
 }
 
 static const Vertex   vboData[3] = {{-1,-1},{1,-1},{1,1}};
@@ -52,6 +71,155 @@ TEST(VulkanApi,Vbo) {
     }
   }
 
+TEST(VulkanApi,VboBenchmark) {
+  try {
+    VulkanApi api;
+    Device    device(api);
+
+    // uploads are sub-allocated from staging ring and submitted in batches
+    std::vector<VertexBuffer<Vertex>>    vbo(10000);
+    std::vector<StorageBuffer<uint32_t>> probe;
+    std::vector<std::array<uint32_t,6>>  probeData;
+    auto t0 = std::chrono::steady_clock::now();
+    for(size_t i=0;i<vbo.size();++i) {
+      vbo[i] = device.vbo(vboData,3);
+      if(i%100==0) {
+        // readable buffers interleaved with vbo: both are staged through the same ring
+        std::array<uint32_t,6> d;
+        for(size_t r=0;r<d.size();++r)
+          d[r] = uint32_t(i*d.size()+r);
+        probe.push_back(device.ssbo(d.data(),d.size()));
+        probeData.push_back(d);
+        }
+      }
+    device.waitIdle();
+    auto t1 = std::chrono::steady_clock::now();
+
+    auto dt = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+    Log::i("10k small vbo: ",dt,"us");
+
+    for(size_t i=0;i<probe.size();++i) {
+      auto ret = device.readBytes(probe[i]);
+      ASSERT_EQ(ret.size(),probeData[i].size());
+      EXPECT_EQ(std::memcmp(ret.data(),probeData[i].data(),ret.size()*sizeof(uint32_t)),0) << "probe " << i;
+      }
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,TextureUpload) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    Pixmap pm(256,256,Pixmap::Format::RGBA);
+    auto   px = reinterpret_cast<uint8_t*>(pm.data());
+    for(size_t i=0;i<pm.dataSize();++i)
+      px[i] = uint8_t(i%251);
+
+    // loadTexture returns right away; upload is running on transfer queue, if device has one
+    std::vector<Texture2d>   tex;
+    std::vector<UploadToken> ready(16);
+    for(auto& i:ready)
+      tex.emplace_back(device.loadTexture(pm,i,false));
+    for(auto& i:ready) {
+      i.wait();
+      EXPECT_TRUE(i.isReady());
+      }
+
+    auto back = device.readPixels(tex.back());
+    ASSERT_EQ(back.dataSize(),pm.dataSize());
+    EXPECT_EQ(std::memcmp(back.data(),pm.data(),pm.dataSize()),0);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,ReadbackAsync) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    Pixmap pm(128,128,Pixmap::Format::RGBA);
+    auto   px = reinterpret_cast<uint8_t*>(pm.data());
+    for(size_t i=0;i<pm.dataSize();++i)
+      px[i] = uint8_t(i%253);
+    auto tex = device.loadTexture(pm,false);
+
+    // several readbacks in flight
+    std::vector<Readback> rb;
+    for(int i=0;i<4;++i)
+      rb.emplace_back(device.readPixelsAsync(tex,Rect(i*8,i*4,32,16)));
+    rb.emplace_back(device.readPixelsAsync(tex));
+
+    for(int i=0;i<4;++i) {
+      Pixmap back = rb[size_t(i)].get();
+      ASSERT_EQ(back.w(),32u);
+      ASSERT_EQ(back.h(),16u);
+      auto bx = reinterpret_cast<const uint8_t*>(back.data());
+      for(uint32_t y=0;y<back.h();++y) {
+        const size_t src = ((size_t(i*4)+y)*pm.w()+size_t(i*8))*4;
+        EXPECT_EQ(std::memcmp(bx+y*back.w()*4,px+src,back.w()*4),0);
+        }
+      }
+    Pixmap all = rb.back().get();
+    EXPECT_EQ(std::memcmp(all.data(),pm.data(),pm.dataSize()),0);
+
+    EXPECT_THROW(device.readPixelsAsync(tex,Rect(100,100,64,64)),std::system_error);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,MemoryStats) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    auto before = device.memoryStats();
+    {
+    auto vbo = device.vbo(vboData,3);
+    auto tex = device.attachment(TextureFormat::RGBA8,64,64);
+
+    auto st = device.memoryStats();
+    EXPECT_EQ(st.allocations.size(),before.allocations.size()+2);
+    EXPECT_GE(st.allocated(),before.allocated()+sizeof(vboData)+64*64*4);
+    EXPECT_GE(st.textures.allocations,1u);
+    EXPECT_GE(st.reserved(),st.allocated());
+    EXPECT_LE(st.fragmentation(),1.0);
+
+    bool hasVbo = false;
+    for(auto& b:st.buffers)
+      if((b.usage & MemUsage::VertexBuffer)==MemUsage::VertexBuffer)
+        hasVbo = true;
+    EXPECT_TRUE(hasVbo);
+
+    std::string json = st.toJson();
+    EXPECT_NE(json.find("\"site\":\"attachment\""),std::string::npos);
+    EXPECT_NE(json.find("\"vertex\""),std::string::npos);
+    Log::d(json);
+    }
+    device.waitIdle();
+    auto after = device.memoryStats();
+    EXPECT_EQ(after.allocations.size(),before.allocations.size());
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
 TEST(VulkanApi,Shader) {
   try {
     VulkanApi api{ApiFlags::Validation};
@@ -133,3 +301,532 @@ TEST(VulkanApi,Draw) {
       throw;
     }
   }
+
+TEST(VulkanApi,DrawTransient) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    auto vert = device.loadShader("shader/simple_test.vert.sprv");
+    auto frag = device.loadShader("shader/simple_test.frag.sprv");
+    auto pso  = device.pipeline<Vertex>(Topology::Triangles,RenderState(),vert,frag);
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto ref  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+    {
+    auto vbo = device.vbo(vboData,3);
+    auto ibo = device.ibo(iboData,3);
+    auto fbo = device.frameBuffer(ref);
+    auto cmd = device.commandBuffer();
+    {
+      auto enc = cmd.startEncoding(device);
+      enc.setFramebuffer(fbo,rp);
+      enc.setUniforms(pso);
+      enc.draw(vbo,ibo);
+    }
+    device.submit(cmd,sync);
+    sync.wait();
+    }
+
+    // small frames: ranges spill into extra pages
+    auto mem = device.transientBuffer(16);
+    auto fbo = device.frameBuffer(tex);
+    auto cmd = device.commandBuffer();
+    for(uint8_t frame=0; frame<4; ++frame) {
+      mem.reset(frame%device.maxFramesInFlight());
+      auto pad = mem.ibo(iboData,1);
+      auto vbo = mem.vbo(vboData,3);
+      auto ibo = mem.ibo(iboData,3);
+      EXPECT_EQ(vbo.size(),3u);
+      EXPECT_EQ(pad.size(),1u);
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        enc.setUniforms(pso);
+        enc.draw(vbo,ibo);
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+    }
+
+    auto pm = device.readPixels(tex);
+    auto pr = device.readPixels(ref);
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,ComputePrefixSum) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    if(!device.properties().compute.enabled)
+      return;
+
+    std::vector<uint32_t> data(256);
+    for(size_t i=0;i<data.size();++i)
+      data[i] = uint32_t(i%7);
+
+    auto ssbo = device.ssbo(data);
+    auto comp = device.loadShader("shader/prefix_sum.comp.sprv");
+    auto pso  = device.computePipeline(comp);
+    auto ubo  = device.uniforms(pso.layout());
+    ubo.set(0,ssbo);
+
+    auto cmd  = device.commandBuffer();
+    {
+      auto enc = cmd.startEncoding(device);
+      enc.setUniforms(pso,ubo);
+      enc.dispatch(1,1,1);
+    }
+
+    auto sync = device.fence();
+    device.submit(cmd,sync);
+    sync.wait();
+
+    auto     ret = device.readBytes(ssbo);
+    uint32_t sum = 0;
+    ASSERT_EQ(ret.size(),data.size());
+    for(size_t i=0;i<data.size();++i) {
+      sum += data[i];
+      EXPECT_EQ(ret[i],sum);
+      }
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,ComputeImage) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    auto& props = device.properties();
+    if(!props.compute.enabled || !props.hasStorageFormat(TextureFormat::RGBA8))
+      return;
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,64,64,false,true);
+    auto fbo  = device.frameBuffer(tex);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+
+    auto comp = device.loadShader("shader/image_store.comp.sprv");
+    auto pso  = device.computePipeline(comp);
+    auto ubo  = device.uniforms(pso.layout());
+    // storage usage is opt-in
+    auto rt   = device.attachment(TextureFormat::RGBA8,64,64);
+    EXPECT_THROW(ubo.set(0,rt),std::system_error);
+    ubo.set(0,tex);
+
+    auto cmd  = device.commandBuffer();
+    {
+      auto enc = cmd.startEncoding(device);
+      // clear pass brings image to sampler layout
+      enc.setFramebuffer(fbo,rp);
+      enc.setUniforms(pso,ubo);
+      enc.dispatch(8,8,1);
+    }
+
+    auto sync = device.fence();
+    device.submit(cmd,sync);
+    sync.wait();
+
+    auto pm  = device.readPixels(tex);
+    auto px  = reinterpret_cast<const uint8_t*>(pm.data());
+    ASSERT_EQ(pm.w(),64u);
+    ASSERT_EQ(pm.h(),64u);
+    for(uint32_t y=0;y<pm.h();++y)
+      for(uint32_t x=0;x<pm.w();++x) {
+        const uint8_t* p = px+(y*pm.w()+x)*4;
+        EXPECT_EQ(p[0],x);
+        EXPECT_EQ(p[1],y);
+        EXPECT_EQ(p[2],0);
+        EXPECT_EQ(p[3],255);
+        }
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,DrawInstanced) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    const size_t          grid = 64;
+    std::vector<Instance> inst(grid*grid);
+    for(size_t i=0;i<inst.size();++i) {
+      const float sz = 2.f/float(grid);
+      inst[i] = {float(i%grid)*sz-1.f+sz*0.5f, float(i/grid)*sz-1.f+sz*0.5f, sz*0.4f, sz*0.4f};
+      }
+
+    auto vbo  = device.vbo(vboData,3);
+    auto ibo  = device.ibo(iboData,3);
+    auto ivbo = device.vbo(inst);
+
+    auto vert = device.loadShader("shader/instanced_test.vert.sprv");
+    auto frag = device.loadShader("shader/simple_test.frag.sprv");
+    auto pso  = device.pipeline<Vertex,Instance>(Topology::Triangles,RenderState(),vert,frag);
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,256,256);
+    auto ref  = device.attachment(TextureFormat::RGBA8,256,256);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+
+    auto render = [&](Attachment& out, bool instanced) {
+      auto fbo   = device.frameBuffer(out);
+      auto cmd   = device.commandBuffer();
+      auto start = std::chrono::high_resolution_clock::now();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        enc.setUniforms(pso);
+        if(instanced) {
+          enc.draw(vbo,ibo,ivbo,inst.size());
+          } else {
+          for(size_t i=0;i<inst.size();++i)
+            enc.draw(vbo,ibo,ivbo,i,1);
+          }
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      auto end = std::chrono::high_resolution_clock::now();
+      return std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+      };
+
+    auto tInst = render(tex,true);
+    auto tLoop = render(ref,false);
+    Log::d("DrawInstanced: ",inst.size()," instances; 1 draw call - ",tInst,"us; ",
+           inst.size()," draw calls - ",tLoop,"us");
+
+    auto pm = device.readPixels(tex);
+    auto pr = device.readPixels(ref);
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+
+    // every instance covers pixel right-above its center and leaves the opposite corner cleared
+    auto   px   = reinterpret_cast<const uint8_t*>(pm.data());
+    size_t cell = pm.w()/grid;
+    for(size_t i=0;i<inst.size();++i) {
+      size_t         x0 = (i%grid)*cell, y0 = (i/grid)*cell;
+      const uint8_t* in = px+((y0+cell/2-1)*pm.w()+x0+cell/2)*4;
+      const uint8_t* bg = px+((y0+cell-1)  *pm.w()+x0)*4;
+      EXPECT_EQ(in[2],0)   << "instance " << i << " is not drawn";
+      EXPECT_EQ(bg[2],255) << "instance " << i << " overdraws its cell";
+      }
+    pm.save("VulkanApi_DrawInstanced.png");
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,DrawIndirect) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    const Vertex   quad[6] = {{-1,-1},{0,-1},{0,0}, {0,0},{1,0},{1,1}};
+    const uint16_t qibo[6] = {0,1,2, 3,4,5};
+
+    auto vbo  = device.vbo(quad,6);
+    auto ibo  = device.ibo(qibo,6);
+
+    std::vector<DrawIndirectCommand>        cmds(2);
+    std::vector<DrawIndexedIndirectCommand> icmds(2);
+    for(uint32_t i=0;i<2;++i) {
+      cmds [i].vertexCount = 3;
+      cmds [i].firstVertex = i*3;
+      icmds[i].indexCount  = 3;
+      icmds[i].firstIndex  = i*3;
+      }
+    auto ind  = device.indirectBuffer(cmds);
+    auto iind = device.indirectBuffer(icmds);
+
+    auto vert = device.loadShader("shader/simple_test.vert.sprv");
+    auto frag = device.loadShader("shader/simple_test.frag.sprv");
+    auto pso  = device.pipeline<Vertex>(Topology::Triangles,RenderState(),vert,frag);
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto tix  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto ref  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+
+    auto render = [&](Attachment& out, int mode) {
+      auto fbo = device.frameBuffer(out);
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        enc.setUniforms(pso);
+        if(mode==0) {
+          enc.draw(vbo,0,3);
+          enc.draw(vbo,3,3);
+          }
+        else if(mode==1) {
+          enc.drawIndirect(vbo,ind);
+          }
+        else {
+          enc.drawIndexedIndirect(vbo,ibo,iind);
+          }
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      };
+
+    render(ref,0);
+    render(tex,1);
+    render(tix,2);
+    Log::d("DrawIndirect: multiDraw = ",device.properties().indirect.multiDraw);
+
+    auto pr = device.readPixels(ref);
+    auto pm = device.readPixels(tex);
+    auto pi = device.readPixels(tix);
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+    EXPECT_EQ(std::memcmp(pi.data(),pr.data(),pi.dataSize()),0);
+    pm.save("VulkanApi_DrawIndirect.png");
+
+    auto fbo = device.frameBuffer(ref);
+    auto cmd = device.commandBuffer();
+    {
+      auto enc = cmd.startEncoding(device);
+      enc.setFramebuffer(fbo,rp);
+      enc.setUniforms(pso);
+      EXPECT_THROW(enc.drawIndirect(vbo,ind,1,2),std::system_error);
+    }
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,CommandBundleThreads) {
+  try {
+    // no validation layers: they dominate recording time
+    VulkanApi api{ApiFlags::NoFlags};
+    Device    device(api);
+
+    const size_t          grid = 320;
+    std::vector<Instance> inst(100000);
+    for(size_t i=0;i<inst.size();++i) {
+      const float sz = 2.f/float(grid);
+      inst[i] = {float(i%grid)*sz-1.f+sz*0.5f, float(i/grid)*sz-1.f+sz*0.5f, sz*0.4f, sz*0.4f};
+      }
+
+    auto vbo  = device.vbo(vboData,3);
+    auto ibo  = device.ibo(iboData,3);
+    auto ivbo = device.vbo(inst);
+
+    auto vert = device.loadShader("shader/instanced_test.vert.sprv");
+    auto frag = device.loadShader("shader/simple_test.frag.sprv");
+    auto pso  = device.pipeline<Vertex,Instance>(Topology::Triangles,RenderState(),vert,frag);
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,256,256);
+    auto ref  = device.attachment(TextureFormat::RGBA8,256,256);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+
+    auto render = [&](Attachment& out, size_t threads) {
+      auto fbo = device.frameBuffer(out);
+      std::vector<CommandBundle> bundle(threads);
+      for(auto& b:bundle)
+        b = device.commandBundle(fbo);
+
+      auto start = std::chrono::high_resolution_clock::now();
+      auto job   = [&](size_t id) {
+        const size_t begin = (inst.size()*id)/threads;
+        const size_t end   = (inst.size()*(id+1))/threads;
+        auto enc = bundle[id].startEncoding(device);
+        enc.setUniforms(pso);
+        for(size_t i=begin;i<end;++i)
+          enc.draw(vbo,ibo,ivbo,i,1);
+        };
+
+      std::vector<std::thread> th;
+      for(size_t i=1;i<threads;++i)
+        th.emplace_back(job,i);
+      job(0);
+      for(auto& i:th)
+        i.join();
+      auto end = std::chrono::high_resolution_clock::now();
+
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        for(auto& b:bundle)
+          enc.execute(b);
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      return std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+      };
+
+    const size_t threads = std::max<size_t>(2,std::thread::hardware_concurrency());
+    auto t1 = render(ref,1);
+    auto tN = render(tex,threads);
+    Log::d("CommandBundleThreads: ",inst.size()," draws; recording on 1 thread - ",t1,"us; ",
+           threads," threads - ",tN,"us");
+
+    auto pm = device.readPixels(tex);
+    auto pr = device.readPixels(ref);
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+    pm.save("VulkanApi_CommandBundleThreads.png");
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,DynamicUniformOffset) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    Device    device(api);
+
+    const size_t          grid = 16;
+    std::vector<Instance> inst(grid*grid);
+    for(size_t i=0;i<inst.size();++i) {
+      const float sz = 2.f/float(grid);
+      inst[i] = {float(i%grid)*sz-1.f+sz*0.5f, float(i/grid)*sz-1.f+sz*0.5f, sz*0.4f, sz*0.4f};
+      }
+
+    auto vbo  = device.vbo(vboData,3);
+    auto ibo  = device.ibo(iboData,3);
+    auto data = device.ubo(inst.data(),inst.size());
+
+    auto vert = device.loadShader("shader/ubo_offset_test.vert.sprv");
+    auto frag = device.loadShader("shader/simple_test.frag.sprv");
+    auto pso  = device.pipeline<Vertex>(Topology::Triangles,RenderState(),vert,frag);
+
+    auto shared = device.uniforms(pso.layout());
+    shared.set(0,data,0,1);
+
+    std::vector<Uniforms> perObject;
+    for(size_t i=0;i<inst.size();++i) {
+      perObject.emplace_back(device.uniforms(pso.layout()));
+      perObject.back().set(0,data,i,1);
+      }
+
+    auto tex  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto ref  = device.attachment(TextureFormat::RGBA8,128,128);
+    auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+    auto sync = device.fence();
+
+    Encoder<CommandBuffer>::Stats stat;
+    auto render = [&](Attachment& out, bool dynamic) {
+      auto fbo = device.frameBuffer(out);
+      auto cmd = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        for(size_t i=0;i<inst.size();++i) {
+          if(dynamic)
+            enc.setUniforms(pso,shared,uint32_t(i)); else
+            enc.setUniforms(pso,perObject[i]);
+          // redundant, must be filtered by encoder
+          if(dynamic)
+            enc.setUniforms(pso,shared,uint32_t(i));
+          enc.draw(vbo,ibo);
+          }
+        stat = enc.stats();
+      }
+      device.submit(cmd,sync);
+      sync.wait();
+      };
+
+    render(ref,false);
+    render(tex,true);
+
+    EXPECT_EQ(stat.pipelineBinds, 1u);
+    EXPECT_EQ(stat.uniformBinds,  inst.size());
+    EXPECT_EQ(stat.bufferBinds,   2u);
+    EXPECT_EQ(stat.drawCalls,     inst.size());
+    Log::d("DynamicUniformOffset: ",stat.uniformBinds," uniform binds; ",stat.redundantBinds," redundant binds skipped");
+
+    auto pm = device.readPixels(tex);
+    auto pr = device.readPixels(ref);
+    EXPECT_EQ(std::memcmp(pm.data(),pr.data(),pm.dataSize()),0);
+    pm.save("VulkanApi_DynamicUniformOffset.png");
+
+    // whole buffer is bound: any offset would read past its end
+    auto whole = device.uniforms(pso.layout());
+    whole.set(0,data);
+    {
+      auto fbo = device.frameBuffer(tex);
+      auto cmd = device.commandBuffer();
+      auto enc = cmd.startEncoding(device);
+      enc.setFramebuffer(fbo,rp);
+      EXPECT_THROW(enc.setUniforms(pso,whole,1),std::system_error);
+      // element past the end of buffer
+      EXPECT_THROW(enc.setUniforms(pso,shared,uint32_t(inst.size())),std::system_error);
+    }
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }
+
+TEST(VulkanApi,PipelineCache) {
+  try {
+    VulkanApi api{ApiFlags::Validation};
+    std::vector<uint8_t> data;
+    {
+      Device    device(api);
+      auto vert = device.loadShader("shader/simple_test.vert.sprv");
+      auto frag = device.loadShader("shader/simple_test.frag.sprv");
+      auto pso  = device.pipeline<Vertex>(Topology::Triangles,RenderState(),vert,frag);
+
+      auto tex  = device.attachment(TextureFormat::RGBA8,128,128);
+      auto fbo  = device.frameBuffer(tex);
+      auto rp   = device.pass(FboMode(FboMode::PreserveOut,Color(0.f,0.f,1.f)));
+      auto vbo  = device.vbo(vboData,3);
+
+      auto cmd  = device.commandBuffer();
+      {
+        auto enc = cmd.startEncoding(device);
+        enc.setFramebuffer(fbo,rp);
+        enc.setUniforms(pso);
+        enc.draw(vbo);
+      }
+      auto sync = device.fence();
+      device.submit(cmd,sync);
+      sync.wait();
+
+      MemWriter out(data);
+      device.savePipelineCache(out);
+    }
+
+    Device    device(api);
+    MemReader in(data);
+    EXPECT_TRUE(device.loadPipelineCache(in));
+
+    std::vector<uint8_t> garbage(64,0);
+    MemReader bad(garbage);
+    EXPECT_FALSE(device.loadPipelineCache(bad));
+    }
+  catch(std::system_error& e) {
+    if(e.code()==Tempest::GraphicsErrc::NoDevice)
+      Log::d("Skipping vulkan testcase: ", e.what()); else
+      throw;
+    }
+  }